@@ -0,0 +1,124 @@
+// Cover art benchmark against a local HTTP stand-in for the speaker.
+//
+//   node bench/art-bench.js [--preview DIR]
+//
+// Serves every image in bench/art from a local server the way a speaker
+// serves /getaa, then fetches, decodes and renders each one for the colour
+// and black-and-white watches using src/pkjs/artwork.js. Reports fetch and
+// render time, bytes and AppMessage chunks per cover. With --preview, the
+// rendered covers are also written out as PNGs scaled up 4x. Transfers to the
+// watch and its cover cache are measured end to end by
+// bench/e2e-bench.js --art.
+
+var fs = require('fs');
+var http = require('http');
+var path = require('path');
+var zlib = require('zlib');
+var artwork = require('../src/pkjs/artwork.js');
+
+var ITERATIONS = 20;
+var SPECS = [{ name: 'color', size: 48, color: true }, { name: 'mono', size: 48, color: false }];
+
+var artDir = path.join(__dirname, 'art');
+var files = fs.readdirSync(artDir).filter(function(name) { return /\.(jpe?g|png)$/.test(name); }).sort();
+var previewIndex = process.argv.indexOf('--preview');
+var previewDir = previewIndex !== -1 ? process.argv[previewIndex + 1] : null;
+
+function pad(text, width) {
+  text = String(text);
+  while (text.length < width) text += ' ';
+  return text;
+}
+
+// Stand-in speaker: /getaa?u=<file name> answers with the image bytes
+function startServer(done) {
+  var server = http.createServer(function(req, res) {
+    var match = /^\/getaa\?u=([^&]+)/.exec(req.url);
+    var name = match ? decodeURIComponent(match[1]) : '';
+    if (files.indexOf(name) === -1) {
+      res.writeHead(404);
+      res.end();
+      return;
+    }
+    res.writeHead(200, { 'Content-Type': /\.png$/.test(name) ? 'image/png' : 'image/jpeg' });
+    res.end(fs.readFileSync(path.join(artDir, name)));
+  });
+  server.listen(0, '127.0.0.1', function() { done(server); });
+}
+
+function fetch(port, name, done) {
+  var started = process.hrtime();
+  http.get({ host: '127.0.0.1', port: port, path: '/getaa?u=' + encodeURIComponent(name) }, function(res) {
+    var parts = [];
+    res.on('data', function(part) { parts.push(part); });
+    res.on('end', function() {
+      var elapsed = process.hrtime(started);
+      done(new Uint8Array(Buffer.concat(parts)), elapsed[0] * 1e3 + elapsed[1] / 1e6);
+    });
+  });
+}
+
+function renderMillis(bytes, spec) {
+  var cover = artwork.renderCover(bytes, spec);
+  var started = process.hrtime();
+  for (var i = 0; i < ITERATIONS; i++) cover = artwork.renderCover(bytes, spec);
+  var elapsed = process.hrtime(started);
+  return { cover: cover, ms: (elapsed[0] * 1e3 + elapsed[1] / 1e6) / ITERATIONS };
+}
+
+// Minimal PNG writer for previews
+function writePreview(file, cover, spec) {
+  var scale = 4, side = spec.size * scale, rowBytes = (spec.size + 7) >> 3;
+  var raw = Buffer.alloc(side * (side * 3 + 1));
+  for (var y = 0; y < side; y++) {
+    for (var x = 0; x < side; x++) {
+      var sx = Math.floor(x / scale), sy = Math.floor(y / scale), rgb;
+      if (spec.color) {
+        var v = cover.data[sy * spec.size + sx];
+        rgb = [((v >> 4) & 3) * 85, ((v >> 2) & 3) * 85, (v & 3) * 85];
+      } else {
+        var on = (cover.data[sy * rowBytes + (sx >> 3)] >> (sx & 7)) & 1;
+        rgb = on ? [255, 255, 255] : [0, 0, 0];
+      }
+      raw.set(rgb, y * (side * 3 + 1) + 1 + x * 3);
+    }
+  }
+  function chunk(type, data) {
+    var length = Buffer.alloc(4);
+    length.writeUInt32BE(data.length);
+    var body = Buffer.concat([Buffer.from(type), data]);
+    var crc = Buffer.alloc(4);
+    crc.writeUInt32BE(zlib.crc32 ? zlib.crc32(body) : 0);
+    return Buffer.concat([length, body, crc]);
+  }
+  var header = Buffer.alloc(13);
+  header.writeUInt32BE(side, 0);
+  header.writeUInt32BE(side, 4);
+  header[8] = 8; header[9] = 2;
+  fs.writeFileSync(file, Buffer.concat([Buffer.from([0x89, 0x50, 0x4E, 0x47, 0x0D, 0x0A, 0x1A, 0x0A]),
+    chunk('IHDR', header), chunk('IDAT', zlib.deflateSync(raw)), chunk('IEND', Buffer.alloc(0))]));
+}
+
+startServer(function(server) {
+  var port = server.address().port;
+  console.log(pad('cover', 24) + pad('source', 12) + pad('fetch ms', 10) + pad('spec', 7) +
+              pad('render ms', 11) + pad('bytes', 7) + 'chunks');
+
+  (function next(i) {
+    if (i === files.length) {
+      server.close();
+      return;
+    }
+    var name = files[i];
+    fetch(port, name, function(bytes, fetchMs) {
+      SPECS.forEach(function(spec) {
+        var run = renderMillis(bytes, spec);
+        var length = run.cover.data.length;
+        console.log(pad(name, 24) + pad(bytes.length, 12) + pad(fetchMs.toFixed(1), 10) + pad(spec.name, 7) +
+                    pad(run.ms.toFixed(2), 11) + pad(length, 7) + Math.ceil(length / artwork.CHUNK_BYTES));
+        if (previewDir) writePreview(path.join(previewDir, name.replace(/\.\w+$/, '') + '-' + spec.name + '.png'), run.cover, spec);
+      });
+      next(i + 1);
+    });
+  })(0);
+});
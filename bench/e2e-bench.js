@@ -0,0 +1,1428 @@
+// End-to-end command latency benchmark for the phone side, without hardware.
+//
+//   node bench/e2e-bench.js [runs] [--phone index.js] [--trace out.trace] [--verbose]
+//   node bench/e2e-bench.js --browse [--trace out.trace] [--verbose]
+//   node bench/e2e-bench.js --faults [--trace out.trace] [--verbose]
+//   node bench/e2e-bench.js --scrub [--trace out.trace] [--verbose]
+//   node bench/e2e-bench.js --changes [--poll-ms 5000] [--phone index.js] [--trace out.trace] [--verbose]
+//   node bench/e2e-bench.js --status [--verbose]
+//   node bench/e2e-bench.js --art [--trace out.trace] [--verbose]
+//
+// Runs src/pkjs/index.js as PebbleKit JS would, with the Pebble, localStorage
+// and XMLHttpRequest globals it expects supplied here, against a mock Sonos
+// speaker that keeps real transport, volume, track and position state over
+// HTTP. A simulated watch sends commands over a link with a fixed one-way
+// delay and applies the status messages it gets back. It reports:
+//   - startup: 'ready' to the first status on the watch, cold and warm
+//   - per command: watch send to the speaker acting on it, and to the watch
+//     holding a status that shows the result (volume is shown optimistically
+//     on the watch, so only its speaker time is measured)
+//   - SOAP requests and status messages per command, counted until the phone
+//     has gone quiet, so trailing refreshes count against the command that
+//     scheduled them
+//   - the phone's share of each command as echoed back with its trace
+//     (queueing, SOAP first byte, transfer, status refresh) and what is left
+//     of the round trip for the link
+//
+// With --browse it instead opens the queue browser on a BROWSE_QUEUE_LENGTH
+// track queue, scrolls it button-repeat fast, jumps to a track, then opens
+// the favorites and plays an album from them. The simulated watch asks for
+// rows as the watch app does, and it reports time to the first row and the
+// first screenful, Browse requests made to open and to scroll, and how often
+// and for how long the selection sat on a row not yet loaded.
+//
+// With --faults the speaker is healthy, then slow, then stops answering, then
+// resets every connection, then recovers, while the simulated watch keeps
+// polling and presses pause in each phase. Per phase it reports the SOAP
+// requests that reached the speaker, the messages and alerts (error strings
+// and health codes) the watch got, and when the watch showed the speaker
+// unreachable and OK again; and the most requests the speaker had open at once.
+//
+// With --scrub it plays a two hour mix, switches the watch to scrub mode and
+// holds up for SCRUB_HOLD_MS, the simulated watch stepping its target as the
+// watch app does. It reports the seeks sent by the watch and made at the
+// speaker, and how far the position the watch shows is from the speaker's
+// once the next status arrives. Then, against a slow speaker, it scrubs in
+// quick bursts to show newer targets superseding ones not yet sent.
+//
+// With --changes the speaker is the event source: another controller skips
+// tracks, changes the volume and pauses or resumes it at seeded times for
+// CHANGES_MS, while the simulated watch polls on the schedule of the watch
+// app (or every --poll-ms, as the watch app did before it adapted). It
+// reports how long each change took to reach the watch screen and, per hour,
+// the watch polls, SOAP requests and the status messages and bytes the watch
+// received. PebbleKit JS cannot take UPnP NOTIFY callbacks, so this compares
+// full status pushes on a fixed poll with change-only pushes on the adaptive
+// one; the phone code before that change runs through --phone:
+//
+//   git show 1d2e23f:src/pkjs/index.js > /tmp/index.js
+//   node bench/e2e-bench.js --changes --phone /tmp/index.js --poll-ms 5000
+//
+// With --status one status script is run through two phones: the full-tuple
+// status push that preceded the delta protocol (src/pkjs/index.js at
+// STATUS_LEGACY_REV, read with git) and the current delta one. Each runs in its
+// own child process. Both watches poll every STATUS_POLL_MS. The script has
+// another controller skipping to tracks with long metadata, dragging the volume
+// slider and pausing, and the watch pressing volume and play. For this mode the
+// simulated watch also enforces its inbox: a message over WATCH_INBOX_BYTES
+// (the watch app's app_message_open size) is NACKed as an overflow, and one
+// arriving while the watch app still handles the previous one is NACKed as
+// busy. It reports status messages and bytes per hour, both NACK counts, and
+// how long the script's changes took to reach the screen.
+//
+// With --art each track has album art the speaker serves from /getaa, from
+// bench/art and a few generated covers, and the watch skips back and forth
+// through the queue at seeded times, quicker than a transfer at times so a
+// newer cover supersedes one on the wire. The phone fetches, renders, offers
+// and streams the covers; the simulated watch keeps ART_CACHE_SIZE covers by
+// content hash and asks for a missing one from the offset it holds, as the
+// watch app does. Once, the link goes down mid-transfer for longer than the
+// phone retries a chunk, so the watch's stall timer has to resume it. It
+// reports offers, watch cache hits, transfers, chunks, resumes, chunk sends
+// lost on the link, fetches at the speaker, and the time from a skip to the
+// new track's cover on the watch screen. The recorded session is
+// bench/host/traces/art.trace, which replays the same messages through the
+// watch app's own cache:
+//
+//   node bench/e2e-bench.js --art --trace bench/host/traces/art.trace
+//   make -C bench/host && bench/host/replay bench/host/traces/art.trace
+//
+// With --phone another copy of the phone's index.js is run in place of
+// src/pkjs/index.js (its modules still come from src/pkjs), so an older
+// revision can be measured the same way:
+//
+//   git show <rev>:src/pkjs/index.js > /tmp/index.js
+//   node bench/e2e-bench.js --phone /tmp/index.js
+//
+// With --trace every message the watch received is written in the format of
+// bench/host/replay.c, so the same session can be replayed through the watch
+// app on the host (in browse mode with the button presses, so the replay
+// reports the watch heap while scrolling).
+
+var fs = require('fs');
+var http = require('http');
+var path = require('path');
+var zlib = require('zlib');
+var messageKeys = require('../package.json').pebble.messageKeys;
+
+var PKJS = path.join(__dirname, '..', 'src', 'pkjs');
+var PHONE = process.argv.indexOf('--phone') !== -1 ? path.resolve(process.argv[process.argv.indexOf('--phone') + 1]) : path.join(PKJS, 'index.js');
+var RUNS = parseInt(process.argv[2], 10) || 5;
+var TRACE_PATH = process.argv.indexOf('--trace') !== -1 ? process.argv[process.argv.indexOf('--trace') + 1] : null;
+var VERBOSE = process.argv.indexOf('--verbose') !== -1;
+var BROWSE = process.argv.indexOf('--browse') !== -1;
+var FAULTS = process.argv.indexOf('--faults') !== -1;
+var SCRUB = process.argv.indexOf('--scrub') !== -1;
+var CHANGES = process.argv.indexOf('--changes') !== -1;
+var STATUS = process.argv.indexOf('--status') !== -1;
+var STATUS_RUN = process.argv.indexOf('--status-run') !== -1;
+var ART = process.argv.indexOf('--art') !== -1;
+var POLL_MS = process.argv.indexOf('--poll-ms') !== -1 ? parseInt(process.argv[process.argv.indexOf('--poll-ms') + 1], 10) : 0;
+var LINK_MS = 30;          // one-way Bluetooth hop between watch and phone
+var SPEAKER_MS = 40;       // speaker response time per SOAP request
+var SETTLE_MS = 500;       // pause between commands
+var QUIET_MS = 1200;       // no requests or messages for this long ends a command
+var TIMEOUT_MS = 5000;
+
+var KEY = {};
+messageKeys.forEach(function(name, i) { KEY[name.trim()] = i; });
+
+var TRACKS = [
+  { title: 'Harvest Moon', artist: 'Neil Young', album: 'Harvest Moon', duration: 303 },
+  { title: 'Unknown Legend', artist: 'Neil Young', album: 'Harvest Moon', duration: 253 },
+  { title: 'From Hank to Hendrix', artist: 'Neil Young', album: 'Harvest Moon', duration: 322 },
+  { title: 'You and Me', artist: 'Neil Young', album: 'Harvest Moon', duration: 225 }
+];
+
+var BROWSE_QUEUE_LENGTH = 5000;
+var ALBUM_LENGTH = 10;     // tracks queued by an album favorite
+var FAVORITES = [
+  { title: 'Radio Paradise', description: 'TuneIn Station', uri: 'x-rincon-mp3radio://stream.radioparadise.com/mp3-192',
+    upnpClass: 'object.item.audioItem.audioBroadcast' },
+  { title: 'Harvest Moon', description: 'Neil Young', uri: 'x-rincon-cpcontainer:1004206calbum%3aHarvest%20Moon',
+    upnpClass: 'object.container.album.musicAlbum' },
+  { title: 'Morning Coffee', description: 'Sonos Playlist', uri: 'file:///jffs/settings/savedqueues.rsq#3',
+    upnpClass: 'object.container.playlistContainer' }
+];
+
+// Mock speaker
+
+var speaker = { transport: 'PLAYING', volume: 30, track: 0, position: 12, positionAt: Date.now(), requests: 0, actions: [],
+                open: 0, maxOpen: 0, fault: null, seekAnsweredAt: 0, uri: '', queueLength: BROWSE_QUEUE_LENGTH, queueTrack: 1, queueUpdateID: 1 };
+
+function escapeXml(text) {
+  return text.replace(/&/g, '&amp;').replace(/</g, '&lt;').replace(/>/g, '&gt;').replace(/"/g, '&quot;');
+}
+
+function trackTime(seconds) {
+  seconds = Math.floor(seconds);
+  var mm = Math.floor(seconds / 60) % 60, ss = seconds % 60;
+  return Math.floor(seconds / 3600) + ':' + (mm < 10 ? '0' : '') + mm + ':' + (ss < 10 ? '0' : '') + ss;
+}
+
+function speakerPosition() {
+  var elapsed = speaker.transport === 'PLAYING' ? (Date.now() - speaker.positionAt) / 1000 : 0;
+  return Math.min(speaker.position + elapsed, TRACKS[speaker.track].duration);
+}
+
+function seekTo(track, position) {
+  speaker.track = (track + TRACKS.length) % TRACKS.length;
+  speaker.position = position;
+  speaker.positionAt = Date.now();
+}
+
+function unescapeXml(text) {
+  return text.replace(/&lt;/g, '<').replace(/&gt;/g, '>').replace(/&quot;/g, '"').replace(/&amp;/g, '&');
+}
+
+function requestValue(request, tag) {
+  var match = new RegExp('<' + tag + '>([^<]*)</' + tag + '>').exec(request);
+  return match ? unescapeXml(match[1]) : '';
+}
+
+// Queue tracks cycle through TRACKS; favorites carry their DIDL-Lite in resMD, escaped once more inside the item
+function browseItem(objectID, index) {
+  if (objectID === 'Q:0') {
+    var track = TRACKS[index % TRACKS.length];
+    return '<item id="Q:0/' + (index + 1) + '" parentID="Q:0" restricted="true"><res protocolInfo="x-file-cifs:*:audio/flac:*">' +
+           'x-file-cifs://nas/' + index + '.flac</res><dc:title>' + escapeXml(track.title) + '</dc:title>' +
+           '<upnp:class>object.item.audioItem.musicTrack</upnp:class><dc:creator>' + escapeXml(track.artist) +
+           '</dc:creator><upnp:album>' + escapeXml(track.album) + '</upnp:album></item>';
+  }
+  var favorite = FAVORITES[index];
+  var resMD = '<DIDL-Lite xmlns:dc="http://purl.org/dc/elements/1.1/"><item id="' + index + '"><dc:title>' +
+              escapeXml(favorite.title) + '</dc:title><upnp:class>' + favorite.upnpClass + '</upnp:class></item></DIDL-Lite>';
+  return '<item id="FV:2/' + index + '" parentID="FV:2" restricted="false"><dc:title>' + escapeXml(favorite.title) +
+         '</dc:title><upnp:class>object.itemobject.item.sonos-favorite</upnp:class><res protocolInfo="*:*:*:*">' +
+         escapeXml(favorite.uri) + '</res><r:description>' + escapeXml(favorite.description) + '</r:description>' +
+         '<r:resMD>' + escapeXml(resMD) + '</r:resMD></item>';
+}
+
+function browseResponse(request) {
+  var objectID = requestValue(request, 'ObjectID');
+  var total = objectID === 'Q:0' ? speaker.queueLength : objectID === 'FV:2' ? FAVORITES.length : 0;
+  var start = parseInt(requestValue(request, 'StartingIndex'), 10);
+  var end = Math.min(total, start + parseInt(requestValue(request, 'RequestedCount'), 10));
+  var items = '';
+  for (var i = start; i < end; i++) items += browseItem(objectID, i);
+  var didl = '<DIDL-Lite xmlns:dc="http://purl.org/dc/elements/1.1/" xmlns:upnp="urn:schemas-upnp-org:metadata-1-0/upnp/" ' +
+             'xmlns:r="urn:schemas-rinconnetworks-com:metadata-1-0/">' + items + '</DIDL-Lite>';
+  return envelope('Browse', '<Result>' + escapeXml(didl) + '</Result><NumberReturned>' + Math.max(end - start, 0) +
+                  '</NumberReturned><TotalMatches>' + total + '</TotalMatches><UpdateID>' +
+                  (objectID === 'Q:0' ? speaker.queueUpdateID : 1) + '</UpdateID>');
+}
+
+function envelope(action, body) {
+  return '<s:Envelope xmlns:s="http://schemas.xmlsoap.org/soap/envelope/"><s:Body><u:' + action +
+         'Response xmlns:u="urn:schemas-upnp-org:service:AVTransport:1">' + body + '</u:' + action +
+         'Response></s:Body></s:Envelope>';
+}
+
+function answer(action, request) {
+  var track = TRACKS[speaker.track];
+  switch (action) {
+    case 'GetZoneGroupState': {
+      var state = '<ZoneGroups><ZoneGroup Coordinator="RINCON_E2E1400" ID="RINCON_E2E1400:1">' +
+                  '<ZoneGroupMember UUID="RINCON_E2E1400" Location="http://' + speaker.host +
+                  '/xml/device_description.xml" ZoneName="Living Room"/></ZoneGroup></ZoneGroups>';
+      return envelope(action, '<ZoneGroupState>' + escapeXml(state) + '</ZoneGroupState>');
+    }
+    case 'GetTransportInfo':
+      return envelope(action, '<CurrentTransportState>' + speaker.transport + '</CurrentTransportState>');
+    case 'GetPositionInfo': {
+      var didl = '<DIDL-Lite><item><dc:title>' + escapeXml(track.title) + '</dc:title><dc:creator>' +
+                 escapeXml(track.artist) + '</dc:creator><upnp:album>' + escapeXml(track.album) + '</upnp:album>' +
+                 (track.art !== undefined ? '<upnp:albumArtURI>' + escapeXml(coverURI(track.art)) + '</upnp:albumArtURI>' : '') +
+                 '</item></DIDL-Lite>';
+      return envelope(action, '<Track>' + (speaker.track + 1) + '</Track><TrackDuration>' + trackTime(track.duration) +
+                      '</TrackDuration><TrackMetaData>' + escapeXml(didl) + '</TrackMetaData><TrackURI>x-file-cifs://nas/' +
+                      speaker.track + '.flac</TrackURI><RelTime>' + trackTime(speakerPosition()) + '</RelTime>');
+    }
+    case 'GetVolume':
+      return envelope(action, '<CurrentVolume>' + speaker.volume + '</CurrentVolume>');
+    case 'SetVolume':
+      speaker.volume = parseInt(/<DesiredVolume>(\d+)<\/DesiredVolume>/.exec(request)[1], 10);
+      return envelope(action, '');
+    case 'Play':
+      if (speaker.transport !== 'PLAYING') { speaker.position = speakerPosition(); speaker.positionAt = Date.now(); }
+      speaker.transport = 'PLAYING';
+      return envelope(action, '');
+    case 'Pause':
+      speaker.position = speakerPosition();
+      speaker.transport = 'PAUSED_PLAYBACK';
+      return envelope(action, '');
+    case 'Next':
+      seekTo(speaker.track + 1, 0);
+      return envelope(action, '');
+    case 'Previous':
+      seekTo(speaker.track - 1, 0);
+      return envelope(action, '');
+    case 'Browse':
+      return browseResponse(request);
+    case 'SetAVTransportURI':
+      speaker.uri = requestValue(request, 'CurrentURI');
+      speaker.transport = 'STOPPED';
+      return envelope(action, '');
+    case 'Seek': {
+      if (requestValue(request, 'Unit') === 'REL_TIME') {
+        var time = requestValue(request, 'Target').split(':').map(function(part) { return parseInt(part, 10); });
+        var seconds = time[0] * 3600 + time[1] * 60 + time[2];
+        if (!(seconds >= 0 && seconds <= track.duration)) return null;
+        seekTo(speaker.track, seconds);
+        return envelope(action, '');
+      }
+      var target = parseInt(requestValue(request, 'Target'), 10);
+      if (requestValue(request, 'Unit') !== 'TRACK_NR' || !(target >= 1 && target <= speaker.queueLength)) return null;
+      speaker.queueTrack = target;
+      seekTo(target - 1, 0);
+      return envelope(action, '');
+    }
+    case 'AddURIToQueue': {
+      var first = speaker.queueLength + 1;
+      speaker.queueLength += ALBUM_LENGTH;
+      speaker.queueUpdateID++;
+      return envelope(action, '<FirstTrackNumberEnqueued>' + first + '</FirstTrackNumberEnqueued><NumTracksAdded>' +
+                      ALBUM_LENGTH + '</NumTracksAdded><NewQueueLength>' + speaker.queueLength + '</NewQueueLength>');
+    }
+    default:
+      return null;
+  }
+}
+
+function startSpeaker(done) {
+  speaker.server = http.createServer(function(req, res) {
+    if (/^\/getaa\?/.test(req.url)) { serveCover(req, res); return; }
+    var parts = [];
+    req.on('data', function(part) { parts.push(part); });
+    req.on('end', function() {
+      speaker.requests++;
+      var action = String(req.headers.soapaction || '').replace(/^.*#/, '');
+      speaker.open++;
+      speaker.maxOpen = Math.max(speaker.maxOpen, speaker.open);
+      res.on('close', function() {
+        speaker.open--;
+        if (action === 'Seek') speaker.seekAnsweredAt = Date.now();
+      });
+      // A faulty speaker never answers, resets the connection, or is slow
+      if (speaker.fault === 'stall') { speaker.actions.push({ action: action, at: Date.now() }); return; }
+      if (speaker.fault === 'drop') { speaker.actions.push({ action: action, at: Date.now() }); req.socket.destroy(); return; }
+      // Answered after the speaker's latency, but acted on as it would be: when the request arrives
+      var body = answer(action, Buffer.concat(parts).toString());
+      speaker.actions.push({ action: action, at: Date.now() });
+      setTimeout(function() {
+        res.writeHead(body ? 200 : 500, { 'Content-Type': 'text/xml' });
+        res.end(body || '');
+      }, speaker.fault === 'slow' && (!speaker.slowAction || speaker.slowAction === action) ? speaker.slowMs || FAULT_SLOW_MS : SPEAKER_MS);
+    });
+  });
+  speaker.server.listen(0, '127.0.0.1', function() {
+    speaker.port = speaker.server.address().port;
+    speaker.host = '127.0.0.1:1400';
+    done();
+  });
+}
+
+// PebbleKit JS environment
+
+function XMLHttpRequest() {
+  this.readyState = 0;
+  this.status = 0;
+  this.responseText = '';
+  this.response = null;
+  this.responseType = '';
+  this.timeout = 0;
+  this.headers = {};
+}
+XMLHttpRequest.prototype.open = function(method, url) { this.method = method; this.url = url; };
+XMLHttpRequest.prototype.setRequestHeader = function(name, value) { this.headers[name] = value; };
+XMLHttpRequest.prototype.overrideMimeType = function() {};
+XMLHttpRequest.prototype.abort = function() {
+  this.aborted = true;
+  if (this.req) this.req.destroy();
+};
+XMLHttpRequest.prototype.send = function(body) {
+  var xhr = this;
+  var match = /^http:\/\/([^:\/]+):(\d+)(\/.*)$/.exec(xhr.url);
+  // The mock answers for port 1400, where a Sonos speaker listens
+  var req = http.request({ host: match[1], port: match[2] === '1400' ? speaker.port : match[2], path: match[3], method: xhr.method, headers: xhr.headers }, function(res) {
+    var parts = [];
+    xhr.readyState = 2;
+    if (xhr.onreadystatechange) xhr.onreadystatechange();
+    res.on('data', function(part) { parts.push(part); });
+    res.on('end', function() {
+      var data = Buffer.concat(parts);
+      xhr.readyState = 4;
+      xhr.status = res.statusCode;
+      xhr.responseText = data.toString('latin1');
+      xhr.response = xhr.responseType === 'arraybuffer' ? data.buffer.slice(data.byteOffset, data.byteOffset + data.length) : xhr.responseText;
+      if (xhr.onreadystatechange) xhr.onreadystatechange();
+      if (xhr.onload) xhr.onload();
+    });
+  });
+  xhr.req = req;
+  req.on('error', function() { if (xhr.onerror && !xhr.aborted) xhr.onerror(); });
+  if (xhr.timeout) req.setTimeout(xhr.timeout, function() { req.abort(); if (xhr.ontimeout) xhr.ontimeout(); });
+  req.end(body || undefined);
+};
+
+var storage = {};
+var localStorage = {
+  getItem: function(key) { return storage.hasOwnProperty(key) ? storage[key] : null; },
+  setItem: function(key, value) { storage[key] = String(value); },
+  removeItem: function(key) { delete storage[key]; }
+};
+
+function Clay() {}
+Clay.prototype.generateUrl = function() { return 'about:blank'; };
+Clay.prototype.getSettings = function() { return {}; };
+
+// Simulated watch: applies status messages as the watch app does and wakes
+// whoever is waiting for a condition on them
+
+var listeners = {};
+var watch = { state: -1, volume: -1, title: '', health: 0, position: 0, positionAt: 0, duration: 0, positions: 0, received: 0, bytes: 0,
+              alerts: [], waiters: [], traceSeq: 0, echoes: {} };
+var linkDownUntil = 0;  // nothing crosses the link in either direction until then
+var trace = [];
+var traceStart = Date.now();
+
+function traceValue(value) {
+  if (typeof value === 'string') return '"' + value.replace(/\\/g, '\\\\').replace(/"/g, '\\"') + '"';
+  if (Array.isArray(value)) return 'x:' + value.map(function(b) { return (b < 16 ? '0' : '') + b.toString(16); }).join('');
+  return String(value | 0);
+}
+
+// Size of the message as an AppMessage dictionary: a count byte, then a 7 byte header per tuple
+function messageBytes(msg) {
+  return Object.keys(msg).reduce(function(bytes, key) {
+    var value = msg[key];
+    return bytes + 7 + (typeof value === 'string' ? Buffer.byteLength(value) + 1 : Array.isArray(value) ? value.length : 4);
+  }, 1);
+}
+
+function watchReceive(msg) {
+  watch.received++;
+  watch.bytes += messageBytes(msg);
+  if (TRACE_PATH) {
+    trace.push((Date.now() - traceStart) + ' inbox ' + Object.keys(msg).map(function(key) {
+      return (messageKeys[key] || key).trim() + '=' + traceValue(msg[key]);
+    }).join(' '));
+  }
+  if (msg[KEY.KEY_STATUS_PACKED] !== undefined) {
+    watch.state = msg[KEY.KEY_STATUS_PACKED] & 0x0F;
+    watch.volume = (msg[KEY.KEY_STATUS_PACKED] >> 4) & 0x7F;
+    watch.health = 0;
+  }
+  // Full status messages, as the phone sent them before the packed status
+  if (msg[KEY.KEY_STATUS_PLAY_STATE] !== undefined) watch.state = msg[KEY.KEY_STATUS_PLAY_STATE];
+  if (msg[KEY.KEY_STATUS_VOLUME] !== undefined) watch.volume = msg[KEY.KEY_STATUS_VOLUME];
+  if (msg[KEY.KEY_STATUS_TRACK_TITLE] !== undefined) watch.title = msg[KEY.KEY_STATUS_TRACK_TITLE];
+  if (msg[KEY.KEY_STATUS_DURATION] !== undefined) watch.duration = msg[KEY.KEY_STATUS_DURATION];
+  if (msg[KEY.KEY_STATUS_POSITION] !== undefined) {
+    watch.position = msg[KEY.KEY_STATUS_POSITION] * 1000;
+    watch.positionAt = Date.now();
+    watch.positions++;
+  }
+  if (msg[KEY.KEY_STATUS_ERROR_MSG] !== undefined) watch.state = 4;
+  if (msg[KEY.KEY_STATUS_HEALTH] !== undefined) {
+    watch.health = msg[KEY.KEY_STATUS_HEALTH];
+    if (watch.health) watch.state = 4;
+  }
+  if (msg[KEY.KEY_STATUS_ERROR_MSG] !== undefined || msg[KEY.KEY_STATUS_HEALTH]) {
+    watch.alerts.push({ at: Date.now(), text: msg[KEY.KEY_STATUS_ERROR_MSG] || 'health ' + msg[KEY.KEY_STATUS_HEALTH] });
+  }
+  if (msg[KEY.KEY_BROWSE_INDEX] !== undefined && browser) browseReceive(msg);
+  if (msg[KEY.KEY_ART_HASH] !== undefined && ART) artReceive(msg);
+  if ((msg[KEY.KEY_STATUS_PACKED] !== undefined || msg[KEY.KEY_STATUS_PLAY_STATE] !== undefined) && changes.polling) changesStatus();
+  if (msg[KEY.KEY_TRACE_SEQ] !== undefined) {
+    var bytes = msg[KEY.KEY_TRACE_TIMINGS] || [];
+    var phone = [0, 1, 2, 3].map(function(i) { return (bytes[2 * i] | 0) + ((bytes[2 * i + 1] | 0) << 8); });
+    watch.echoes[msg[KEY.KEY_TRACE_SEQ]] = { total: (Date.now() & 0x7FFFFFFF) - msg[KEY.KEY_TRACE_SENT_MS], phone: phone };
+  }
+  // Woken waiters may wait again, so they are taken off the list before they run
+  var woken = watch.waiters.filter(function(waiter) { return waiter.test(); });
+  watch.waiters = watch.waiters.filter(function(waiter) { return woken.indexOf(waiter) === -1; });
+  woken.forEach(function(waiter) { waiter.done(Date.now()); });
+}
+
+var Pebble = {
+  addEventListener: function(name, fn) { (listeners[name] = listeners[name] || []).push(fn); },
+  sendAppMessage: function(msg, ok, fail) {
+    setTimeout(function() {
+      var refused = STATUS_RUN ? inboxRefuses(msg) : Date.now() < linkDownUntil ? 'APP_MSG_SEND_TIMEOUT' : null;
+      if (refused) {
+        if (msg[KEY.KEY_ART_DATA] !== undefined) artResults.lost++;
+        setTimeout(function() { if (fail) fail({ data: msg, error: refused }); }, LINK_MS);
+        return;
+      }
+      watchReceive(msg);
+      if (ok) ok({ data: msg });
+    }, LINK_MS);
+  },
+  getActiveWatchInfo: function() { return { platform: 'basalt' }; },
+  openURL: function() {}
+};
+
+function emit(name, event) {
+  (listeners[name] || []).forEach(function(fn) { fn(event); });
+}
+
+function waitFor(test, done, timeoutMs) {
+  if (test()) { done(Date.now()); return; }
+  var waiter = { test: test, done: done };
+  watch.waiters.push(waiter);
+  setTimeout(function() {
+    var i = watch.waiters.indexOf(waiter);
+    if (i === -1) return;
+    watch.waiters.splice(i, 1);
+    done(null);
+  }, timeoutMs || TIMEOUT_MS);
+}
+
+function watchPost(payload) {
+  if (TRACE_PATH) {
+    trace.push('# ' + (Date.now() - traceStart) + ' watch sent ' + Object.keys(payload).map(function(key) {
+      return messageKeys[key].trim() + '=' + payload[key];
+    }).join(' '));
+  }
+  setTimeout(function() { if (Date.now() >= linkDownUntil) emit('appmessage', { payload: payload }); }, LINK_MS);
+}
+
+// Commands carry a trace sequence number and the watch clock, as the watch app sends them
+function watchSend(key, value) {
+  var payload = {};
+  payload[key] = value;
+  payload[KEY.KEY_TRACE_SEQ] = ++watch.traceSeq;
+  payload[KEY.KEY_TRACE_SENT_MS] = Date.now() & 0x7FFFFFFF;
+  watchPost(payload);
+  return watch.traceSeq;
+}
+
+// Button presses go into the trace as they happen, for the replay to drive the watch app the same way
+function watchButton(event) {
+  if (TRACE_PATH) trace.push((Date.now() - traceStart) + ' ' + event);
+}
+
+function loadApp() {
+  var source = fs.readFileSync(PHONE, 'utf8');
+  var console_ = VERBOSE ? console : { log: function() {} };
+  var pkjsRequire = function(name) { return name === 'pebble-clay' ? Clay : require(path.join(PKJS, name)); };
+  var module_ = { exports: {} };
+  new Function('require', 'module', 'exports', 'Pebble', 'localStorage', 'XMLHttpRequest', 'console', source)(
+    pkjsRequire, module_, module_.exports, Pebble, localStorage, XMLHttpRequest, console_);
+}
+
+// Benchmark
+
+var COMMANDS = [
+  { name: 'pause', key: 'KEY_CMD_PAUSE', action: 'Pause', shown: function() { return watch.state === 2; } },
+  { name: 'play', key: 'KEY_CMD_PLAY', action: 'Play', shown: function() { return watch.state === 1; } },
+  { name: 'next', key: 'KEY_CMD_NEXT_TRACK', action: 'Next', shown: function() { return watch.title === TRACKS[speaker.track].title; } },
+  { name: 'previous', key: 'KEY_CMD_PREV_TRACK', action: 'Previous', shown: function() { return watch.title === TRACKS[speaker.track].title; } },
+  { name: 'volume up', key: 'KEY_CMD_VOL_UP', action: 'SetVolume', shown: null }
+];
+
+var results = {};
+COMMANDS.forEach(function(command) { results[command.name] = { speaker: [], watch: [], requests: 0, messages: 0, traces: [] }; });
+var startups = [];
+
+function percentile(values, p) {
+  if (values.length === 0) return '-';
+  var sorted = values.slice().sort(function(a, b) { return a - b; });
+  return sorted[Math.min(sorted.length - 1, Math.floor(p * sorted.length))];
+}
+
+function startup(callback) {
+  var started = Date.now();
+  watch.title = '';
+  emit('ready', {});
+  waitFor(function() { return watch.title !== ''; }, function(at) {
+    startups.push(at === null ? null : at - started);
+    setTimeout(callback, SETTLE_MS);
+  });
+}
+
+function runCommand(command, callback) {
+  var result = results[command.name];
+  var started = Date.now();
+  var requests = speaker.requests, messages = watch.received, seq = 0;
+  function finish() {
+    var count = -1, changedAt = 0;
+    (function quiet() {
+      if (speaker.requests + watch.received !== count) { count = speaker.requests + watch.received; changedAt = Date.now(); }
+      if (Date.now() - changedAt < QUIET_MS && Date.now() - started < 2 * TIMEOUT_MS) { setTimeout(quiet, 10); return; }
+      if (watch.echoes[seq]) result.traces.push(watch.echoes[seq]);
+      result.requests += speaker.requests - requests;
+      result.messages += watch.received - messages;
+      callback();
+    })();
+  }
+  // The speaker acts when the request arrives; only then can a status show the result
+  (function poll() {
+    for (var i = speaker.actions.length - 1; i >= 0 && speaker.actions[i].at >= started; i--) {
+      if (speaker.actions[i].action === command.action) {
+        result.speaker.push(speaker.actions[i].at - started);
+        if (!command.shown) { finish(); return; }
+        waitFor(command.shown, function(at) {
+          if (at !== null) result.watch.push(at - started);
+          finish();
+        });
+        return;
+      }
+    }
+    if (Date.now() - started > TIMEOUT_MS) { finish(); return; }
+    setTimeout(poll, 1);
+  })();
+  seq = watchSend(KEY[command.key], 1);
+}
+
+function runAll(run, callback) {
+  if (run === RUNS) { callback(); return; }
+  startup(function() {
+    (function next(i) {
+      if (i === COMMANDS.length) { runAll(run + 1, callback); return; }
+      runCommand(COMMANDS[i], function() { next(i + 1); });
+    })(0);
+  });
+}
+
+function report() {
+  console.log('Link ' + LINK_MS + ' ms each way, speaker ' + SPEAKER_MS + ' ms per request, ' + RUNS + ' runs');
+  console.log('Startup to first status: ' + startups[0] + ' ms cold, ' +
+              percentile(startups.slice(1), 0.5) + ' ms warm (median)');
+  console.log('command       speaker p50/p95     watch p50/p95   SOAP req   status msgs');
+  COMMANDS.forEach(function(command) {
+    var result = results[command.name];
+    var speakerCol = percentile(result.speaker, 0.5) + '/' + percentile(result.speaker, 0.95) + ' ms';
+    var watchCol = command.shown ? percentile(result.watch, 0.5) + '/' + percentile(result.watch, 0.95) + ' ms' : 'optimistic';
+    console.log(('  ' + command.name + '             ').substring(0, 14) + ('                  ' + speakerCol).slice(-18) +
+                ('                  ' + watchCol).slice(-18) + ('           ' + (result.requests / RUNS).toFixed(1)).slice(-11) +
+                ('             ' + (result.messages / RUNS).toFixed(1)).slice(-14));
+  });
+  console.log('Traced (p50 ms)  round trip   link  queue  first byte  transfer  status');
+  COMMANDS.forEach(function(command) {
+    var traces = results[command.name].traces;
+    var cols = [percentile(traces.map(function(t) { return t.total; }), 0.5),
+                percentile(traces.map(function(t) { return t.total - t.phone.reduce(function(a, b) { return a + b; }); }), 0.5)];
+    [0, 1, 2, 3].forEach(function(i) { cols.push(percentile(traces.map(function(t) { return t.phone[i]; }), 0.5)); });
+    var widths = [13, 7, 7, 12, 10, 8];
+    console.log(('  ' + command.name + '             ').substring(0, 14) + cols.map(function(col, i) {
+      return ('             ' + col).slice(-widths[i]);
+    }).join(''));
+  });
+}
+
+// Browse scenario. The simulated watch keeps the watch app's ring of rows and
+// asks for one window at a time: the one under the selection, then the next
+// one in the direction of scrolling.
+
+var BROWSE_WINDOW = 4;          // rows per request: a basalt screen of 44 px rows, plus one
+var BROWSE_RING = 16;           // BROWSE_RING_ROWS in the watch app
+var ZONE_PICKER_HOLD_MS = 1100; // long enough for the zone picker, which lists the browsers under the zones
+var SCROLL_REPEAT_MS = 150;     // repeating click on a held button
+var SCROLL_DOWN = 120;
+var SCROLL_UP = 40;
+
+var browser = null;
+var browseResults = {};
+
+function browseRow(index) {
+  var row = browser.ring[index % BROWSE_RING];
+  return row && row.index === index ? row : null;
+}
+
+function browseWindowLoaded(start) {
+  if (browser.total < 0) return false;
+  for (var i = start; i < start + BROWSE_WINDOW && i < browser.total; i++) if (!browseRow(i)) return false;
+  return true;
+}
+
+function browseWanted() {
+  var start = browser.selected - browser.selected % BROWSE_WINDOW;
+  if (!browseWindowLoaded(start)) return start;
+  var ahead = start + browser.direction * BROWSE_WINDOW;
+  if (browser.direction && ahead >= 0 && ahead < browser.total && !browseWindowLoaded(ahead)) return ahead;
+  return -1;
+}
+
+function browseFetch() {
+  if (browser.pending >= 0 || browser.total === 0) return;
+  var start = browseWanted();
+  if (start < 0) return;
+  browser.pending = start;
+  var payload = {};
+  payload[KEY.KEY_CMD_BROWSE] = browser.source;
+  payload[KEY.KEY_BROWSE_INDEX] = start;
+  payload[KEY.KEY_BROWSE_COUNT] = BROWSE_WINDOW;
+  payload[KEY.KEY_BROWSE_DIRECTION] = browser.direction;
+  watchPost(payload);
+}
+
+function browseReceive(msg) {
+  var index = msg[KEY.KEY_BROWSE_INDEX], total = msg[KEY.KEY_BROWSE_COUNT];
+  if (msg[KEY.KEY_BROWSE_SOURCE] !== browser.source) return;
+  if (total <= 0) { browser.total = 0; browser.pending = -1; return; }
+  if (browser.total >= 0 && total !== browser.total) browser.ring = {};
+  browser.total = total;
+  browser.ring[index % BROWSE_RING] = { index: index, title: msg[KEY.KEY_BROWSE_TITLE] };
+  if (!browser.firstRow) browser.firstRow = Date.now() - browser.opened;
+  if (!browser.firstWindow && browseWindowLoaded(0)) browser.firstWindow = Date.now() - browser.opened;
+  if (index === browser.selected && browser.waitingSince) {
+    browser.waits.push(Date.now() - browser.waitingSince);
+    browser.waitingSince = 0;
+  }
+  if (browser.pending >= 0 && (index === browser.pending + BROWSE_WINDOW - 1 || index === total - 1)) {
+    browser.pending = -1;
+    browseFetch();
+  }
+}
+
+function browseMove(delta) {
+  var selected = Math.max(0, Math.min(browser.total - 1, browser.selected + delta));
+  if (selected === browser.selected) return;
+  browser.direction = selected > browser.selected ? 1 : -1;
+  browser.selected = selected;
+  browser.moves++;
+  if (!browseRow(selected)) { browser.placeholders++; if (!browser.waitingSince) browser.waitingSince = Date.now(); }
+  browseFetch();
+}
+
+function countActions(action, since) {
+  return speaker.actions.filter(function(entry) { return entry.action === action && entry.at >= since; }).length;
+}
+
+// Hold select for the zone picker, step down past the zone rows to the source and open it
+function browseOpen(source, callback) {
+  watchButton('hold select ' + ZONE_PICKER_HOLD_MS);
+  setTimeout(function() {
+    for (var i = 0; i <= source; i++) watchButton('click down');
+    watchButton('click select');
+    browser = { source: source, ring: {}, total: -1, pending: -1, direction: 0, selected: 0, opened: Date.now(),
+                firstRow: 0, firstWindow: 0, moves: 0, placeholders: 0, waitingSince: 0, waits: [] };
+    browseFetch();
+    waitFor(function() { return browser.firstWindow > 0 || browser.total === 0; }, function() {
+      setTimeout(function() { callback(countActions('Browse', browser.opened)); }, SETTLE_MS);
+    });
+  }, ZONE_PICKER_HOLD_MS);
+}
+
+function browseScroll(delta, count, callback) {
+  (function step(i) {
+    if (i === count) { setTimeout(callback, SETTLE_MS); return; }
+    watchButton(delta > 0 ? 'click down' : 'click up');
+    browseMove(delta);
+    setTimeout(function() { step(i + 1); }, SCROLL_REPEAT_MS);
+  })(0);
+}
+
+// Select the row under the cursor and wait for the speaker to reach it
+function browsePlay(done, callback) {
+  var started = Date.now(), index = browser.selected;
+  watchButton('click select');
+  var payload = {};
+  payload[KEY.KEY_CMD_BROWSE_PLAY] = browser.source;
+  payload[KEY.KEY_BROWSE_INDEX] = index;
+  watchPost(payload);
+  (function poll() {
+    if (done(index)) { callback(Date.now() - started); return; }
+    if (Date.now() - started > TIMEOUT_MS) { callback(null); return; }
+    setTimeout(poll, 1);
+  })();
+}
+
+function runBrowse(callback) {
+  startup(function() {
+    browseOpen(0, function(openRequests) {
+      var queue = browseResults.queue = { total: browser.total, firstRow: browser.firstRow, firstWindow: browser.firstWindow, openRequests: openRequests };
+      var scrollStart = Date.now();
+      browseScroll(1, SCROLL_DOWN, function() {
+        browseScroll(-1, SCROLL_UP, function() {
+          queue.moves = browser.moves;
+          queue.placeholders = browser.placeholders;
+          queue.waits = browser.waits;
+          queue.scrollRequests = countActions('Browse', scrollStart);
+          queue.target = browser.selected + 1;
+          browsePlay(function(index) { return speaker.queueTrack === index + 1 && speaker.transport === 'PLAYING'; }, function(ms) {
+            queue.playMs = ms;
+            setTimeout(function() {
+              browseOpen(1, function(openRequests) {
+                var favorites = browseResults.favorites = { total: browser.total, firstRow: browser.firstRow, firstWindow: browser.firstWindow, openRequests: openRequests };
+                var queueLength = speaker.queueLength;
+                browseScroll(1, 1, function() {
+                  browsePlay(function() { return speaker.queueTrack === queueLength + 1 && speaker.transport === 'PLAYING'; }, function(ms) {
+                    favorites.playMs = ms;
+                    setTimeout(callback, SETTLE_MS);
+                  });
+                });
+              });
+            }, SETTLE_MS);
+          });
+        });
+      });
+    });
+  });
+}
+
+function browseReport() {
+  var queue = browseResults.queue, favorites = browseResults.favorites;
+  console.log('Link ' + LINK_MS + ' ms each way, speaker ' + SPEAKER_MS + ' ms per request, ' + BROWSE_WINDOW + ' rows per window');
+  console.log('Queue (' + queue.total + ' tracks): first row ' + queue.firstRow + ' ms, first screen ' + queue.firstWindow +
+              ' ms, ' + queue.openRequests + ' Browse request(s) to open');
+  console.log('  scrolled ' + queue.moves + ' rows every ' + SCROLL_REPEAT_MS + ' ms: ' + queue.scrollRequests + ' Browse requests, ' +
+              queue.placeholders + ' rows shown loading (' + (100 * queue.placeholders / Math.max(queue.moves, 1)).toFixed(1) +
+              '%), waited p50/p95 ' + percentile(queue.waits, 0.5) + '/' + percentile(queue.waits, 0.95) + ' ms');
+  console.log('  jump to track ' + queue.target + ': playing after ' + queue.playMs + ' ms');
+  console.log('Favorites (' + favorites.total + '): first row ' + favorites.firstRow + ' ms, first screen ' + favorites.firstWindow +
+              ' ms, ' + favorites.openRequests + ' Browse request(s) to open');
+  console.log('  album favorite queued and playing after ' + favorites.playMs + ' ms');
+}
+
+// Fault scenario. The simulated watch polls every FAULT_POLL_MS whatever it
+// is shown, the worst case for the phone, while the speaker goes through the
+// phases below; a user command is sent part way through some of them.
+
+var FAULT_POLL_MS = 5000;
+var FAULT_SLOW_MS = 1500;       // slow, but inside the deadline of every action the status poll makes
+var FAULT_PHASES = [
+  { name: 'healthy', fault: null, ms: 8000 },
+  { name: 'slow', fault: 'slow', ms: 12000, command: 6000 },
+  { name: 'stall', fault: 'stall', ms: 25000, command: 15000 },
+  { name: 'drop', fault: 'drop', ms: 10000, command: 5000 },
+  { name: 'recovered', fault: null, ms: 40000, command: 30000 }
+];
+
+var faultResults = [];
+
+function faultCommand(phase) {
+  var started = Date.now(), pauses = countActions('Pause', started);
+  var state = watch.state;
+  watchButton('click select');
+  watchSend(KEY.KEY_CMD_PAUSE, 1);
+  waitFor(function() { return watch.state === 2; }, function(at) {
+    phase.commandMs = at === null ? null : at - started;
+    phase.commandReached = countActions('Pause', started) > pauses;
+    phase.commandState = state;
+    // Back to playing for the next phase
+    if (at !== null) watchSend(KEY.KEY_CMD_PLAY, 1);
+  });
+}
+
+function runFaults(callback) {
+  var poller = setInterval(function() { watchSend(KEY.KEY_CMD_GET_STATUS, 1); }, FAULT_POLL_MS);
+  startup(function() {
+    (function next(i) {
+      if (i === FAULT_PHASES.length) { clearInterval(poller); callback(); return; }
+      var spec = FAULT_PHASES[i];
+      var phase = { name: spec.name, started: Date.now(), requests: speaker.requests, alerts: watch.alerts.length, received: watch.received,
+                    healthAt: null, okAt: null };
+      faultResults.push(phase);
+      speaker.fault = spec.fault;
+      if (spec.command) setTimeout(function() { faultCommand(phase); }, spec.command);
+      // Longer than waitFor would wait: recovery waits on the breaker's probe
+      var watcher = setInterval(function() {
+        if (phase.healthAt === null && watch.health !== 0) phase.healthAt = Date.now();
+        if (phase.okAt === null && watch.health === 0 && watch.state !== 4) phase.okAt = Date.now();
+      }, 1);
+      setTimeout(function() {
+        clearInterval(watcher);
+        phase.requests = speaker.requests - phase.requests;
+        phase.messages = watch.received - phase.received;
+        phase.alerts = watch.alerts.slice(phase.alerts);
+        next(i + 1);
+      }, spec.ms);
+    })(0);
+  });
+}
+
+function faultReport() {
+  console.log('Link ' + LINK_MS + ' ms each way, watch polls every ' + FAULT_POLL_MS + ' ms, slow speaker ' + FAULT_SLOW_MS + ' ms per request');
+  console.log('phase        length  SOAP req  watch msgs  alerts  first alert  watch OK   pause shown');
+  faultResults.forEach(function(phase) {
+    var spec = FAULT_PHASES.filter(function(p) { return p.name === phase.name; })[0];
+    var first = phase.alerts.length ? (phase.alerts[0].at - phase.started) + ' ms' : '-';
+    var ok = phase.okAt !== null && (phase.healthAt === null || phase.okAt >= phase.healthAt) ? (phase.okAt - phase.started) + ' ms' : '-';
+    var command = !spec.command ? '-' : phase.commandMs !== null ? phase.commandMs + ' ms' :
+                  phase.commandReached ? 'not shown' : 'failed fast';
+    console.log(('  ' + phase.name + '            ').substring(0, 13) + ('       ' + spec.ms / 1000 + ' s').slice(-7) +
+                ('          ' + phase.requests).slice(-10) + ('            ' + phase.messages).slice(-12) +
+                ('        ' + phase.alerts.length).slice(-8) + ('             ' + first).slice(-13) + ('           ' + ok).slice(-11) +
+                '   ' + command);
+    phase.alerts.forEach(function(alert) { console.log('      +' + (alert.at - phase.started) + ' ms: ' + alert.text); });
+  });
+  console.log('Peak requests open at the speaker: ' + speaker.maxOpen);
+}
+
+// Scrub scenario. The simulated watch keeps its own track position and steps
+// a scrub target as the watch app does (SCRUB_* there), sending the target
+// once the clicks have stopped for SCRUB_COMMIT_MS.
+
+var MIX = { title: 'Essential Mix', artist: 'Various Artists', album: 'BBC Radio 1', duration: 2 * 3600 };
+var SCRUB_STEP_MS = 5000;
+var SCRUB_STEP_MAX_MS = 60000;
+var SCRUB_ACCEL_CLICKS = 8;
+var SCRUB_COMMIT_MS = 600;
+var SCRUB_HOLD_MS = 10000;
+var MODE_HOLD_MS = 600;         // a long press short of the zone picker, switching the up/down mode
+var SCRUB_BURSTS = 4;           // quick scrubs of a click each against the slow speaker
+var SCRUB_SLOW_MS = 2500;       // slow, but inside the Seek deadline
+
+var scrub = { target: -1, clicks: 0, timer: null, sent: [] };
+var scrubResults = {};
+
+function watchPosition() {
+  return watch.position + (watch.state === 1 ? Date.now() - watch.positionAt : 0);
+}
+
+function scrubStep(direction) {
+  watchButton(direction > 0 ? 'click up' : 'click down');
+  if (scrub.target < 0) scrub.target = watchPosition();
+  var step = Math.min(SCRUB_STEP_MS * (1 + Math.floor(scrub.clicks / SCRUB_ACCEL_CLICKS)), SCRUB_STEP_MAX_MS);
+  scrub.clicks++;
+  scrub.target = Math.max(0, Math.min((MIX.duration - 1) * 1000, scrub.target + direction * step));
+  clearTimeout(scrub.timer);
+  scrub.timer = setTimeout(function() {
+    var seconds = Math.floor(scrub.target / 1000);
+    watch.position = scrub.target;
+    watch.positionAt = Date.now();
+    scrub.target = -1;
+    scrub.clicks = 0;
+    scrub.sent.push({ seconds: seconds, at: Date.now() });
+    var payload = {};
+    payload[KEY.KEY_CMD_SEEK] = seconds;
+    watchPost(payload);
+  }, SCRUB_COMMIT_MS);
+}
+
+function scrubHold(direction, ms, callback) {
+  var started = Date.now();
+  (function step() {
+    if (Date.now() - started >= ms) { setTimeout(callback, SCRUB_COMMIT_MS); return; }
+    scrubStep(direction);
+    setTimeout(step, SCROLL_REPEAT_MS);
+  })();
+}
+
+// Wait for the first status carrying a position after the speaker answered its last Seek, and compare the
+// position the watch then shows with the speaker's
+function scrubSettle(since, callback) {
+  (function poll() {
+    var settled = speaker.open === 0 && speaker.seekAnsweredAt >= since && watch.positionAt > speaker.seekAnsweredAt;
+    if (!settled && Date.now() - since < SCRUB_HOLD_MS + TIMEOUT_MS) { setTimeout(poll, 1); return; }
+    callback({ seeks: countActions('Seek', since), statusMs: settled ? watch.positionAt - since : null,
+               errorMs: settled ? Math.round(watchPosition() - speakerPosition() * 1000) : null, speaker: speakerPosition() });
+  })();
+}
+
+function runScrub(callback) {
+  TRACKS.push(MIX);
+  seekTo(TRACKS.length - 1, 600);
+  startup(function() {
+    // Volume, then track, then scrub mode
+    watchButton('hold select ' + MODE_HOLD_MS);
+    setTimeout(function() { watchButton('hold select ' + MODE_HOLD_MS); }, MODE_HOLD_MS + SCROLL_REPEAT_MS);
+    setTimeout(scrubFromHere, 2 * (MODE_HOLD_MS + SCROLL_REPEAT_MS));
+  });
+  function scrubFromHere() {
+    var holdStarted = Date.now(), from = speakerPosition();
+    scrubHold(1, SCRUB_HOLD_MS, function() {
+      scrubResults.hold = { clicks: Math.round(SCRUB_HOLD_MS / SCROLL_REPEAT_MS), from: from, sent: scrub.sent.length,
+                            target: scrub.sent.length ? scrub.sent[scrub.sent.length - 1].seconds : null };
+      scrubSettle(holdStarted, function(settled) {
+        scrubResults.hold.settled = settled;
+        setTimeout(function() {
+          // Clicks back, each sent before the Seek for the one before can finish
+          speaker.fault = 'slow';
+          speaker.slowMs = SCRUB_SLOW_MS;
+          speaker.slowAction = 'Seek';
+          var burstsStarted = Date.now(), sent = scrub.sent.length;
+          (function burst(i) {
+            if (i === SCRUB_BURSTS) {
+              scrubResults.bursts = { sent: scrub.sent.length - sent, target: scrub.sent[scrub.sent.length - 1].seconds };
+              scrubSettle(burstsStarted, function(settled) {
+                scrubResults.bursts.settled = settled;
+                speaker.fault = null;
+                setTimeout(callback, SETTLE_MS);
+              });
+              return;
+            }
+            scrubHold(-1, SCROLL_REPEAT_MS, function() { burst(i + 1); });
+          })(0);
+        }, SETTLE_MS);
+      });
+    });
+  }
+}
+
+function scrubReport() {
+  var hold = scrubResults.hold, bursts = scrubResults.bursts;
+  console.log('Link ' + LINK_MS + ' ms each way, speaker ' + SPEAKER_MS + ' ms per request, ' + MIX.duration / 60 + ' min track');
+  console.log('Held up for ' + SCRUB_HOLD_MS + ' ms (' + hold.clicks + ' clicks): ' + Math.round(hold.from) + ' s -> ' + hold.target + ' s, ' +
+              hold.sent + ' seek(s) sent by the watch, ' + hold.settled.seeks + ' Seek(s) at the speaker');
+  console.log('  status after the Seek ' + hold.settled.statusMs + ' ms after the hold started: watch shows ' +
+              (hold.settled.errorMs >= 0 ? '+' : '') + hold.settled.errorMs + ' ms from the speaker (' + Math.round(hold.settled.speaker) + ' s)');
+  console.log(SCRUB_BURSTS + ' quick scrubs against a speaker taking ' + SCRUB_SLOW_MS + ' ms to seek: ' + bursts.sent + ' targets sent, ' +
+              bursts.settled.seeks + ' Seeks at the speaker, speaker at ' + Math.round(bursts.settled.speaker) + ' s for a final target of ' +
+              bursts.target + ' s, watch ' + (bursts.settled.errorMs >= 0 ? '+' : '') + bursts.settled.errorMs + ' ms from it');
+}
+
+// Changes scenario. Another controller drives the mock speaker at seeded
+// times, the same in every run, and each change waits for the watch to show
+// it until the next one replaces it.
+
+var CHANGES_MS = 120000;
+var CHANGE_GAP_MIN_MS = 6000;
+var CHANGE_GAP_MAX_MS = 24000;  // longer than the watch app's paused poll, so a resume is seen before the next change
+
+var changes = { seed: 1, polling: false, timer: null, polls: 0, made: 0, shown: [], kinds: {} };
+
+function changeRandom() {
+  changes.seed = (changes.seed * 1103515245 + 12345) & 0x7FFFFFFF;
+  return changes.seed / 0x80000000;
+}
+
+function changeGap() {
+  return CHANGE_GAP_MIN_MS + Math.floor(changeRandom() * (CHANGE_GAP_MAX_MS - CHANGE_GAP_MIN_MS));
+}
+
+// next_status_interval_ms() in the watch app, without the error backoff the mock never needs
+function watchPollInterval() {
+  if (POLL_MS) return POLL_MS;
+  switch (watch.state) {
+    case 1: {
+      if (watch.duration <= 0) return 15000;
+      var remaining = watch.duration * 1000 - watchPosition() + 1500;
+      return remaining > 15000 ? 15000 : Math.max(remaining, 1000);
+    }
+    case 2: return 20000;
+    case 0: return 60000;
+    case 3: return 1000;
+    default: return 5000;
+  }
+}
+
+function watchSchedulePoll() {
+  clearTimeout(changes.timer);
+  changes.timer = setTimeout(function() {
+    changes.polls++;
+    watchSend(KEY.KEY_CMD_GET_STATUS, 1);
+    watchSchedulePoll();
+  }, watchPollInterval());
+}
+
+// As status_received() in the watch app: a fresh status picks the next poll from the new state
+function changesStatus() {
+  if (!POLL_MS) watchSchedulePoll();
+}
+
+// One change as another controller would make it, and the test for the watch showing it
+function changeSpeaker() {
+  var pick = changeRandom();
+  if (pick < 0.35) {
+    var step = 5 * (1 + Math.floor(changeRandom() * 3));
+    var volume = speaker.volume + (speaker.volume + step > 90 || (changeRandom() < 0.5 && speaker.volume - step >= 10) ? -step : step);
+    answer('SetVolume', '<DesiredVolume>' + volume + '</DesiredVolume>');
+    return { kind: 'volume', test: function() { return watch.volume === volume; } };
+  }
+  if (pick < 0.7) {
+    answer('Next', '');
+    var title = TRACKS[speaker.track].title;
+    return { kind: 'track', test: function() { return watch.title === title; } };
+  }
+  var playing = speaker.transport !== 'PLAYING';
+  answer(playing ? 'Play' : 'Pause', '');
+  return { kind: playing ? 'play' : 'pause', test: function() { return watch.state === (playing ? 1 : 2); } };
+}
+
+function runChanges(callback) {
+  startup(function() {
+    var started = Date.now();
+    var requests = speaker.requests, messages = watch.received, bytes = watch.bytes;
+    changes.polling = true;
+    watchSchedulePoll();
+    (function wait(gap) {
+      if (Date.now() - started + gap > CHANGES_MS) {
+        setTimeout(function() {
+          changes.polling = false;
+          clearTimeout(changes.timer);
+          var hours = (Date.now() - started) / 3600000;
+          changes.perHour = { polls: changes.polls / hours, requests: (speaker.requests - requests) / hours,
+                              messages: (watch.received - messages) / hours, bytes: (watch.bytes - bytes) / hours };
+          callback();
+        }, started + CHANGES_MS - Date.now());
+        return;
+      }
+      setTimeout(function() {
+        var next = changeGap();
+        var change = changeSpeaker();
+        var at = Date.now();
+        var kind = changes.kinds[change.kind] = changes.kinds[change.kind] || { made: 0, shown: [] };
+        changes.made++;
+        kind.made++;
+        waitFor(change.test, function(shownAt) {
+          if (shownAt === null) return;
+          changes.shown.push(shownAt - at);
+          kind.shown.push(shownAt - at);
+        }, next);
+        wait(next);
+      }, gap);
+    })(changeGap());
+  });
+}
+
+function changesReport() {
+  var perHour = changes.perHour;
+  console.log('Link ' + LINK_MS + ' ms each way, speaker ' + SPEAKER_MS + ' ms per request, ' + (PHONE === path.join(PKJS, 'index.js') ? 'src/pkjs/index.js' : PHONE) +
+              ', watch polls ' + (POLL_MS ? 'every ' + POLL_MS + ' ms' : 'adaptively'));
+  console.log(changes.made + ' changes by another controller in ' + CHANGES_MS / 1000 + ' s, ' + changes.shown.length +
+              ' shown on the watch before the next one');
+  console.log('change      made  shown   to screen p50/p95/max');
+  Object.keys(changes.kinds).sort().concat(['all']).forEach(function(name) {
+    var kind = name === 'all' ? { made: changes.made, shown: changes.shown } : changes.kinds[name];
+    var latency = kind.shown.length ? percentile(kind.shown, 0.5) + '/' + percentile(kind.shown, 0.95) + '/' +
+                  Math.max.apply(null, kind.shown) + ' ms' : '-';
+    console.log(('  ' + name + '          ').substring(0, 10) + ('      ' + kind.made).slice(-6) +
+                ('       ' + kind.shown.length).slice(-7) + ('                          ' + latency).slice(-26));
+  });
+  console.log('Per hour: ' + Math.round(perHour.polls) + ' watch polls, ' + Math.round(perHour.requests) + ' SOAP requests, ' +
+              Math.round(perHour.messages) + ' watch messages (' + Math.round(perHour.bytes / 1024) + ' KiB)');
+}
+
+// Status protocol scenario. The script is fixed rather than seeded so both
+// phones see exactly the same speaker; each phone runs it in a child process,
+// since a loaded index.js cannot be unloaded.
+
+var STATUS_LEGACY_REV = '96d98da';  // the last revision with full-tuple status pushes
+var STATUS_POLL_MS = 5000;
+var STATUS_MS = 66000;
+var WATCH_INBOX_BYTES = 1024;       // app_message_open() in the watch app
+var WATCH_HANDLE_MS = 50;           // assumed: the inbox handler and the redraw it schedules on aplite
+var SLIDER_STEPS = 8;
+var SLIDER_STEP_MS = 200;
+var LONG_TRACK = {
+  title: 'Symphony No. 9 in D minor, Op. 125 Choral: IV. Presto - Allegro assai - Allegro assai vivace (alla marcia) - ' +
+         'Andante maestoso - Allegro energico, sempre ben marcato - Allegro ma non tanto - Prestissimo',
+  artist: 'Anna Tomowa-Sintow, Agnes Baltsa, Peter Schreier, Jose van Dam, Wiener Singverein, Berliner Philharmoniker, ' +
+          'Herbert von Karajan',
+  album: 'Beethoven: The 9 Symphonies (Remastered 2014 from the original 1977 analogue tapes, including rehearsal excerpts)',
+  duration: 1463
+};
+var STATUS_SCRIPT = [
+  [2000, 'track'], [9000, 'slider'], [16000, 'watch volume'], [23000, 'pause'], [30000, 'watch play'],
+  [37000, 'track'], [44000, 'slider'], [51000, 'watch volume'], [58000, 'track']
+];
+
+var inbox = { busyUntil: 0, busy: 0, overflow: 0 };
+
+function inboxRefuses(msg) {
+  if (messageBytes(msg) > WATCH_INBOX_BYTES) { inbox.overflow++; return 'APP_MSG_BUFFER_OVERFLOW'; }
+  if (Date.now() < inbox.busyUntil) { inbox.busy++; return 'APP_MSG_BUSY'; }
+  inbox.busyUntil = Date.now() + WATCH_HANDLE_MS;
+  return null;
+}
+
+// One script event; returns the test for the watch showing its outcome
+function statusEvent(name) {
+  switch (name) {
+    case 'track': {
+      answer('Next', '');
+      var title = TRACKS[speaker.track].title;
+      return function() { return watch.title === title; };
+    }
+    case 'slider': {
+      var target = speaker.volume > 50 ? speaker.volume - SLIDER_STEPS * 2 : speaker.volume + SLIDER_STEPS * 2;
+      var step = target > speaker.volume ? 2 : -2;
+      for (var i = 0; i < SLIDER_STEPS; i++) {
+        setTimeout(function() { answer('SetVolume', '<DesiredVolume>' + (speaker.volume + step) + '</DesiredVolume>'); }, i * SLIDER_STEP_MS);
+      }
+      return function() { return watch.volume === target; };
+    }
+    case 'watch volume': {
+      var volume = speaker.volume;
+      for (var j = 0; j < 3; j++) setTimeout(function() { watchSend(KEY.KEY_CMD_VOL_UP, 1); }, j * SCROLL_REPEAT_MS);
+      return function() { return speaker.volume > volume && watch.volume === speaker.volume; };
+    }
+    case 'pause':
+      answer('Pause', '');
+      return function() { return watch.state === 2; };
+    case 'watch play':
+      watchSend(KEY.KEY_CMD_PLAY, 1);
+      return function() { return watch.state === 1; };
+  }
+}
+
+function runStatus(callback) {
+  TRACKS.splice(1, 0, LONG_TRACK);
+  startup(function() {
+    var started = Date.now();
+    var messages = watch.received, bytes = watch.bytes, shown = [], missed = 0;
+    var poll = setInterval(function() { watchSend(KEY.KEY_CMD_GET_STATUS, 1); }, STATUS_POLL_MS);
+    STATUS_SCRIPT.forEach(function(entry, i) {
+      setTimeout(function() {
+        var at = Date.now();
+        var next = i + 1 < STATUS_SCRIPT.length ? STATUS_SCRIPT[i + 1][0] : STATUS_MS;
+        waitFor(statusEvent(entry[1]), function(shownAt) {
+          if (shownAt === null) missed++; else shown.push(shownAt - at);
+          if (VERBOSE) console.log('script: ' + entry[1] + ' at ' + entry[0] + ' ms ' + (shownAt === null ? 'not shown' : 'shown after ' + (shownAt - at) + ' ms'));
+        }, next - entry[0]);
+      }, entry[0]);
+    });
+    setTimeout(function() {
+      clearInterval(poll);
+      var hours = (Date.now() - started) / 3600000;
+      // The last change gets until the end of the session to show
+      console.log('STATUS ' + JSON.stringify({ messages: (watch.received - messages) / hours, bytes: (watch.bytes - bytes) / hours,
+                                              busy: inbox.busy, overflow: inbox.overflow, shown: shown, missed: missed }));
+      callback();
+    }, STATUS_MS);
+  });
+}
+
+// Run the script through both phones and report them side by side
+function statusCompare() {
+  var childProcess = require('child_process');
+  var os = require('os');
+  var legacy = path.join(os.tmpdir(), 'e2e-bench-status-' + STATUS_LEGACY_REV + '.js');
+  fs.writeFileSync(legacy, childProcess.execFileSync('git', ['show', STATUS_LEGACY_REV + ':src/pkjs/index.js'],
+                                                     { cwd: path.join(__dirname, '..') }));
+  var variants = [{ name: 'full tuples', args: ['--phone', legacy] }, { name: 'delta', args: [] }];
+  var pending = variants.length;
+  variants.forEach(function(variant) {
+    var args = [__filename, '--status-run'].concat(variant.args, VERBOSE ? ['--verbose'] : []);
+    childProcess.execFile(process.execPath, args, { maxBuffer: 64 * 1024 * 1024 }, function(err, stdout) {
+      var line = stdout.split('\n').filter(function(text) { return text.indexOf('STATUS ') === 0; })[0];
+      if (err || !line) { console.error(variant.name + ' run failed: ' + (err || 'no result')); process.exit(1); }
+      variant.result = JSON.parse(line.substring(7));
+      if (--pending === 0) statusReport(variants);
+    });
+  });
+}
+
+function statusReport(variants) {
+  console.log('Link ' + LINK_MS + ' ms each way, watch polls every ' + STATUS_POLL_MS + ' ms, inbox ' + WATCH_INBOX_BYTES +
+              ' bytes, ' + WATCH_HANDLE_MS + ' ms to handle a message, ' + STATUS_SCRIPT.length + ' changes in ' + STATUS_MS / 1000 + ' s');
+  console.log('protocol        msgs/h   bytes/h   NACK busy   NACK overflow   shown   to screen p50/max');
+  variants.forEach(function(variant) {
+    var result = variant.result;
+    var latency = result.shown.length ? percentile(result.shown, 0.5) + '/' + Math.max.apply(null, result.shown) + ' ms' : '-';
+    console.log(('  ' + variant.name + '              ').substring(0, 14) + ('          ' + Math.round(result.messages)).slice(-8) +
+                ('          ' + Math.round(result.bytes)).slice(-10) + ('            ' + result.busy).slice(-12) +
+                ('                ' + result.overflow).slice(-16) +
+                ('        ' + result.shown.length + '/' + (result.shown.length + result.missed)).slice(-8) +
+                ('                      ' + latency).slice(-20));
+  });
+}
+
+// Cover art scenario. The simulated watch handles offers and chunks as
+// art_offer() and art_chunk() in the watch app do; the skips are seeded, the
+// same in every run.
+
+var ART_ALBUMS = 6;              // more covers than the watch keeps
+var ART_TRACKS_PER_ALBUM = 2;
+var ART_SKIPS = 48;
+var ART_SKIP_REPEAT = 0.3;       // share of skips that follow the last one as a repeating click
+var ART_SKIP_REPEAT_MS = 200;    // quicker than a cover transfer
+var ART_SKIP_GAP_MIN_MS = 1000;
+var ART_SKIP_GAP_MAX_MS = 4000;
+var ART_CACHE_SIZE = 4;          // as in the watch app
+var ART_BYTES = 48 * 48;         // an 8-bit cover on basalt
+var ART_STALL_MS = 2000;
+var ART_STALL_RETRIES = 3;
+var ART_OUTAGE_SKIP = 12;        // the link goes down in the first transfer from this skip on
+var ART_OUTAGE_MS = 4500;        // longer than the phone's chunk retries, so the watch has to resume
+var ART_OUTAGE_GAP_MS = 10000;   // skips wait this long until the outage, so it hits a transfer to the end
+
+var artwork = require(path.join(PKJS, 'artwork.js'));
+var ART_DIR = path.join(__dirname, 'art');
+var ART_FILES = fs.readdirSync(ART_DIR).filter(function(name) { return /\.(jpe?g|png)$/.test(name); }).sort();
+
+var artWatch = { cache: [], clock: 0, current: 0, shown: 0, rx: null, received: 0, stalls: 0, timer: null, resumed: false,
+                 offers: 0, hits: 0, transfers: 0, chunks: 0, bytes: 0, resumes: 0, resumedChunks: 0, abandoned: 0,
+                 outageArmed: false };
+var artResults = { seed: 7, covers: [], skips: [], passed: 0, fetches: 0, lost: 0 };
+
+function artRandom() {
+  artResults.seed = (artResults.seed * 1103515245 + 12345) & 0x7FFFFFFF;
+  return artResults.seed / 0x80000000;
+}
+
+function coverURI(album) {
+  return '/getaa?s=1&u=' + encodeURIComponent('x-file-cifs://nas/music/album' + album + '/01.flac');
+}
+
+// Covers past the sample files are generated: diagonal bands in the album's own colours
+function generatedCover(album) {
+  var side = 300, raw = Buffer.alloc(side * (side * 3 + 1));
+  var colors = [[album * 40 % 256, 90, 200 - album * 30], [240, album * 50 % 256, 60]];
+  for (var y = 0; y < side; y++) {
+    for (var x = 0; x < side; x++) raw.set(colors[Math.floor((x + y * (album + 1)) / 40) & 1], y * (side * 3 + 1) + 1 + x * 3);
+  }
+  function chunk(type, data) {
+    var length = Buffer.alloc(4);
+    length.writeUInt32BE(data.length);
+    return Buffer.concat([length, Buffer.from(type), data, Buffer.alloc(4)]);
+  }
+  var header = Buffer.alloc(13);
+  header.writeUInt32BE(side, 0);
+  header.writeUInt32BE(side, 4);
+  header[8] = 8; header[9] = 2;
+  return Buffer.concat([Buffer.from([0x89, 0x50, 0x4E, 0x47, 0x0D, 0x0A, 0x1A, 0x0A]),
+                        chunk('IHDR', header), chunk('IDAT', zlib.deflateSync(raw)), chunk('IEND', Buffer.alloc(0))]);
+}
+
+function coverBytes(album) {
+  if (!artResults.covers[album]) {
+    artResults.covers[album] = album < ART_FILES.length ? fs.readFileSync(path.join(ART_DIR, ART_FILES[album])) : generatedCover(album);
+  }
+  return artResults.covers[album];
+}
+
+// /getaa as the speaker serves it, after the speaker's latency
+function serveCover(req, res) {
+  var match = /[?&]u=[^&]*album(\d+)/.exec(decodeURIComponent(req.url));
+  var album = match ? parseInt(match[1], 10) : -1;
+  artResults.fetches++;
+  setTimeout(function() {
+    if (!(album >= 0 && album < ART_ALBUMS)) { res.writeHead(404); res.end(); return; }
+    res.writeHead(200, { 'Content-Type': album < ART_FILES.length && /\.jpe?g$/.test(ART_FILES[album]) ? 'image/jpeg' : 'image/png' });
+    res.end(coverBytes(album));
+  }, SPEAKER_MS);
+}
+
+function artRequest() {
+  var payload = {};
+  payload[KEY.KEY_ART_HASH] = artWatch.rx ? artWatch.rx.hash : 0;
+  payload[KEY.KEY_CMD_ART_REQUEST] = artWatch.received;
+  watchPost(payload);
+  clearTimeout(artWatch.timer);
+  artWatch.timer = setTimeout(artStalled, ART_STALL_MS);
+}
+
+function artAbandon() {
+  clearTimeout(artWatch.timer);
+  if (artWatch.rx) { artWatch.rx.hash = 0; artWatch.rx.lastUsed = 0; artWatch.rx = null; }
+}
+
+function artStalled() {
+  if (!artWatch.rx) return;
+  if (++artWatch.stalls > ART_STALL_RETRIES) { artWatch.abandoned++; artAbandon(); return; }
+  artWatch.resumes++;
+  artWatch.resumed = true;
+  artRequest();
+}
+
+function artOffer(hash, length) {
+  artWatch.current = hash;
+  if (hash === 0) { artWatch.shown = 0; return; }
+  artWatch.offers++;
+  var slot = artWatch.cache.filter(function(entry) { return entry.complete && entry.hash === hash; })[0];
+  if (slot) { artWatch.hits++; slot.lastUsed = ++artWatch.clock; artWatch.shown = hash; return; }
+  artWatch.shown = 0;
+  if (length !== ART_BYTES || (artWatch.rx && artWatch.rx.hash === hash)) return;
+  artAbandon();
+  slot = artWatch.cache.reduce(function(victim, entry) { return entry.lastUsed < victim.lastUsed ? entry : victim; });
+  slot.hash = hash; slot.complete = false; slot.lastUsed = ++artWatch.clock;
+  artWatch.rx = slot; artWatch.received = 0; artWatch.stalls = 0; artWatch.resumed = false;
+  artWatch.transfers++;
+  artRequest();
+}
+
+function artChunk(hash, offset, data) {
+  if (!artWatch.rx || artWatch.rx.hash !== hash) return;
+  if (offset !== artWatch.received) {
+    if (offset > artWatch.received) { artWatch.resumes++; artWatch.resumed = true; artRequest(); }
+    return;
+  }
+  // The first chunk of a transfer after the outage skip takes the link down
+  if (artWatch.outageArmed) { artWatch.outageArmed = false; linkDownUntil = Date.now() + ART_OUTAGE_MS; }
+  var length = Math.min(data.length, ART_BYTES - artWatch.received);
+  artWatch.received += length; artWatch.chunks++; artWatch.bytes += length; artWatch.stalls = 0;
+  if (artWatch.resumed) artWatch.resumedChunks++;
+  if (artWatch.received < ART_BYTES) { clearTimeout(artWatch.timer); artWatch.timer = setTimeout(artStalled, ART_STALL_MS); return; }
+  var slot = artWatch.rx;
+  slot.complete = true; artWatch.rx = null;
+  clearTimeout(artWatch.timer);
+  if (slot.hash === artWatch.current) artWatch.shown = slot.hash;
+}
+
+function artReceive(msg) {
+  if (msg[KEY.KEY_ART_LENGTH] !== undefined) artOffer(msg[KEY.KEY_ART_HASH], msg[KEY.KEY_ART_LENGTH]);
+  else if (msg[KEY.KEY_ART_OFFSET] !== undefined) artChunk(msg[KEY.KEY_ART_HASH], msg[KEY.KEY_ART_OFFSET], msg[KEY.KEY_ART_DATA] || []);
+}
+
+function runArt(callback) {
+  TRACKS.length = 0;
+  for (var album = 0; album < ART_ALBUMS; album++) {
+    for (var t = 0; t < ART_TRACKS_PER_ALBUM; t++) {
+      TRACKS.push({ title: 'Track ' + (t + 1) + ' of album ' + (album + 1), artist: 'Artist ' + (album + 1),
+                    album: 'Album ' + (album + 1), duration: 240, art: album });
+    }
+  }
+  for (var i = 0; i < ART_CACHE_SIZE; i++) artWatch.cache.push({ hash: 0, lastUsed: 0, complete: false });
+  // The hash the watch should end up showing for each album, rendered as the phone renders it for basalt
+  var hashes = [];
+  for (var a = 0; a < ART_ALBUMS; a++) hashes.push(artwork.renderCover(new Uint8Array(coverBytes(a)), { size: 48, color: true }).hash);
+  function coverShown(track) {
+    return function() { return watch.title === TRACKS[track].title && artWatch.shown === hashes[TRACKS[track].art]; };
+  }
+  startup(function() {
+    waitFor(coverShown(speaker.track), function() {
+      (function skip(n) {
+        if (n === ART_SKIPS) { setTimeout(callback, SETTLE_MS); return; }
+        var next = artRandom() < 0.7;
+        var track = (speaker.track + (next ? 1 : -1) + TRACKS.length) % TRACKS.length;
+        var gap = artRandom() < ART_SKIP_REPEAT ? ART_SKIP_REPEAT_MS :
+                  ART_SKIP_GAP_MIN_MS + Math.floor(artRandom() * (ART_SKIP_GAP_MAX_MS - ART_SKIP_GAP_MIN_MS));
+        if (n === ART_OUTAGE_SKIP) artWatch.outageArmed = true;
+        if (artWatch.outageArmed) gap = ART_OUTAGE_GAP_MS;
+        var at = Date.now(), offers = artWatch.offers, hits = artWatch.hits;
+        waitFor(coverShown(track), function(shownAt) {
+          if (shownAt === null) { artResults.passed++; return; }
+          var kind = artWatch.offers === offers ? 'same cover' : artWatch.hits > hits ? 'cache hit' : 'transfer';
+          artResults.skips.push({ kind: kind, ms: shownAt - at });
+          if (VERBOSE) console.log('skip ' + n + ' to track ' + track + ': ' + kind + ', cover shown after ' + (shownAt - at) + ' ms');
+        }, gap);
+        watchSend(KEY[next ? 'KEY_CMD_NEXT_TRACK' : 'KEY_CMD_PREV_TRACK'], 1);
+        setTimeout(function() { skip(n + 1); }, gap);
+      })(0);
+    }, TIMEOUT_MS);
+  });
+}
+
+function artReport() {
+  console.log('Link ' + LINK_MS + ' ms each way, speaker ' + SPEAKER_MS + ' ms per request, ' + ART_SKIPS + ' skips through ' +
+              TRACKS.length + ' tracks on ' + ART_ALBUMS + ' albums, watch keeps ' + ART_CACHE_SIZE + ' covers, link down ' +
+              ART_OUTAGE_MS + ' ms once mid-transfer');
+  console.log('Watch: ' + artWatch.offers + ' covers offered, ' + artWatch.hits + ' from its cache (' +
+              Math.round(100 * artWatch.hits / Math.max(artWatch.offers, 1)) + '%), ' + artWatch.transfers + ' transfers, ' +
+              artWatch.chunks + ' chunks (' + artWatch.bytes + ' bytes), ' + artWatch.resumes + ' resumes with ' +
+              artWatch.resumedChunks + ' chunks after them, ' + artWatch.abandoned + ' abandoned');
+  console.log('Phone: ' + artResults.lost + ' chunk sends lost on the link; speaker: ' + artResults.fetches + ' cover fetches');
+  console.log('skip to cover   skips   on screen p50/p95/max');
+  ['same cover', 'cache hit', 'transfer', 'all'].forEach(function(kind) {
+    var ms = artResults.skips.filter(function(entry) { return kind === 'all' || entry.kind === kind; }).map(function(entry) { return entry.ms; });
+    var latency = ms.length ? percentile(ms, 0.5) + '/' + percentile(ms, 0.95) + '/' + Math.max.apply(null, ms) + ' ms' : '-';
+    console.log(('  ' + kind + '              ').substring(0, 14) + ('        ' + ms.length).slice(-8) + ('                        ' + latency).slice(-24));
+  });
+  console.log(artResults.passed + ' skips passed before their cover was shown');
+}
+
+function writeTrace() {
+  if (!TRACE_PATH) return;
+  fs.writeFileSync(TRACE_PATH, '# Recorded by bench/e2e-bench.js\n0 autoack ' + LINK_MS + '\n' + trace.join('\n') + '\n' +
+                   (Date.now() - traceStart) + ' end\n');
+  console.log('Trace written to ' + TRACE_PATH);
+}
+
+if (STATUS && !STATUS_RUN) { statusCompare(); } else startSpeaker(function() {
+  localStorage.setItem('KEY_CONFIG_IP_ADDRESS', '127.0.0.1');
+  loadApp();
+  traceStart = Date.now();
+  var run = BROWSE ? runBrowse : FAULTS ? runFaults : SCRUB ? runScrub : CHANGES ? runChanges : STATUS_RUN ? runStatus :
+            ART ? runArt : function(callback) { runAll(0, callback); };
+  run(function() {
+    if (!STATUS_RUN) (BROWSE ? browseReport : FAULTS ? faultReport : SCRUB ? scrubReport : CHANGES ? changesReport : ART ? artReport : report)();
+    writeTrace();
+    // index.js leaves its own timers running; the session is over
+    process.exit(0);
+  });
+});
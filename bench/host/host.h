@@ -0,0 +1,44 @@
+// Controls and counters of the host Pebble stub, used by replay.c to drive the
+// watch app through a trace and report what it cost.
+#pragma once
+
+#include "pebble.h"
+
+// Per-callback CPU time. Only outermost dispatches are timed, so a window load
+// run from a click handler counts towards that click.
+typedef struct { const char *name; uint32_t calls; uint64_t cpu_ns, max_ns; } HostCallbackStats;
+
+typedef struct {
+  uint32_t timers_registered, timers_rescheduled, timers_cancelled, timers_fired, timers_pending_peak;
+  uint32_t invalidations, frames, update_procs, fills, menu_rows;
+  uint32_t outbox_sent, outbox_bytes, outbox_busy, inbox_received, inbox_bytes, inbox_dropped;
+  uint32_t persist_writes, vibes, logs;
+  size_t heap_current, heap_peak;
+  uint32_t heap_blocks, heap_blocks_peak;
+} HostStats;
+
+extern HostStats host_stats;
+extern bool host_verbose;
+
+// Name a callback for the CPU time table; unnamed ones are grouped by kind
+void host_name_callback(void *fn, const char *name);
+
+uint64_t host_now_ms(void);
+// Run everything due up to at_ms on the virtual clock (timers, acks, minute ticks)
+void host_advance_to(uint64_t at_ms);
+
+// Deliver a dictionary built with dict_write_begin to the inbox
+void host_inbox(const uint8_t *buffer, uint16_t size);
+void host_inbox_drop(AppMessageResult reason);
+// Acknowledge the message on the wire; ack_ms < 0 leaves acks to the trace
+void host_outbox_ack(bool ok, AppMessageResult reason);
+void host_outbox_autoack(int32_t ack_ms);
+
+void host_click(ButtonId button);
+void host_hold(ButtonId button, uint32_t hold_ms);
+void host_focus(bool in_focus);
+
+// The trace is replayed from app_event_loop(), between the app's init and deinit
+void host_set_event_loop(void (*loop)(void));
+
+void host_report(FILE *out);
@@ -0,0 +1,664 @@
+// Host implementation of the Pebble SDK subset in pebble.h. It keeps a virtual
+// clock, a window stack with a minimal renderer, an AppMessage link with a
+// single message in flight, and in-memory persistent storage. Everything the
+// app allocates through the SDK is counted towards the heap figures.
+#include <stdarg.h>
+#include "host.h"
+
+#undef time
+#undef malloc
+#undef free
+
+HostStats host_stats;
+bool host_verbose = false;
+
+#define HOST_EPOCH_S 1700000000
+#define HOST_MAX_CALLBACKS 48
+#define HOST_MAX_WINDOWS 8
+#define HOST_MAX_PERSIST 32
+#define MENU_CELL_HEIGHT 44
+
+static uint64_t s_now_ms = 0;
+static void (*s_event_loop)(void) = NULL;
+
+// Heap accounting
+
+typedef struct { size_t size; } HostBlock;
+
+static void *host_alloc(size_t size) {
+  HostBlock *block = calloc(1, sizeof(HostBlock) + size);
+  if (!block) { return NULL; }
+  block->size = size;
+  host_stats.heap_current += size; host_stats.heap_blocks++;
+  if (host_stats.heap_current > host_stats.heap_peak) { host_stats.heap_peak = host_stats.heap_current; }
+  if (host_stats.heap_blocks > host_stats.heap_blocks_peak) { host_stats.heap_blocks_peak = host_stats.heap_blocks; }
+  return block + 1;
+}
+
+static void host_free(void *ptr) {
+  if (!ptr) { return; }
+  HostBlock *block = (HostBlock *)ptr - 1;
+  host_stats.heap_current -= block->size; host_stats.heap_blocks--;
+  free(block);
+}
+
+void *host_malloc(size_t size) { return host_alloc(size); }
+void host_mfree(void *ptr) { host_free(ptr); }
+
+// Callback timing
+
+static HostCallbackStats s_callbacks[HOST_MAX_CALLBACKS];
+static int s_callback_count = 0;
+static struct { void *fn; const char *name; } s_callback_names[HOST_MAX_CALLBACKS];
+static int s_callback_name_count = 0;
+static int s_dispatch_depth = 0;
+
+void host_name_callback(void *fn, const char *name) {
+  if (s_callback_name_count == HOST_MAX_CALLBACKS) { return; }
+  s_callback_names[s_callback_name_count].fn = fn;
+  s_callback_names[s_callback_name_count].name = name;
+  s_callback_name_count++;
+}
+
+static const char *callback_name(void *fn, const char *kind) {
+  for (int i = 0; i < s_callback_name_count; i++) { if (s_callback_names[i].fn == fn) { return s_callback_names[i].name; } }
+  return kind;
+}
+
+static uint64_t cpu_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+static void account(const char *name, uint64_t ns) {
+  HostCallbackStats *stats = NULL;
+  for (int i = 0; i < s_callback_count; i++) { if (strcmp(s_callbacks[i].name, name) == 0) { stats = &s_callbacks[i]; break; } }
+  if (!stats) {
+    if (s_callback_count == HOST_MAX_CALLBACKS) { return; }
+    stats = &s_callbacks[s_callback_count++];
+    stats->name = name;
+  }
+  stats->calls++; stats->cpu_ns += ns;
+  if (ns > stats->max_ns) { stats->max_ns = ns; }
+}
+
+static void render(void);
+
+// Run one callback from the event loop, timing it and drawing whatever it invalidated
+#define DISPATCH(fn, kind, call) do { \
+    const char *dispatch_name = callback_name((void *)(fn), (kind)); \
+    bool outermost = s_dispatch_depth++ == 0; \
+    uint64_t dispatch_started = cpu_ns(); \
+    call; \
+    s_dispatch_depth--; \
+    if (outermost) { account(dispatch_name, cpu_ns() - dispatch_started); render(); } \
+  } while (0)
+
+// Logging and time
+
+void app_log(uint8_t log_level, const char *src_filename, int src_line_number, const char *fmt, ...) {
+  host_stats.logs++;
+  if (!host_verbose) { return; }
+  va_list args;
+  va_start(args, fmt);
+  fprintf(stderr, "%7llu  [%d] ", (unsigned long long)s_now_ms, log_level);
+  vfprintf(stderr, fmt, args);
+  fputc('\n', stderr);
+  va_end(args);
+}
+
+uint64_t host_now_ms(void) { return s_now_ms; }
+time_t host_time(time_t *tloc) { time_t now = HOST_EPOCH_S + (time_t)(s_now_ms / 1000); if (tloc) { *tloc = now; } return now; }
+uint16_t time_ms(time_t *tloc, uint16_t *out_ms) {
+  uint16_t ms = (uint16_t)(s_now_ms % 1000);
+  host_time(tloc);
+  if (out_ms) { *out_ms = ms; }
+  return ms;
+}
+bool clock_is_24h_style(void) { return true; }
+
+static TickHandler s_tick_handler = NULL;
+void tick_timer_service_subscribe(TimeUnits tick_units, TickHandler handler) { s_tick_handler = handler; }
+void tick_timer_service_unsubscribe(void) { s_tick_handler = NULL; }
+
+static AppFocusHandlers s_focus_handlers;
+void app_focus_service_subscribe_handlers(AppFocusHandlers handlers) { s_focus_handlers = handlers; }
+void app_focus_service_unsubscribe(void) { memset(&s_focus_handlers, 0, sizeof(s_focus_handlers)); }
+
+// Timers, kept unsorted; there are only ever a handful
+
+struct AppTimer { uint64_t due; AppTimerCallback callback; void *data; AppTimer *next; };
+static AppTimer *s_timers = NULL;
+static uint32_t s_timers_pending = 0;
+
+AppTimer *app_timer_register(uint32_t timeout_ms, AppTimerCallback callback, void *callback_data) {
+  AppTimer *timer = host_alloc(sizeof(AppTimer));
+  if (!timer) { return NULL; }
+  timer->due = s_now_ms + timeout_ms; timer->callback = callback; timer->data = callback_data;
+  timer->next = s_timers; s_timers = timer;
+  host_stats.timers_registered++;
+  if (++s_timers_pending > host_stats.timers_pending_peak) { host_stats.timers_pending_peak = s_timers_pending; }
+  return timer;
+}
+
+static bool unlink_timer(AppTimer *timer) {
+  for (AppTimer **link = &s_timers; *link; link = &(*link)->next) {
+    if (*link == timer) { *link = timer->next; s_timers_pending--; return true; }
+  }
+  return false;
+}
+
+bool app_timer_reschedule(AppTimer *timer_handle, uint32_t new_timeout_ms) {
+  for (AppTimer *timer = s_timers; timer; timer = timer->next) {
+    if (timer == timer_handle) { timer->due = s_now_ms + new_timeout_ms; host_stats.timers_rescheduled++; return true; }
+  }
+  return false;
+}
+
+void app_timer_cancel(AppTimer *timer_handle) {
+  if (!timer_handle || !unlink_timer(timer_handle)) { return; }
+  host_free(timer_handle);
+  host_stats.timers_cancelled++;
+}
+
+static AppTimer *earliest_timer(void) {
+  AppTimer *earliest = NULL;
+  // Registration order breaks ties, and new timers sit at the head
+  for (AppTimer *timer = s_timers; timer; timer = timer->next) { if (!earliest || timer->due <= earliest->due) { earliest = timer; } }
+  return earliest;
+}
+
+// AppMessage
+
+static AppMessageInboxReceived s_inbox_received = NULL;
+static AppMessageInboxDropped s_inbox_dropped = NULL;
+static AppMessageOutboxSent s_outbox_sent = NULL;
+static AppMessageOutboxFailed s_outbox_failed = NULL;
+static uint32_t s_inbox_size = 0, s_outbox_size = 0;
+static uint8_t *s_outbox_buffer = NULL;
+static DictionaryIterator s_outbox_iter;
+static bool s_outbox_open = false, s_outbox_in_flight = false;
+static int32_t s_autoack_ms = -1;
+static bool s_ack_pending = false;
+static uint64_t s_ack_due = 0;
+
+AppMessageResult app_message_open(const uint32_t size_inbound, const uint32_t size_outbound) {
+  s_inbox_size = size_inbound; s_outbox_size = size_outbound;
+  s_outbox_buffer = host_alloc(size_outbound);
+  return s_outbox_buffer ? APP_MSG_OK : APP_MSG_OUT_OF_MEMORY;
+}
+AppMessageInboxReceived app_message_register_inbox_received(AppMessageInboxReceived received_callback) { AppMessageInboxReceived old = s_inbox_received; s_inbox_received = received_callback; return old; }
+AppMessageInboxDropped app_message_register_inbox_dropped(AppMessageInboxDropped dropped_callback) { AppMessageInboxDropped old = s_inbox_dropped; s_inbox_dropped = dropped_callback; return old; }
+AppMessageOutboxSent app_message_register_outbox_sent(AppMessageOutboxSent sent_callback) { AppMessageOutboxSent old = s_outbox_sent; s_outbox_sent = sent_callback; return old; }
+AppMessageOutboxFailed app_message_register_outbox_failed(AppMessageOutboxFailed failed_callback) { AppMessageOutboxFailed old = s_outbox_failed; s_outbox_failed = failed_callback; return old; }
+
+AppMessageResult app_message_outbox_begin(DictionaryIterator **iterator) {
+  if (!s_outbox_buffer) { return APP_MSG_INVALID_STATE; }
+  if (s_outbox_in_flight || s_outbox_open) { host_stats.outbox_busy++; return APP_MSG_BUSY; }
+  dict_write_begin(&s_outbox_iter, s_outbox_buffer, s_outbox_size);
+  s_outbox_open = true;
+  *iterator = &s_outbox_iter;
+  return APP_MSG_OK;
+}
+
+static void print_dict(FILE *out, const char *event, DictionaryIterator *iter) {
+  fprintf(out, "%llu %s", (unsigned long long)s_now_ms, event);
+  for (Tuple *t = dict_read_first(iter); t; t = dict_read_next(iter)) {
+    if (t->type == TUPLE_CSTRING) { fprintf(out, " %u=\"%s\"", (unsigned)t->key, t->value->cstring); }
+    else if (t->type == TUPLE_BYTE_ARRAY) { fprintf(out, " %u=x:", (unsigned)t->key); const uint8_t *data = (const uint8_t *)t->value; for (int i = 0; i < t->length; i++) { fprintf(out, "%02x", data[i]); } }
+    else if (t->length == 1) { fprintf(out, " %u=%d", (unsigned)t->key, t->type == TUPLE_INT ? t->value->int8 : t->value->uint8); }
+    else if (t->length == 2) { fprintf(out, " %u=%d", (unsigned)t->key, t->type == TUPLE_INT ? t->value->int16 : t->value->uint16); }
+    else if (t->type == TUPLE_INT) { fprintf(out, " %u=%d", (unsigned)t->key, (int)t->value->int32); }
+    else { fprintf(out, " %u=%u", (unsigned)t->key, (unsigned)t->value->uint32); }
+  }
+  fputc('\n', out);
+}
+
+AppMessageResult app_message_outbox_send(void) {
+  if (!s_outbox_open) { return APP_MSG_INVALID_STATE; }
+  s_outbox_open = false; s_outbox_in_flight = true;
+  host_stats.outbox_sent++;
+  host_stats.outbox_bytes += (uint32_t)((const uint8_t *)s_outbox_iter.end - s_outbox_buffer);
+  if (host_verbose) { print_dict(stderr, "outbox", &s_outbox_iter); }
+  if (s_autoack_ms >= 0) { s_ack_pending = true; s_ack_due = s_now_ms + s_autoack_ms; }
+  return APP_MSG_OK;
+}
+
+void host_outbox_autoack(int32_t ack_ms) { s_autoack_ms = ack_ms; }
+
+void host_outbox_ack(bool ok, AppMessageResult reason) {
+  if (!s_outbox_in_flight) { return; }
+  s_outbox_in_flight = false; s_ack_pending = false;
+  if (ok && s_outbox_sent) { DISPATCH(s_outbox_sent, "outbox_sent", s_outbox_sent(&s_outbox_iter, NULL)); }
+  else if (!ok && s_outbox_failed) { DISPATCH(s_outbox_failed, "outbox_failed", s_outbox_failed(&s_outbox_iter, reason, NULL)); }
+}
+
+void host_inbox(const uint8_t *buffer, uint16_t size) {
+  if (size > s_inbox_size) { host_inbox_drop(APP_MSG_BUFFER_OVERFLOW); return; }
+  DictionaryIterator iter;
+  dict_read_begin_from_buffer(&iter, buffer, size);
+  host_stats.inbox_received++; host_stats.inbox_bytes += size;
+  if (s_inbox_received) { DISPATCH(s_inbox_received, "inbox_received", s_inbox_received(&iter, NULL)); }
+}
+
+void host_inbox_drop(AppMessageResult reason) {
+  host_stats.inbox_dropped++;
+  if (s_inbox_dropped) { DISPATCH(s_inbox_dropped, "inbox_dropped", s_inbox_dropped(reason, NULL)); }
+}
+
+// Dictionaries
+
+DictionaryResult dict_write_begin(DictionaryIterator *iter, uint8_t *const buffer, const uint16_t size) {
+  if (!iter || !buffer || size < sizeof(Dictionary)) { return DICT_INVALID_ARGS; }
+  iter->dictionary = (Dictionary *)buffer; iter->dictionary->count = 0;
+  iter->end = buffer + size; iter->cursor = iter->dictionary->head;
+  return DICT_OK;
+}
+
+static DictionaryResult dict_write(DictionaryIterator *iter, uint32_t key, TupleType type, const void *data, uint16_t length) {
+  if ((uint8_t *)iter->cursor + sizeof(Tuple) + length > (const uint8_t *)iter->end) { return DICT_NOT_ENOUGH_STORAGE; }
+  iter->cursor->key = key; iter->cursor->type = type; iter->cursor->length = length;
+  memcpy(iter->cursor->value, data, length);
+  iter->cursor = (Tuple *)((uint8_t *)iter->cursor + sizeof(Tuple) + length);
+  iter->dictionary->count++;
+  return DICT_OK;
+}
+
+DictionaryResult dict_write_uint8(DictionaryIterator *iter, const uint32_t key, const uint8_t value) { return dict_write(iter, key, TUPLE_UINT, &value, 1); }
+DictionaryResult dict_write_uint32(DictionaryIterator *iter, const uint32_t key, const uint32_t value) { return dict_write(iter, key, TUPLE_UINT, &value, 4); }
+DictionaryResult dict_write_int32(DictionaryIterator *iter, const uint32_t key, const int32_t value) { return dict_write(iter, key, TUPLE_INT, &value, 4); }
+DictionaryResult dict_write_cstring(DictionaryIterator *iter, const uint32_t key, const char *cstring) { return dict_write(iter, key, TUPLE_CSTRING, cstring, (uint16_t)strlen(cstring) + 1); }
+DictionaryResult dict_write_data(DictionaryIterator *iter, const uint32_t key, const uint8_t *const data, const uint16_t size) { return dict_write(iter, key, TUPLE_BYTE_ARRAY, data, size); }
+
+uint32_t dict_write_end(DictionaryIterator *iter) {
+  iter->end = iter->cursor;
+  return (uint32_t)((uint8_t *)iter->cursor - (uint8_t *)iter->dictionary);
+}
+
+Tuple *dict_read_begin_from_buffer(DictionaryIterator *iter, const uint8_t *const buffer, const uint16_t size) {
+  iter->dictionary = (Dictionary *)buffer; iter->end = buffer + size;
+  return dict_read_first(iter);
+}
+
+Tuple *dict_read_first(DictionaryIterator *iter) {
+  iter->cursor = iter->dictionary->head;
+  return iter->dictionary->count ? iter->cursor : NULL;
+}
+
+Tuple *dict_read_next(DictionaryIterator *iter) {
+  Tuple *next = (Tuple *)((uint8_t *)iter->cursor + sizeof(Tuple) + iter->cursor->length);
+  if ((const uint8_t *)next + sizeof(Tuple) > (const uint8_t *)iter->end) { return NULL; }
+  iter->cursor = next;
+  return next;
+}
+
+Tuple *dict_find(const DictionaryIterator *iter, const uint32_t key) {
+  Tuple *t = iter->dictionary->head;
+  for (int i = 0; i < iter->dictionary->count; i++) {
+    if (t->key == key) { return t; }
+    t = (Tuple *)((uint8_t *)t + sizeof(Tuple) + t->length);
+  }
+  return NULL;
+}
+
+// Graphics
+
+struct GContext { GColor fill; };
+struct GFontStub { const char *key; };
+struct GBitmap { GSize size; GBitmapFormat format; uint16_t row_bytes; uint8_t *data; };
+
+void graphics_context_set_fill_color(GContext *ctx, GColor color) { ctx->fill = color; }
+void graphics_fill_rect(GContext *ctx, GRect rect, uint16_t corner_radius, GCornerMask corner_mask) { host_stats.fills++; }
+
+GBitmap *gbitmap_create_blank(GSize size, GBitmapFormat format) {
+  GBitmap *bitmap = host_alloc(sizeof(GBitmap));
+  if (!bitmap) { return NULL; }
+  bitmap->size = size; bitmap->format = format;
+  bitmap->row_bytes = format == GBitmapFormat8Bit ? size.w : ((size.w + 31) / 32) * 4;
+  bitmap->data = host_alloc((size_t)bitmap->row_bytes * size.h);
+  if (!bitmap->data) { host_free(bitmap); return NULL; }
+  return bitmap;
+}
+// Action bar icons are 25px square
+GBitmap *gbitmap_create_with_resource(uint32_t resource_id) { return gbitmap_create_blank(GSize(25, 25), GBitmapFormat8Bit); }
+uint8_t *gbitmap_get_data(const GBitmap *bitmap) { return bitmap->data; }
+uint16_t gbitmap_get_bytes_per_row(const GBitmap *bitmap) { return bitmap->row_bytes; }
+void gbitmap_destroy(GBitmap *bitmap) { if (!bitmap) { return; } host_free(bitmap->data); host_free(bitmap); }
+
+GFont fonts_get_system_font(const char *font_key) {
+  static struct GFontStub font;
+  font.key = font_key;
+  return &font;
+}
+
+// Layers. Every layer is on one list, in creation order, which is also the draw order.
+
+typedef enum { LAYER_PLAIN, LAYER_TEXT, LAYER_BITMAP, LAYER_ACTION_BAR, LAYER_MENU, LAYER_ROOT } LayerKind;
+struct Layer { GRect frame; bool hidden, dirty; LayerKind kind; LayerUpdateProc update_proc; Layer *parent; Window *window; Layer *next; };
+struct TextLayer { Layer layer; const char *text; };
+struct BitmapLayer { Layer layer; const GBitmap *bitmap; };
+struct ActionBarLayer { Layer layer; const GBitmap *icons[NUM_BUTTONS]; };
+struct MenuLayer { Layer layer; MenuLayerCallbacks callbacks; void *context; MenuIndex selected; };
+
+typedef struct { ClickHandler single, long_down, long_up; } ClickConfig;
+struct Window { Layer root; WindowHandlers handlers; ClickConfigProvider click_provider; ClickConfig clicks[NUM_BUTTONS]; MenuLayer *menu; bool loaded; };
+
+static Layer *s_layers = NULL;
+
+static void invalidate(Layer *layer) { layer->dirty = true; host_stats.invalidations++; }
+
+static void layer_init(Layer *layer, GRect frame, LayerKind kind) {
+  layer->frame = frame; layer->kind = kind; layer->dirty = true;
+  Layer **link = &s_layers;
+  while (*link) { link = &(*link)->next; }
+  *link = layer;
+}
+static void layer_unlink(Layer *layer) {
+  for (Layer **link = &s_layers; *link; link = &(*link)->next) { if (*link == layer) { *link = layer->next; return; } }
+}
+
+Layer *layer_create(GRect frame) { Layer *layer = host_alloc(sizeof(Layer)); if (layer) { layer_init(layer, frame, LAYER_PLAIN); } return layer; }
+void layer_destroy(Layer *layer) { if (!layer) { return; } layer_unlink(layer); host_free(layer); }
+void layer_set_update_proc(Layer *layer, LayerUpdateProc update_proc) { layer->update_proc = update_proc; }
+void layer_mark_dirty(Layer *layer) { invalidate(layer); }
+void layer_add_child(Layer *parent, Layer *child) { child->parent = parent; invalidate(parent); }
+GRect layer_get_bounds(const Layer *layer) { return GRect(0, 0, layer->frame.size.w, layer->frame.size.h); }
+GRect layer_get_frame(const Layer *layer) { return layer->frame; }
+void layer_set_frame(Layer *layer, GRect frame) { layer->frame = frame; invalidate(layer); }
+bool layer_get_hidden(const Layer *layer) { return layer->hidden; }
+void layer_set_hidden(Layer *layer, bool hidden) { layer->hidden = hidden; invalidate(layer); }
+Window *layer_get_window(const Layer *layer) { while (layer->parent) { layer = layer->parent; } return layer->window; }
+
+TextLayer *text_layer_create(GRect frame) { TextLayer *text_layer = host_alloc(sizeof(TextLayer)); if (text_layer) { layer_init(&text_layer->layer, frame, LAYER_TEXT); } return text_layer; }
+void text_layer_destroy(TextLayer *text_layer) { if (!text_layer) { return; } layer_unlink(&text_layer->layer); host_free(text_layer); }
+Layer *text_layer_get_layer(TextLayer *text_layer) { return &text_layer->layer; }
+void text_layer_set_text(TextLayer *text_layer, const char *text) { text_layer->text = text; invalidate(&text_layer->layer); }
+void text_layer_set_background_color(TextLayer *text_layer, GColor color) { invalidate(&text_layer->layer); }
+void text_layer_set_text_color(TextLayer *text_layer, GColor color) { invalidate(&text_layer->layer); }
+void text_layer_set_font(TextLayer *text_layer, GFont font) { invalidate(&text_layer->layer); }
+void text_layer_set_text_alignment(TextLayer *text_layer, GTextAlignment text_alignment) { invalidate(&text_layer->layer); }
+void text_layer_set_overflow_mode(TextLayer *text_layer, GTextOverflowMode line_mode) { invalidate(&text_layer->layer); }
+
+BitmapLayer *bitmap_layer_create(GRect frame) { BitmapLayer *bitmap_layer = host_alloc(sizeof(BitmapLayer)); if (bitmap_layer) { layer_init(&bitmap_layer->layer, frame, LAYER_BITMAP); } return bitmap_layer; }
+void bitmap_layer_destroy(BitmapLayer *bitmap_layer) { if (!bitmap_layer) { return; } layer_unlink(&bitmap_layer->layer); host_free(bitmap_layer); }
+Layer *bitmap_layer_get_layer(const BitmapLayer *bitmap_layer) { return (Layer *)&bitmap_layer->layer; }
+void bitmap_layer_set_bitmap(BitmapLayer *bitmap_layer, const GBitmap *bitmap) { bitmap_layer->bitmap = bitmap; invalidate(&bitmap_layer->layer); }
+
+ActionBarLayer *action_bar_layer_create(void) { ActionBarLayer *action_bar = host_alloc(sizeof(ActionBarLayer)); if (action_bar) { layer_init(&action_bar->layer, GRect(0, 0, ACTION_BAR_WIDTH, 168), LAYER_ACTION_BAR); } return action_bar; }
+void action_bar_layer_destroy(ActionBarLayer *action_bar) { if (!action_bar) { return; } layer_unlink(&action_bar->layer); host_free(action_bar); }
+void action_bar_layer_add_to_window(ActionBarLayer *action_bar, Window *window) { layer_add_child(&window->root, &action_bar->layer); }
+void action_bar_layer_set_background_color(ActionBarLayer *action_bar, GColor background_color) { invalidate(&action_bar->layer); }
+void action_bar_layer_set_icon(ActionBarLayer *action_bar, ButtonId button_id, const GBitmap *icon) { action_bar->icons[button_id] = icon; invalidate(&action_bar->layer); }
+void action_bar_layer_set_icon_press_animation(ActionBarLayer *action_bar, ButtonId button_id, ActionBarLayerIconPressAnimation animation) {}
+
+MenuLayer *menu_layer_create(GRect frame) { MenuLayer *menu = host_alloc(sizeof(MenuLayer)); if (menu) { layer_init(&menu->layer, frame, LAYER_MENU); } return menu; }
+void menu_layer_destroy(MenuLayer *menu_layer) {
+  if (!menu_layer) { return; }
+  Window *window = layer_get_window(&menu_layer->layer);
+  if (window && window->menu == menu_layer) { window->menu = NULL; }
+  layer_unlink(&menu_layer->layer); host_free(menu_layer);
+}
+Layer *menu_layer_get_layer(const MenuLayer *menu_layer) { return (Layer *)&menu_layer->layer; }
+void menu_layer_set_callbacks(MenuLayer *menu_layer, void *callback_context, MenuLayerCallbacks callbacks) { menu_layer->callbacks = callbacks; menu_layer->context = callback_context; }
+void menu_layer_set_click_config_onto_window(MenuLayer *menu_layer, Window *window) { window->menu = menu_layer; }
+void menu_layer_reload_data(MenuLayer *menu_layer) { invalidate(&menu_layer->layer); }
+void menu_layer_set_selected_index(MenuLayer *menu_layer, MenuIndex index, MenuRowAlign scroll_align, bool animated) { menu_layer->selected = index; invalidate(&menu_layer->layer); }
+MenuIndex menu_layer_get_selected_index(const MenuLayer *menu_layer) { return menu_layer->selected; }
+void menu_cell_basic_draw(GContext *ctx, const Layer *cell_layer, const char *title, const char *subtitle, GBitmap *icon) { host_stats.menu_rows++; }
+
+// Windows
+
+static Window *s_window_stack[HOST_MAX_WINDOWS];
+static int s_window_count = 0;
+static Window *s_configuring = NULL;
+
+Window *window_create(void) {
+  Window *window = host_alloc(sizeof(Window));
+  if (window) { layer_init(&window->root, GRect(0, 0, 144, 168), LAYER_ROOT); window->root.window = window; }
+  return window;
+}
+void window_set_window_handlers(Window *window, WindowHandlers handlers) { window->handlers = handlers; }
+void window_set_background_color(Window *window, GColor background_color) { invalidate(&window->root); }
+void window_set_click_config_provider(Window *window, ClickConfigProvider click_config_provider) { window->click_provider = click_config_provider; }
+Layer *window_get_root_layer(const Window *window) { return (Layer *)&window->root; }
+bool window_is_loaded(Window *window) { return window->loaded; }
+
+static Window *top_window(void) { return s_window_count ? s_window_stack[s_window_count - 1] : NULL; }
+
+static void window_unload(Window *window) {
+  if (!window->loaded) { return; }
+  window->loaded = false;
+  if (window->handlers.unload) { window->handlers.unload(window); }
+}
+
+void window_stack_push(Window *window, bool animated) {
+  if (s_window_count == HOST_MAX_WINDOWS) { return; }
+  s_window_stack[s_window_count++] = window;
+  if (!window->loaded) {
+    window->loaded = true;
+    if (window->handlers.load) { window->handlers.load(window); }
+  }
+  memset(window->clicks, 0, sizeof(window->clicks));
+  if (window->click_provider) { s_configuring = window; window->click_provider(NULL); s_configuring = NULL; }
+  invalidate(&window->root);
+}
+
+Window *window_stack_pop(bool animated) {
+  if (s_window_count == 0) { return NULL; }
+  Window *window = s_window_stack[--s_window_count];
+  window_unload(window);
+  if (top_window()) { invalidate(&top_window()->root); }
+  return window;
+}
+
+void window_destroy(Window *window) {
+  if (!window) { return; }
+  for (int i = 0; i < s_window_count; i++) {
+    if (s_window_stack[i] == window) { memmove(&s_window_stack[i], &s_window_stack[i + 1], (s_window_count - i - 1) * sizeof(Window *)); s_window_count--; break; }
+  }
+  window_unload(window);
+  layer_unlink(&window->root); host_free(window);
+}
+
+void window_single_click_subscribe(ButtonId button_id, ClickHandler handler) { if (s_configuring) { s_configuring->clicks[button_id].single = handler; } }
+void window_single_repeating_click_subscribe(ButtonId button_id, uint16_t repeat_interval_ms, ClickHandler handler) { window_single_click_subscribe(button_id, handler); }
+void window_long_click_subscribe(ButtonId button_id, uint16_t delay_ms, ClickHandler down_handler, ClickHandler up_handler) {
+  if (!s_configuring) { return; }
+  s_configuring->clicks[button_id].long_down = down_handler; s_configuring->clicks[button_id].long_up = up_handler;
+}
+
+// Draw the top window if anything in it was invalidated. The real renderer repaints the whole window,
+// so every visible custom layer's update proc runs.
+static bool layer_visible_in(const Layer *layer, const Window *window) {
+  for (; layer; layer = layer->parent) {
+    if (layer->hidden) { return false; }
+    if (!layer->parent) { return layer->window == window; }
+  }
+  return false;
+}
+
+static void render(void) {
+  Window *window = top_window();
+  if (!window || !window->loaded) { return; }
+  bool dirty = false;
+  for (Layer *layer = s_layers; layer; layer = layer->next) { if (layer->dirty && layer_get_window(layer) == window) { dirty = true; } layer->dirty = false; }
+  if (!dirty) { return; }
+  host_stats.frames++;
+  uint64_t started = cpu_ns();
+  GContext ctx = { GColorClear };
+  for (Layer *layer = s_layers; layer; layer = layer->next) {
+    if (!layer_visible_in(layer, window)) { continue; }
+    if (layer->update_proc) { layer->update_proc(layer, &ctx); host_stats.update_procs++; }
+    if (layer->kind == LAYER_MENU) {
+      // Only the rows on screen are drawn, with the selection kept in the middle
+      MenuLayer *menu = (MenuLayer *)layer;
+      uint16_t rows = menu->callbacks.get_num_rows ? menu->callbacks.get_num_rows(menu, 0, menu->context) : 0;
+      int visible = layer->frame.size.h / MENU_CELL_HEIGHT + 1;
+      int first = MAX(0, MIN((int)menu->selected.row - visible / 2, (int)rows - visible));
+      for (uint16_t row = first; row < rows && row < first + visible && menu->callbacks.draw_row; row++) {
+        MenuIndex index = { 0, row };
+        menu->callbacks.draw_row(&ctx, layer, &index, menu->context);
+      }
+    }
+  }
+  account("render", cpu_ns() - started);
+}
+
+// Buttons and focus
+
+static void menu_click(MenuLayer *menu, ButtonId button) {
+  if (button == BUTTON_ID_SELECT) {
+    if (menu->callbacks.select_click) { MenuIndex index = menu->selected; menu->callbacks.select_click(menu, &index, menu->context); }
+    return;
+  }
+  uint16_t rows = menu->callbacks.get_num_rows ? menu->callbacks.get_num_rows(menu, 0, menu->context) : 0;
+  MenuIndex old = menu->selected;
+  if (button == BUTTON_ID_UP && menu->selected.row > 0) { menu->selected.row--; }
+  else if (button == BUTTON_ID_DOWN && menu->selected.row + 1 < rows) { menu->selected.row++; }
+  if (menu->selected.row == old.row) { return; }
+  invalidate(&menu->layer);
+  if (menu->callbacks.selection_changed) { menu->callbacks.selection_changed(menu, menu->selected, old, menu->context); }
+}
+
+void host_click(ButtonId button) {
+  Window *window = top_window();
+  if (!window) { return; }
+  if (button == BUTTON_ID_BACK && !window->clicks[button].single) {
+    if (s_window_count > 1) { DISPATCH(NULL, "back", window_stack_pop(true)); }
+    return;
+  }
+  if (window->menu) { DISPATCH(NULL, "menu_click", menu_click(window->menu, button)); return; }
+  ClickHandler handler = window->clicks[button].single;
+  if (handler) { DISPATCH(handler, "click", handler(NULL, NULL)); }
+}
+
+void host_hold(ButtonId button, uint32_t hold_ms) {
+  Window *window = top_window();
+  if (window && window->menu && button == BUTTON_ID_SELECT && window->menu->callbacks.select_long_click) {
+    MenuLayer *menu = window->menu;
+    MenuIndex index = menu->selected;
+    DISPATCH(menu->callbacks.select_long_click, "menu_long_click", menu->callbacks.select_long_click(menu, &index, menu->context));
+    host_advance_to(s_now_ms + hold_ms);
+    return;
+  }
+  if (!window || !window->clicks[button].long_down) { host_advance_to(s_now_ms + hold_ms); return; }
+  ClickHandler up = window->clicks[button].long_up;
+  DISPATCH(window->clicks[button].long_down, "long_click", window->clicks[button].long_down(NULL, NULL));
+  host_advance_to(s_now_ms + hold_ms);
+  if (up) { DISPATCH(up, "long_click_release", up(NULL, NULL)); }
+}
+
+void host_focus(bool in_focus) {
+  if (s_focus_handlers.did_focus) { DISPATCH(s_focus_handlers.did_focus, "focus", s_focus_handlers.did_focus(in_focus)); }
+}
+
+// Virtual clock
+
+void host_advance_to(uint64_t at_ms) {
+  while (true) {
+    AppTimer *timer = earliest_timer();
+    uint64_t next_minute = (HOST_EPOCH_S * 1000ull + s_now_ms) / 60000 * 60000 + 60000 - HOST_EPOCH_S * 1000ull;
+    uint64_t due = at_ms + 1;
+    if (timer && timer->due < due) { due = timer->due; }
+    if (s_ack_pending && s_ack_due < due) { due = s_ack_due; }
+    if (s_tick_handler && next_minute < due) { due = next_minute; }
+    if (due > at_ms) { break; }
+    if (due > s_now_ms) { s_now_ms = due; }
+
+    if (s_ack_pending && s_ack_due == due) { host_outbox_ack(true, APP_MSG_OK); continue; }
+    if (timer && timer->due == due) {
+      unlink_timer(timer);
+      host_stats.timers_fired++;
+      AppTimerCallback callback = timer->callback;
+      void *data = timer->data;
+      host_free(timer);
+      DISPATCH(callback, "timer", callback(data));
+      continue;
+    }
+    time_t now = host_time(NULL);
+    struct tm *tick_time = localtime(&now);
+    DISPATCH(s_tick_handler, "tick", s_tick_handler(tick_time, MINUTE_UNIT));
+  }
+  if (at_ms > s_now_ms) { s_now_ms = at_ms; }
+}
+
+// Vibes and persistent storage
+
+void vibes_short_pulse(void) { host_stats.vibes++; }
+void vibes_enqueue_custom_pattern(VibePattern pattern) { host_stats.vibes++; }
+
+typedef struct { uint32_t key; bool used; int32_t length; uint8_t data[PERSIST_DATA_MAX_LENGTH]; } PersistEntry;
+static PersistEntry s_persist[HOST_MAX_PERSIST];
+
+static PersistEntry *persist_entry(uint32_t key, bool create) {
+  PersistEntry *free_entry = NULL;
+  for (int i = 0; i < HOST_MAX_PERSIST; i++) {
+    if (s_persist[i].used && s_persist[i].key == key) { return &s_persist[i]; }
+    if (!s_persist[i].used && !free_entry) { free_entry = &s_persist[i]; }
+  }
+  if (!create || !free_entry) { return NULL; }
+  free_entry->used = true; free_entry->key = key;
+  return free_entry;
+}
+
+bool persist_exists(const uint32_t key) { return persist_entry(key, false) != NULL; }
+int32_t persist_read_int(const uint32_t key) {
+  PersistEntry *entry = persist_entry(key, false);
+  int32_t value = 0;
+  if (entry && entry->length == sizeof(value)) { memcpy(&value, entry->data, sizeof(value)); }
+  return value;
+}
+int persist_read_string(const uint32_t key, char *buffer, const size_t buffer_size) {
+  PersistEntry *entry = persist_entry(key, false);
+  if (!entry || buffer_size == 0) { return -1; }
+  size_t length = MIN((size_t)entry->length, buffer_size);
+  memcpy(buffer, entry->data, length);
+  buffer[buffer_size - 1] = '\0';
+  return (int)length;
+}
+int persist_write_int(const uint32_t key, const int32_t value) {
+  PersistEntry *entry = persist_entry(key, true);
+  if (!entry) { return -1; }
+  memcpy(entry->data, &value, sizeof(value)); entry->length = sizeof(value);
+  host_stats.persist_writes++;
+  return sizeof(value);
+}
+int persist_write_string(const uint32_t key, const char *cstring) {
+  PersistEntry *entry = persist_entry(key, true);
+  if (!entry) { return -1; }
+  size_t length = MIN(strlen(cstring) + 1, (size_t)PERSIST_STRING_MAX_LENGTH);
+  memcpy(entry->data, cstring, length); entry->data[length - 1] = '\0'; entry->length = (int32_t)length;
+  host_stats.persist_writes++;
+  return (int)length;
+}
+
+// Event loop and report
+
+void host_set_event_loop(void (*loop)(void)) { s_event_loop = loop; }
+void app_event_loop(void) { render(); if (s_event_loop) { s_event_loop(); } }
+
+static int compare_callbacks(const void *a, const void *b) {
+  const HostCallbackStats *x = a, *y = b;
+  return x->cpu_ns < y->cpu_ns ? 1 : x->cpu_ns > y->cpu_ns ? -1 : 0;
+}
+
+void host_report(FILE *out) {
+  qsort(s_callbacks, s_callback_count, sizeof(s_callbacks[0]), compare_callbacks);
+  fprintf(out, "%-36s %8s %12s %10s %10s\n", "callback", "calls", "cpu total us", "avg us", "max us");
+  for (int i = 0; i < s_callback_count; i++) {
+    HostCallbackStats *stats = &s_callbacks[i];
+    fprintf(out, "%-36s %8u %12.1f %10.2f %10.2f\n", stats->name, (unsigned)stats->calls, stats->cpu_ns / 1000.0, stats->cpu_ns / 1000.0 / stats->calls, stats->max_ns / 1000.0);
+  }
+  fprintf(out, "timers: %u registered, %u rescheduled, %u cancelled, %u fired, %u pending at most, %u left at exit\n",
+          (unsigned)host_stats.timers_registered, (unsigned)host_stats.timers_rescheduled, (unsigned)host_stats.timers_cancelled,
+          (unsigned)host_stats.timers_fired, (unsigned)host_stats.timers_pending_peak, (unsigned)s_timers_pending);
+  fprintf(out, "layers: %u invalidations, %u frames, %u update procs, %u fills, %u menu rows\n",
+          (unsigned)host_stats.invalidations, (unsigned)host_stats.frames, (unsigned)host_stats.update_procs, (unsigned)host_stats.fills, (unsigned)host_stats.menu_rows);
+  fprintf(out, "heap: %zu bytes peak in %u blocks at most, %zu bytes in %u blocks left at exit\n",
+          host_stats.heap_peak, (unsigned)host_stats.heap_blocks_peak, host_stats.heap_current, (unsigned)host_stats.heap_blocks);
+  fprintf(out, "appmessage: %u received (%u bytes), %u dropped, %u sent (%u bytes), %u busy\n",
+          (unsigned)host_stats.inbox_received, (unsigned)host_stats.inbox_bytes, (unsigned)host_stats.inbox_dropped,
+          (unsigned)host_stats.outbox_sent, (unsigned)host_stats.outbox_bytes, (unsigned)host_stats.outbox_busy);
+  fprintf(out, "other: %u persist writes, %u vibes, %u log lines\n", (unsigned)host_stats.persist_writes, (unsigned)host_stats.vibes, (unsigned)host_stats.logs);
+}
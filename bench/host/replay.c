@@ -0,0 +1,209 @@
+// Replays a recorded message and button trace through the watch app on the host.
+//
+//   make -C bench/host && bench/host/replay [-v] bench/host/traces/playback.trace
+//
+// The app is compiled in from src/c/pebble-sonos-controller.c against the stub
+// SDK in this directory, so its static callbacks are driven directly. Each trace
+// line is "<ms> <event> [args]", with ms on the app's virtual clock since launch;
+// timers, acks and minute ticks due before an event run first. Events:
+//
+//   inbox KEY=VALUE ...   deliver a message; VALUE is an integer, "text" or x:hex bytes
+//   drop                  the inbox dropped a message
+//   ack / nack            the phone acknowledged / rejected the message on the wire
+//   autoack MS | off      acknowledge every send MS after it goes out
+//   click BUTTON          up, select, down or back
+//   hold BUTTON MS        long press, released after MS
+//   focus 0|1             the app lost / regained focus
+//   end                   stop replaying (the app then exits as usual)
+//
+// Keys are the app's KEY_* names or numbers. With -v the app log and every
+// outbox message are printed as they happen. At exit the CPU time of each
+// callback, timer use, layer invalidations, frames drawn and the heap
+// high-water mark of everything allocated through the SDK are reported, and
+// the app's cover cache counters when the trace offered any art.
+#include <ctype.h>
+#include <errno.h>
+#include "host.h"
+
+// The app's main() falls off its end, which is fine for main but not once it is renamed
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wreturn-type"
+#define main watch_main
+#include "../../src/c/pebble-sonos-controller.c"
+#undef main
+#pragma GCC diagnostic pop
+
+#define TRACE_LINE_MAX 4096
+#define TRACE_DICT_MAX 2048
+
+typedef struct { const char *name; uint32_t key; } TraceKeyName;
+#define TRACE_KEY(key) { #key, key }
+static const TraceKeyName s_trace_keys[] = {
+  TRACE_KEY(KEY_CMD_PLAY), TRACE_KEY(KEY_CMD_PAUSE), TRACE_KEY(KEY_CMD_STOP),
+  TRACE_KEY(KEY_CMD_VOL_UP), TRACE_KEY(KEY_CMD_VOL_DOWN), TRACE_KEY(KEY_CMD_PREV_TRACK), TRACE_KEY(KEY_CMD_NEXT_TRACK),
+  TRACE_KEY(KEY_CMD_GET_STATUS), TRACE_KEY(KEY_STATUS_PLAY_STATE), TRACE_KEY(KEY_STATUS_VOLUME),
+  TRACE_KEY(KEY_STATUS_MUTE_STATE), TRACE_KEY(KEY_STATUS_ERROR_MSG), TRACE_KEY(KEY_CONFIG_IP_ADDRESS), TRACE_KEY(KEY_STATUS_TRACK_TITLE),
+  TRACE_KEY(KEY_STATUS_ARTIST_NAME), TRACE_KEY(KEY_STATUS_ALBUM_NAME), TRACE_KEY(KEY_STATUS_PACKED), TRACE_KEY(KEY_STATUS_META_HASH),
+  TRACE_KEY(KEY_STATUS_SEQ), TRACE_KEY(KEY_STATUS_BASE_SEQ), TRACE_KEY(KEY_CMD_RESYNC), TRACE_KEY(KEY_STATUS_POSITION),
+  TRACE_KEY(KEY_STATUS_DURATION), TRACE_KEY(KEY_ART_HASH), TRACE_KEY(KEY_ART_LENGTH), TRACE_KEY(KEY_ART_OFFSET),
+  TRACE_KEY(KEY_ART_DATA), TRACE_KEY(KEY_CMD_ART_REQUEST), TRACE_KEY(KEY_CMD_ZONE_LIST), TRACE_KEY(KEY_ZONE_INDEX),
+  TRACE_KEY(KEY_ZONE_COUNT), TRACE_KEY(KEY_ZONE_NAME), TRACE_KEY(KEY_ZONE_STATE), TRACE_KEY(KEY_ZONE_TITLE),
+  TRACE_KEY(KEY_CMD_SELECT_ZONE), TRACE_KEY(KEY_TRACE_SEQ), TRACE_KEY(KEY_TRACE_SENT_MS), TRACE_KEY(KEY_TRACE_TIMINGS),
+  TRACE_KEY(KEY_CMD_BROWSE), TRACE_KEY(KEY_BROWSE_SOURCE), TRACE_KEY(KEY_BROWSE_INDEX), TRACE_KEY(KEY_BROWSE_COUNT),
+  TRACE_KEY(KEY_BROWSE_TITLE), TRACE_KEY(KEY_BROWSE_DETAIL), TRACE_KEY(KEY_CMD_BROWSE_PLAY), TRACE_KEY(KEY_BROWSE_DIRECTION),
+  TRACE_KEY(KEY_STATUS_HEALTH), TRACE_KEY(KEY_CMD_SEEK),
+};
+
+static FILE *s_trace;
+static const char *s_trace_path;
+static int s_trace_line = 0;
+static uint32_t s_trace_events = 0;
+
+static void trace_fail(const char *what) {
+  fprintf(stderr, "%s:%d: %s\n", s_trace_path, s_trace_line, what);
+  exit(1);
+}
+
+static bool trace_key(const char *name, size_t length, uint32_t *key) {
+  if (isdigit((unsigned char)name[0])) { *key = (uint32_t)strtoul(name, NULL, 10); return true; }
+  for (size_t i = 0; i < sizeof(s_trace_keys) / sizeof(s_trace_keys[0]); i++) {
+    if (strlen(s_trace_keys[i].name) == length && strncmp(s_trace_keys[i].name, name, length) == 0) { *key = s_trace_keys[i].key; return true; }
+  }
+  return false;
+}
+
+static ButtonId trace_button(const char *name) {
+  if (strcmp(name, "up") == 0) { return BUTTON_ID_UP; }
+  if (strcmp(name, "select") == 0) { return BUTTON_ID_SELECT; }
+  if (strcmp(name, "down") == 0) { return BUTTON_ID_DOWN; }
+  if (strcmp(name, "back") == 0) { return BUTTON_ID_BACK; }
+  trace_fail("unknown button");
+  return BUTTON_ID_BACK;
+}
+
+// Parse "KEY=VALUE ..." into a dictionary the way the phone would have written it
+static uint16_t trace_dict(char *args, uint8_t *buffer) {
+  DictionaryIterator iter;
+  dict_write_begin(&iter, buffer, TRACE_DICT_MAX);
+  char *p = args;
+  while (*p) {
+    while (isspace((unsigned char)*p)) { p++; }
+    if (!*p) { break; }
+    char *equals = strchr(p, '=');
+    uint32_t key;
+    if (!equals || !trace_key(p, equals - p, &key)) { trace_fail("bad key"); }
+    p = equals + 1;
+    DictionaryResult result;
+    if (*p == '"') {
+      char text[TRACE_LINE_MAX], *out = text;
+      for (p++; *p && *p != '"'; p++) { if (*p == '\\' && p[1]) { p++; } *out++ = *p; }
+      if (*p != '"') { trace_fail("unterminated string"); }
+      *out = '\0'; p++;
+      result = dict_write_cstring(&iter, key, text);
+    } else if (p[0] == 'x' && p[1] == ':') {
+      uint8_t data[TRACE_DICT_MAX];
+      uint16_t length = 0;
+      for (p += 2; isxdigit((unsigned char)p[0]) && isxdigit((unsigned char)p[1]) && length < sizeof(data); p += 2) {
+        char byte[3] = { p[0], p[1], '\0' };
+        data[length++] = (uint8_t)strtoul(byte, NULL, 16);
+      }
+      result = dict_write_data(&iter, key, data, length);
+    } else {
+      char *end;
+      errno = 0;
+      long long value = strtoll(p, &end, 0);
+      if (end == p || errno) { trace_fail("bad value"); }
+      p = end;
+      result = value < 0 ? dict_write_int32(&iter, key, (int32_t)value) : dict_write_uint32(&iter, key, (uint32_t)value);
+    }
+    if (result != DICT_OK) { trace_fail("message too large"); }
+  }
+  return (uint16_t)dict_write_end(&iter);
+}
+
+static void trace_replay(void) {
+  char line[TRACE_LINE_MAX];
+  while (fgets(line, sizeof(line), s_trace)) {
+    s_trace_line++;
+    char *p = line;
+    while (isspace((unsigned char)*p)) { p++; }
+    if (!*p || *p == '#') { continue; }
+    p[strcspn(p, "\r\n")] = '\0';
+
+    char *end;
+    unsigned long long at_ms = strtoull(p, &end, 10);
+    if (end == p) { trace_fail("missing time"); }
+    if (at_ms < host_now_ms()) { trace_fail("time goes backwards"); }
+    p = end;
+    while (isspace((unsigned char)*p)) { p++; }
+    char *event = p;
+    while (*p && !isspace((unsigned char)*p)) { p++; }
+    if (*p) { *p++ = '\0'; }
+    while (isspace((unsigned char)*p)) { p++; }
+
+    host_advance_to(at_ms);
+    s_trace_events++;
+    if (strcmp(event, "inbox") == 0) {
+      uint8_t buffer[TRACE_DICT_MAX];
+      uint16_t size = trace_dict(p, buffer);
+      host_inbox(buffer, size);
+    } else if (strcmp(event, "drop") == 0) {
+      host_inbox_drop(APP_MSG_BUFFER_OVERFLOW);
+    } else if (strcmp(event, "ack") == 0) {
+      host_outbox_ack(true, APP_MSG_OK);
+    } else if (strcmp(event, "nack") == 0) {
+      host_outbox_ack(false, APP_MSG_SEND_TIMEOUT);
+    } else if (strcmp(event, "autoack") == 0) {
+      host_outbox_autoack(strcmp(p, "off") == 0 ? -1 : atoi(p));
+    } else if (strcmp(event, "click") == 0) {
+      host_click(trace_button(p));
+    } else if (strcmp(event, "hold") == 0) {
+      char *hold = p;
+      while (*hold && !isspace((unsigned char)*hold)) { hold++; }
+      if (*hold) { *hold++ = '\0'; }
+      host_hold(trace_button(p), (uint32_t)atoi(hold));
+    } else if (strcmp(event, "focus") == 0) {
+      host_focus(atoi(p) != 0);
+    } else if (strcmp(event, "end") == 0) {
+      break;
+    } else {
+      trace_fail("unknown event");
+    }
+  }
+}
+
+#define NAME_CALLBACK(fn) host_name_callback((void *)(fn), #fn)
+
+int main(int argc, char **argv) {
+  int arg = 1;
+  if (arg < argc && strcmp(argv[arg], "-v") == 0) { host_verbose = true; arg++; }
+  if (arg != argc - 1) { fprintf(stderr, "usage: %s [-v] TRACE\n", argv[0]); return 2; }
+  s_trace_path = argv[arg];
+  s_trace = fopen(s_trace_path, "r");
+  if (!s_trace) { perror(s_trace_path); return 1; }
+
+  NAME_CALLBACK(inbox_received_callback); NAME_CALLBACK(inbox_dropped_callback);
+  NAME_CALLBACK(outbox_sent_callback); NAME_CALLBACK(outbox_failed_callback);
+  NAME_CALLBACK(select_click_handler); NAME_CALLBACK(up_click_handler); NAME_CALLBACK(down_click_handler);
+  NAME_CALLBACK(select_long_click_handler); NAME_CALLBACK(select_long_click_release_handler);
+  NAME_CALLBACK(status_update_timer_callback); NAME_CALLBACK(delayed_ui_update_callback);
+  NAME_CALLBACK(volume_display_revert_timer_callback); NAME_CALLBACK(mode_revert_timer_callback);
+  NAME_CALLBACK(cmd_retry_timer_callback); NAME_CALLBACK(art_stall_timer_callback);
+  NAME_CALLBACK(zone_hold_timer_callback); NAME_CALLBACK(progress_timer_callback); NAME_CALLBACK(browse_retry_timer_callback);
+  NAME_CALLBACK(scrub_commit_timer_callback);
+  NAME_CALLBACK(app_focus_changed); NAME_CALLBACK(tick_handler);
+
+  host_set_event_loop(trace_replay);
+  watch_main();
+  fclose(s_trace);
+
+  printf("trace: %s, %u events over %llu ms\n", s_trace_path, (unsigned)s_trace_events, (unsigned long long)host_now_ms());
+  host_report(stdout);
+  // The app's cover cache, for traces with album art (bench/e2e-bench.js --art)
+  if (s_art_stats.offers) {
+    printf("art: %u offers, %u cache hits, %u transfers, %u bytes, %u resumes, %u abandoned\n", (unsigned)s_art_stats.offers,
+           (unsigned)s_art_stats.hits, (unsigned)s_art_stats.transfers, (unsigned)s_art_stats.bytes, (unsigned)s_art_stats.resumes,
+           (unsigned)s_art_stats.abandoned);
+  }
+  return 0;
+}
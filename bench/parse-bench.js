@@ -0,0 +1,130 @@
+// Parse benchmark for GetPositionInfo responses.
+//
+//   node bench/parse-bench.js
+//
+// Compares the single-pass parser in src/pkjs/soap.js with the original
+// decode-everything-then-search approach on every response in bench/corpus.
+// Allocated bytes are the heap growth over a batch small enough that no
+// scavenge runs inside it, so they need --expose-gc and a large young
+// generation; without them the bench runs itself again with both flags.
+
+var childProcess = require('child_process');
+var fs = require('fs');
+var path = require('path');
+
+var GC_FLAGS = ['--expose-gc', '--max-semi-space-size=64'];
+
+if (!global.gc) {
+  if (process.env.PARSE_BENCH_REEXEC) {
+    console.error('parse-bench: global.gc is still missing with ' + GC_FLAGS.join(' '));
+    process.exit(1);
+  }
+  var child = childProcess.spawnSync(process.execPath, GC_FLAGS.concat([__filename], process.argv.slice(2)), {
+    stdio: 'inherit',
+    env: Object.assign({}, process.env, { PARSE_BENCH_REEXEC: '1' })
+  });
+  process.exit(child.status === null ? 1 : child.status);
+}
+
+var soap = require('../src/pkjs/soap.js');
+
+var ITERATIONS = 2000;
+var ALLOC_BATCH = 100;
+
+// The parser this replaced: five global replaces over the whole metadata blob,
+// then one indexOf scan per field. It is extended to the fields the single-pass
+// parser returns (cover URI, stream content, position and duration, and the
+// radio stream split), and decodes the second level of escaping in each value,
+// so both produce the same result.
+function legacyParse(response) {
+  function element(text, open, close) {
+    var start = text.indexOf(open);
+    if (start === -1) return '';
+    var end = text.indexOf(close, start);
+    return end === -1 ? '' : text.substring(start + open.length, end);
+  }
+  function unescape(text) {
+    return text.replace(/&lt;/g, '<')
+               .replace(/&gt;/g, '>')
+               .replace(/&quot;/g, '"')
+               .replace(/&apos;/g, "'")
+               .replace(/&#(\d+);/g, function(match, code) { return String.fromCharCode(parseInt(code, 10)); })
+               .replace(/&amp;/g, '&');
+  }
+  function seconds(text) {
+    var parts = text.split(':');
+    if (parts.length !== 3) return 0;
+    var total = parseInt(parts[0], 10) * 3600 + parseInt(parts[1], 10) * 60 + parseInt(parts[2], 10);
+    return isNaN(total) ? 0 : total;
+  }
+  var metadataStart = response.indexOf('<TrackMetaData>') + 14;
+  var metadataEnd = response.indexOf('</TrackMetaData>');
+  var encodedMetadata = response.substring(metadataStart, metadataEnd);
+  encodedMetadata = encodedMetadata.replace(/&lt;/g, '<')
+                                   .replace(/&gt;/g, '>')
+                                   .replace(/&quot;/g, '"')
+                                   .replace(/&apos;/g, "'")
+                                   .replace(/&amp;/g, '&');
+  var result = {
+    title: unescape(element(encodedMetadata, '<dc:title>', '</dc:title>')),
+    artist: unescape(element(encodedMetadata, '<dc:creator>', '</dc:creator>')),
+    album: unescape(element(encodedMetadata, '<upnp:album>', '</upnp:album>')),
+    albumArtURI: unescape(element(encodedMetadata, '<upnp:albumArtURI>', '</upnp:albumArtURI>')),
+    streamContent: unescape(element(encodedMetadata, '<r:streamContent>', '</r:streamContent>')),
+    position: seconds(element(response, '<RelTime>', '</RelTime>')),
+    duration: seconds(element(response, '<TrackDuration>', '</TrackDuration>'))
+  };
+  if (result.streamContent && !result.artist) {
+    var split = result.streamContent.indexOf(' - ');
+    result.album = result.album || result.title;
+    if (split !== -1) {
+      result.artist = result.streamContent.substring(0, split);
+      result.title = result.streamContent.substring(split + 3);
+    } else {
+      result.title = result.streamContent;
+    }
+  }
+  return result;
+}
+
+function measure(parse, xml) {
+  var sink = null;
+  for (var w = 0; w < ITERATIONS; w++) {
+    sink = parse(xml);
+  }
+  var start = process.hrtime();
+  for (var i = 0; i < ITERATIONS; i++) {
+    sink = parse(xml);
+  }
+  var elapsed = process.hrtime(start);
+  var micros = (elapsed[0] * 1e6 + elapsed[1] / 1e3) / ITERATIONS;
+
+  global.gc();
+  var before = process.memoryUsage().heapUsed;
+  for (var j = 0; j < ALLOC_BATCH; j++) {
+    sink = parse(xml);
+  }
+  var bytes = (process.memoryUsage().heapUsed - before) / ALLOC_BATCH;
+  return { micros: micros, bytes: bytes, sink: sink };
+}
+
+function pad(text, width) {
+  text = String(text);
+  while (text.length < width) text += ' ';
+  return text;
+}
+
+var corpusDir = path.join(__dirname, 'corpus');
+var files = fs.readdirSync(corpusDir).filter(function(name) { return /\.xml$/.test(name); }).sort();
+
+console.log(pad('response', 18) + pad('size', 8) + pad('legacy us', 12) + pad('legacy B', 12) +
+            pad('single us', 12) + pad('single B', 12));
+
+files.forEach(function(name) {
+  var xml = fs.readFileSync(path.join(corpusDir, name), 'utf8');
+  var legacy = measure(legacyParse, xml);
+  var single = measure(soap.parsePositionInfo, xml);
+  console.log(pad(name.replace(/\.xml$/, ''), 18) + pad(xml.length, 8) +
+              pad(legacy.micros.toFixed(2), 12) + pad(Math.round(legacy.bytes), 12) +
+              pad(single.micros.toFixed(2), 12) + pad(Math.round(single.bytes), 12));
+});
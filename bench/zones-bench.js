@@ -0,0 +1,209 @@
+// Zone topology and fan-out benchmark against local stand-in speakers.
+//
+//   node bench/zones-bench.js [speakers]
+//
+// Starts one HTTP server per speaker (default 8), grouped into a household
+// the way ZoneGroupTopology#GetZoneGroupState reports it, each answering with
+// a fixed artificial latency. Using src/pkjs/zones.js it then reports:
+//   - discovery time, cold and with a dead speaker first in the seed list
+//   - topology cache hit rate over a simulated hour of status polls with two
+//     regroupings, under the app's TTL
+//   - zone picker fan-out latency (GetTransportInfo + GetPositionInfo per
+//     group) at several concurrency limits
+
+var http = require('http');
+var soap = require('../src/pkjs/soap.js');
+var zones = require('../src/pkjs/zones.js');
+
+var SPEAKERS = parseInt(process.argv[2], 10) || 8;
+var LATENCY_MS = [35, 60, 45, 80, 40, 55, 70, 50]; // per speaker, repeating
+var STATUS_POLL_MS = 15 * 1000;                    // POLL_PLAYING_MAX_MS in the watch app
+var RUNS = 5;
+
+var speakers = [];
+
+function escapeXml(text) {
+  return text.replace(/&/g, '&amp;').replace(/</g, '&lt;').replace(/>/g, '&gt;').replace(/"/g, '&quot;');
+}
+
+// Pairs of speakers share a group; the rest play alone
+function zoneGroupState() {
+  var xml = '<ZoneGroups>';
+  for (var i = 0; i < speakers.length; i += (i < 4 ? 2 : 1)) {
+    var members = i < 4 ? speakers.slice(i, i + 2) : [speakers[i]];
+    xml += '<ZoneGroup Coordinator="' + members[0].uuid + '" ID="' + members[0].uuid + ':1">';
+    members.forEach(function(speaker) {
+      xml += '<ZoneGroupMember UUID="' + speaker.uuid + '" Location="http://127.0.0.1:' + speaker.port +
+             '/xml/device_description.xml" ZoneName="' + escapeXml(speaker.name) + '"/>';
+    });
+    xml += '</ZoneGroup>';
+  }
+  return xml + '</ZoneGroups>';
+}
+
+function envelope(action, body) {
+  return '<s:Envelope xmlns:s="http://schemas.xmlsoap.org/soap/envelope/"><s:Body><u:' + action + 'Response>' +
+         body + '</u:' + action + 'Response></s:Body></s:Envelope>';
+}
+
+function answer(speaker, action) {
+  switch (action) {
+    case 'GetZoneGroupState':
+      return envelope(action, '<ZoneGroupState>' + escapeXml(zoneGroupState()) + '</ZoneGroupState>');
+    case 'GetTransportInfo':
+      return envelope(action, '<CurrentTransportState>' + (speaker.index % 3 ? 'PLAYING' : 'PAUSED_PLAYBACK') + '</CurrentTransportState>');
+    case 'GetPositionInfo': {
+      var didl = '<DIDL-Lite><item><dc:title>Track ' + speaker.index + '</dc:title><dc:creator>Artist</dc:creator>' +
+                 '<upnp:album>Album</upnp:album></item></DIDL-Lite>';
+      return envelope(action, '<TrackDuration>0:03:00</TrackDuration><TrackMetaData>' + escapeXml(didl) +
+                      '</TrackMetaData><RelTime>0:01:00</RelTime>');
+    }
+  }
+  return null;
+}
+
+function startSpeaker(index, done) {
+  var speaker = { index: index, uuid: 'RINCON_BENCH' + (1400 + index), name: 'Room ' + (index + 1) + (index === 0 ? ' & Hall' : ''),
+                  latency: LATENCY_MS[index % LATENCY_MS.length], requests: 0 };
+  speaker.server = http.createServer(function(req, res) {
+    req.resume();
+    req.on('end', function() {
+      speaker.requests++;
+      var action = String(req.headers.soapaction || '').replace(/^.*#/, '');
+      var body = answer(speaker, action);
+      setTimeout(function() {
+        res.writeHead(body ? 200 : 500, { 'Content-Type': 'text/xml' });
+        res.end(body || '');
+      }, speaker.latency);
+    });
+  });
+  speaker.server.listen(0, '127.0.0.1', function() {
+    speaker.port = speaker.server.address().port;
+    speaker.host = '127.0.0.1:' + speaker.port;
+    done(speaker);
+  });
+}
+
+// The same shape as the request function index.js hands to Topology
+function request(url, headers, body, callback) {
+  var match = /^http:\/\/([^:\/]+):(\d+)(\/.*)$/.exec(url);
+  var req = http.request({ host: match[1], port: match[2], path: match[3], method: 'POST', headers: headers }, function(res) {
+    var parts = [];
+    res.on('data', function(part) { parts.push(part); });
+    res.on('end', function() {
+      callback(res.statusCode === 200 ? null : 'HTTP Error: ' + res.statusCode, Buffer.concat(parts).toString());
+    });
+  });
+  req.on('error', function(e) { callback('Network Error', null); });
+  req.end(body);
+}
+
+function soapCall(host, action, callback) {
+  var body = '<s:Envelope xmlns:s="http://schemas.xmlsoap.org/soap/envelope/"><s:Body><u:' + action +
+             ' xmlns:u="urn:schemas-upnp-org:service:AVTransport:1"><InstanceID>0</InstanceID></u:' + action +
+             '></s:Body></s:Envelope>';
+  request('http://' + host + '/MediaRenderer/AVTransport/Control',
+          { 'SOAPAction': 'urn:schemas-upnp-org:service:AVTransport:1#' + action, 'Content-Type': 'text/xml; charset="utf-8"' },
+          body, callback);
+}
+
+// pollZones() from index.js, with the speaker calls made directly
+function pollZones(groups, limit, callback) {
+  var started = Date.now();
+  var results = groups.map(function() { return { state: '', title: '' }; });
+  var tasks = [];
+  groups.forEach(function(group, i) {
+    tasks.push(function(done) {
+      soapCall(group.coordinator.host, 'GetTransportInfo', function(err, response) {
+        results[i].state = err ? 'ERROR' : soap.extractValue(response, 'CurrentTransportState');
+        done();
+      });
+    });
+    tasks.push(function(done) {
+      soapCall(group.coordinator.host, 'GetPositionInfo', function(err, response) {
+        if (!err) results[i].title = soap.parsePositionInfo(response).title;
+        done();
+      });
+    });
+  });
+  zones.runLimited(tasks, limit, function() { callback(results, Date.now() - started); });
+}
+
+function median(values) {
+  var sorted = values.slice().sort(function(a, b) { return a - b; });
+  return sorted[sorted.length >> 1];
+}
+
+function discovery(seeds, callback) {
+  var topology = new zones.Topology(request);
+  var started = Date.now();
+  topology.get(seeds, function(err, groups) { callback(err, groups, Date.now() - started); });
+}
+
+// A simulated hour of status polls on a fake clock: one lookup per poll, the
+// topology invalidated twice as if the household had been regrouped
+function simulateSession(callback) {
+  var realNow = Date.now;
+  var clock = realNow();
+  Date.now = function() { return clock; };
+  var topology = new zones.Topology(request);
+  var polls = 3600 * 1000 / STATUS_POLL_MS;
+  var log = console.log;
+  console.log = function() {};
+  (function poll(i) {
+    if (i === polls) {
+      Date.now = realNow;
+      console.log = log;
+      callback(topology.stats, polls);
+      return;
+    }
+    if (i === 100 || i === 170) topology.invalidate('regrouped');
+    topology.get([speakers[0].host], function() {
+      clock += STATUS_POLL_MS;
+      poll(i + 1);
+    });
+  })(0);
+}
+
+(function start(i) {
+  if (i < SPEAKERS) {
+    startSpeaker(i, function(speaker) { speakers.push(speaker); start(i + 1); });
+    return;
+  }
+  var log = console.log;
+  console.log = function() {};
+
+  discovery([speakers[0].host], function(err, groups, coldMs) {
+    // A port nothing listens on stands in for a speaker that has been unplugged
+    discovery(['127.0.0.1:1', speakers[1].host], function(err2, groups2, fallbackMs) {
+      console.log = log;
+      console.log(SPEAKERS + ' speakers in ' + groups.length + ' groups: ' +
+                  groups.map(function(group) { return zones.groupName(group); }).join(', '));
+      console.log('Discovery: ' + coldMs + ' ms cold, ' + fallbackMs + ' ms with a dead first seed');
+
+      simulateSession(function(stats, polls) {
+        console.log('Topology cache over 1 h of ' + (STATUS_POLL_MS / 1000) + ' s polls: ' + stats.hits + '/' + stats.lookups +
+                    ' hits (' + (100 * stats.hits / stats.lookups).toFixed(1) + '%), ' + stats.fetches + ' refreshes, ' +
+                    stats.invalidations + ' invalidations');
+
+        var limits = [1, 2, 4, 8];
+        console.log('Fan-out over ' + groups.length + ' groups (' + (2 * groups.length) + ' requests), median of ' + RUNS + ' runs:');
+        (function next(l, samples) {
+          if (samples.length === RUNS) {
+            console.log('  concurrency ' + limits[l] + ': ' + median(samples) + ' ms');
+            l++;
+            samples = [];
+          }
+          if (l === limits.length) {
+            speakers.forEach(function(speaker) { speaker.server.close(); });
+            return;
+          }
+          pollZones(groups, limits[l], function(results, ms) {
+            samples.push(ms);
+            next(l, samples);
+          });
+        })(0, []);
+      });
+    });
+  });
+})(0);
@@ -1,16 +1,18 @@
 #include <pebble.h>
 #include <ctype.h>
 
-enum MessageKeys { KEY_CMD_APP_READY=0, KEY_CMD_PLAY=1, KEY_CMD_PAUSE=2, KEY_CMD_STOP=3, KEY_CMD_VOL_UP=4, KEY_CMD_VOL_DOWN=5, KEY_CMD_PREV_TRACK=6, KEY_CMD_NEXT_TRACK=7, KEY_CMD_GET_STATUS=8, KEY_JS_READY=9, KEY_STATUS_PLAY_STATE=10, KEY_STATUS_VOLUME=11, KEY_STATUS_MUTE_STATE=12, KEY_STATUS_ERROR_MSG=13, KEY_CONFIG_IP_ADDRESS=14, KEY_STATUS_TRACK_TITLE=15, KEY_STATUS_ARTIST_NAME=16, KEY_STATUS_ALBUM_NAME=17 };
+enum MessageKeys { KEY_CMD_PLAY=1, KEY_CMD_PAUSE=2, KEY_CMD_STOP=3, KEY_CMD_VOL_UP=4, KEY_CMD_VOL_DOWN=5, KEY_CMD_PREV_TRACK=6, KEY_CMD_NEXT_TRACK=7, KEY_CMD_GET_STATUS=8, KEY_STATUS_PLAY_STATE=10, KEY_STATUS_VOLUME=11, KEY_STATUS_MUTE_STATE=12, KEY_STATUS_ERROR_MSG=13, KEY_CONFIG_IP_ADDRESS=14, KEY_STATUS_TRACK_TITLE=15, KEY_STATUS_ARTIST_NAME=16, KEY_STATUS_ALBUM_NAME=17, KEY_STATUS_PACKED=18, KEY_STATUS_META_HASH=19, KEY_STATUS_SEQ=20, KEY_STATUS_BASE_SEQ=21, KEY_CMD_RESYNC=22, KEY_STATUS_POSITION=23, KEY_STATUS_DURATION=24, KEY_ART_HASH=25, KEY_ART_LENGTH=26, KEY_ART_OFFSET=27, KEY_ART_DATA=28, KEY_CMD_ART_REQUEST=29, KEY_CMD_ZONE_LIST=30, KEY_ZONE_INDEX=31, KEY_ZONE_COUNT=32, KEY_ZONE_NAME=33, KEY_ZONE_STATE=34, KEY_ZONE_TITLE=35, KEY_CMD_SELECT_ZONE=36, KEY_TRACE_SEQ=37, KEY_TRACE_SENT_MS=38, KEY_TRACE_TIMINGS=39, KEY_CMD_BROWSE=40, KEY_BROWSE_SOURCE=41, KEY_BROWSE_INDEX=42, KEY_BROWSE_COUNT=43, KEY_BROWSE_TITLE=44, KEY_BROWSE_DETAIL=45, KEY_CMD_BROWSE_PLAY=46, KEY_BROWSE_DIRECTION=47, KEY_STATUS_HEALTH=48, KEY_CMD_SEEK=49 };
 enum PlayStates { STATE_STOPPED=0, STATE_PLAYING=1, STATE_PAUSED=2, STATE_TRANSITIONING=3, STATE_ERROR=4, STATE_UNKNOWN=5 };
-enum UpDownButtonMode { MODE_VOLUME=0, MODE_TRACK=1 };
-enum BottomAreaMode { DISPLAY_TRACK=0, DISPLAY_VOLUME=1 };
+enum UpDownButtonMode { MODE_VOLUME=0, MODE_TRACK=1, MODE_SCRUB=2 };
+enum BottomAreaMode { DISPLAY_TRACK=0, DISPLAY_VOLUME=1, DISPLAY_SCRUB=2 };
+enum UiDirty { UI_DIRTY_ACTION_BAR=1<<0, UI_DIRTY_VOLUME=1<<1, UI_DIRTY_PROGRESS=1<<2, UI_DIRTY_TRACK=1<<3, UI_DIRTY_TITLE=1<<4, UI_DIRTY_ARTIST=1<<5, UI_DIRTY_ALBUM=1<<6, UI_DIRTY_STATUS=1<<7, UI_DIRTY_ART=1<<8, UI_DIRTY_ALL=0x1FF };
 
 static Window *s_main_window;
 static TextLayer *s_time_layer, *s_title_layer, *s_artist_layer, *s_album_layer, *s_status_text_layer, *s_volume_text_layer;
 static Layer *s_progress_layer;
+static BitmapLayer *s_art_layer;
 static ActionBarLayer *s_action_bar_layer;
-static GBitmap *s_icon_play, *s_icon_pause, *s_icon_vol_up, *s_icon_vol_down, *s_icon_prev_track, *s_icon_next_track;
+static GBitmap *s_icon_play, *s_icon_pause, *s_icon_vol_up, *s_icon_vol_down, *s_icon_prev_track, *s_icon_next_track, *s_icon_seek_back, *s_icon_seek_forward;
 
 static enum PlayStates s_current_play_state = STATE_UNKNOWN;
 static int s_current_volume = -1;
@@ -19,15 +21,42 @@ static char s_title_buffer[32], s_artist_buffer[32], s_album_buffer[32], s_statu
 static AppTimer *s_status_update_timer, *s_volume_display_revert_timer, *s_ui_update_timer = NULL;
 static AppTimer *s_mode_revert_timer = NULL;
 static enum UpDownButtonMode s_up_down_button_mode = MODE_VOLUME;
+
+// Compact status protocol: KEY_STATUS_PACKED holds state (bits 0-3), volume (bits 4-10, 0x7F = unknown),
+// mute (bit 11) and the protocol version (bits 24-31). Messages are deltas against KEY_STATUS_BASE_SEQ.
+#define STATUS_PROTOCOL_VERSION 1
+#define STATUS_VOLUME_UNKNOWN 0x7F
+// Link health (KEY_STATUS_HEALTH) replaces error strings for a speaker the phone cannot reach; any status after it
+// means OK
+enum LinkHealth { HEALTH_OK=0, HEALTH_RETRYING=1, HEALTH_UNREACHABLE=2, HEALTH_NOT_CONFIGURED=3, HEALTH_STATES=4 };
+static const char *const s_health_text[HEALTH_STATES] = { "", "Reconnecting...", "Speaker unreachable", "No IP configured" };
+static int32_t s_status_seq = 0;
+static uint32_t s_meta_hash = 0;
+static uint32_t s_inbox_drops = 0;
+// Launch time, to log how long the first live status takes to arrive
+static uint32_t s_launch_ms = 0;
+static bool s_first_status_seen = false;
+
+// Track position as of s_position_received_at, in milliseconds; duration (seconds) 0 means a stream or unknown
+static int32_t s_track_position_ms = 0, s_track_duration = 0;
+static uint32_t s_position_received_at = 0;
+// Scrub target while one is being picked (ms, -1 for none), shown on the bar in place of the playing position
+static int32_t s_scrub_target_ms = -1;
+static char s_scrub_text_buffer[36];
 static enum BottomAreaMode s_bottom_area_mode = DISPLAY_TRACK;
+static bool s_polling_suspended = false;
 
 static void send_cmd(uint8_t key);
 static void request_status_update();
 static void update_time_layer(struct tm *tick_time);
 static void update_status_text_layer();
-static void update_track_display();
+static void update_track_display(uint16_t dirty);
 static void update_volume_display();
 static void update_progress_layer();
+static void rebase_track_position();
+static void track_progress_finished();
+static void track_progress_resynced(int32_t predicted_ms);
+static void update_art_layer(uint16_t dirty);
 static void update_action_bar_icons();
 static void select_click_handler(ClickRecognizerRef recognizer, void *context);
 static void up_click_handler(ClickRecognizerRef recognizer, void *context);
@@ -37,6 +66,11 @@ static void click_config_provider(void *context);
 static void status_update_timer_callback(void *data);
 static void start_status_updates();
 static void stop_status_updates();
+static void schedule_status_update();
+static void status_received();
+static void status_unreachable();
+static uint32_t now_ms();
+static int32_t current_track_position_ms();
 static void volume_display_revert_timer_callback(void *data);
 static void start_volume_display_revert_timer();
 static void progress_layer_update_proc(Layer *layer, GContext *ctx);
@@ -46,26 +80,168 @@ static void outbox_failed_callback(DictionaryIterator *iterator, AppMessageResul
 static void outbox_sent_callback(DictionaryIterator *iterator, void *context);
 static void tick_handler(struct tm *tick_time, TimeUnits units_changed);
 static bool are_ui_components_valid();
-static void schedule_ui_update();
+static void schedule_ui_update(uint16_t dirty);
+static void apply_ui_updates(uint16_t dirty);
 static void delayed_ui_update_callback(void *context);
 static void main_window_load(Window *window);
 static void main_window_unload(Window *window);
 static void init();
 static void deinit();
-static void app_ready_timer_callback(void *data);
 static char* app_message_result_to_string(AppMessageResult result);
 static void mode_revert_timer_callback(void *data);
+static void art_write_request(DictionaryIterator *iter);
+static void browse_write_request(DictionaryIterator *iter);
+static void browse_write_play(DictionaryIterator *iter);
+static void seek_write_request(DictionaryIterator *iter);
+
+// Commands go through a small ring buffer drained from outbox_sent_callback. Redundant
+// entries are merged while they wait, and transient outbox failures are retried with backoff.
+#define CMD_QUEUE_SIZE 8
+#define CMD_RETRY_MAX 5
+#define CMD_RETRY_BASE_MS 50
+#define CMD_RETRY_MAX_MS 1000
+
+typedef struct { uint8_t key; int8_t count; uint16_t trace_seq; uint32_t pressed_ms; } QueuedCmd;
+typedef struct { uint16_t max_depth, merged, dropped, retries, failed; } CmdQueueStats;
+
+static QueuedCmd s_cmd_queue[CMD_QUEUE_SIZE];
+static uint8_t s_cmd_queue_head = 0, s_cmd_queue_len = 0, s_cmd_retries = 0;
+static bool s_cmd_in_flight = false;
+static AppTimer *s_cmd_retry_timer = NULL;
+static CmdQueueStats s_cmd_stats;
+
+static QueuedCmd *cmd_queue_at(int i) { return &s_cmd_queue[(s_cmd_queue_head + i) % CMD_QUEUE_SIZE]; }
+static void cmd_queue_remove(int i) { for (; i < s_cmd_queue_len - 1; i++) { *cmd_queue_at(i) = *cmd_queue_at(i + 1); } s_cmd_queue_len--; }
+static void cmd_queue_pop() { s_cmd_queue_head = (s_cmd_queue_head + 1) % CMD_QUEUE_SIZE; s_cmd_queue_len--; s_cmd_retries = 0; }
+static void log_cmd_queue_stats() { APP_LOG(APP_LOG_LEVEL_DEBUG, "cmd queue: depth %d (max %d), merged %d, dropped %d, retries %d, failed %d", s_cmd_queue_len, s_cmd_stats.max_depth, s_cmd_stats.merged, s_cmd_stats.dropped, s_cmd_stats.retries, s_cmd_stats.failed); }
+
+static bool is_volume_cmd(uint8_t key) { return key == KEY_CMD_VOL_UP || key == KEY_CMD_VOL_DOWN; }
+static bool is_play_pause_cmd(uint8_t key) { return key == KEY_CMD_PLAY || key == KEY_CMD_PAUSE; }
+// Commands that move playback or its target, which a play/pause must not overtake
+static bool is_transport_cmd(uint8_t key) { return key == KEY_CMD_NEXT_TRACK || key == KEY_CMD_PREV_TRACK || key == KEY_CMD_STOP || key == KEY_CMD_SEEK || key == KEY_CMD_BROWSE_PLAY || key == KEY_CMD_SELECT_ZONE; }
+
+// Command latency tracing. User commands carry a sequence number and the watch clock at the press; the phone echoes
+// both on the status that shows the result, with its own share in KEY_TRACE_TIMINGS (four little-endian uint16 ms:
+// queueing before the SOAP request, its first byte, the rest of the response, and the status refresh after it).
+// Whatever the round trip has left over is the Bluetooth link. The last TRACE_SAMPLES of each command type are kept
+// for the diagnostics screen; a trace costs a few bytes per command and nothing when no command is out.
+#define TRACE_CLOCK_MASK 0x7FFFFFFF
+#define TRACE_SAMPLES 16
+#define TRACE_PENDING 8
+#define TRACE_PHONE_FIELDS 4
+
+enum TraceKind { TRACE_PLAY_PAUSE=0, TRACE_SKIP=1, TRACE_VOLUME=2, TRACE_KINDS=3 };
+typedef struct { uint16_t total, link, queue, speaker, refresh; } TraceSample;
+typedef struct { TraceSample samples[TRACE_SAMPLES]; uint8_t next, count; uint32_t received; } TraceHistogram;
+typedef struct { uint16_t seq; uint8_t kind; } TracePending;
+
+static TraceHistogram s_trace_hist[TRACE_KINDS];
+static TracePending s_trace_pending[TRACE_PENDING];
+static uint16_t s_trace_seq = 0;
+static const char *const s_trace_kind_names[TRACE_KINDS] = { "Play/pause", "Skip", "Volume" };
+
+static int trace_kind(uint8_t key) {
+  if (is_play_pause_cmd(key)) { return TRACE_PLAY_PAUSE; }
+  if (key == KEY_CMD_NEXT_TRACK || key == KEY_CMD_PREV_TRACK) { return TRACE_SKIP; }
+  if (is_volume_cmd(key)) { return TRACE_VOLUME; }
+  return -1;
+}
+static uint32_t trace_clock() { return now_ms() & TRACE_CLOCK_MASK; }
+
+// Sequence 0 marks a free slot, so it is skipped on wrap
+static void trace_start(QueuedCmd *cmd) {
+  int kind = trace_kind(cmd->key);
+  if (kind < 0) { cmd->trace_seq = 0; return; }
+  if (++s_trace_seq == 0) { s_trace_seq = 1; }
+  cmd->trace_seq = s_trace_seq; cmd->pressed_ms = trace_clock();
+  s_trace_pending[s_trace_seq % TRACE_PENDING] = (TracePending) { .seq = s_trace_seq, .kind = kind };
+}
 
-static void send_cmd(uint8_t key) {
-    DictionaryIterator *iter;
-    AppMessageResult result = app_message_outbox_begin(&iter);
-    if (result != APP_MSG_OK) { APP_LOG(APP_LOG_LEVEL_ERROR, "Failed to begin outbox: %d", (int)result); return; }
-    if (!iter) { APP_LOG(APP_LOG_LEVEL_ERROR, "Outbox iter is NULL after successful begin?"); return; }
-    dict_write_uint8(iter, key, 1);
+// Fold a new command into a waiting entry; the head is left alone while it is on the wire
+static bool cmd_queue_merge(uint8_t key, int8_t value) {
+  // Play/pause folds only into the last one waiting, and not across a skip or seek queued after it
+  if (is_play_pause_cmd(key)) {
+    for (int i = s_cmd_queue_len - 1; i >= (s_cmd_in_flight ? 1 : 0); i--) {
+      QueuedCmd *cmd = cmd_queue_at(i);
+      if (is_play_pause_cmd(cmd->key)) { cmd->key = key; return true; }
+      if (is_transport_cmd(cmd->key)) { return false; }
+    }
+    return false;
+  }
+  for (int i = s_cmd_in_flight ? 1 : 0; i < s_cmd_queue_len; i++) {
+    QueuedCmd *cmd = cmd_queue_at(i);
+    if ((key == KEY_CMD_GET_STATUS || key == KEY_CMD_ART_REQUEST || key == KEY_CMD_ZONE_LIST || key == KEY_CMD_BROWSE || key == KEY_CMD_BROWSE_PLAY || key == KEY_CMD_SEEK || key == KEY_CMD_RESYNC) && cmd->key == key) { return true; }
+    if (key == KEY_CMD_SELECT_ZONE && cmd->key == key) { cmd->count = value; return true; }
+    if (is_volume_cmd(key) && is_volume_cmd(cmd->key)) {
+      // Past the whole volume range more clicks change nothing, and the int8_t count would wrap
+      if (key == KEY_CMD_VOL_UP ? cmd->count < 100 : cmd->count > -100) { cmd->count += (key == KEY_CMD_VOL_UP) ? 1 : -1; }
+      if (cmd->count == 0) { cmd_queue_remove(i); }
+      return true;
+    }
+  }
+  return false;
+}
+
+static void cmd_queue_pump();
+static void cmd_retry_timer_callback(void *data) { s_cmd_retry_timer = NULL; cmd_queue_pump(); }
+
+static void cmd_queue_schedule_retry() {
+  if (s_cmd_retry_timer) { return; }
+  uint32_t delay = CMD_RETRY_BASE_MS << s_cmd_retries;
+  if (delay > CMD_RETRY_MAX_MS) { delay = CMD_RETRY_MAX_MS; }
+  s_cmd_retries++; s_cmd_stats.retries++;
+  s_cmd_retry_timer = app_timer_register(delay, cmd_retry_timer_callback, NULL);
+}
+
+// Give up on the head entry once its retries are spent; returns true if it was dropped
+static bool cmd_queue_give_up(AppMessageResult reason) {
+  if (s_cmd_retries < CMD_RETRY_MAX) { return false; }
+  APP_LOG(APP_LOG_LEVEL_ERROR, "Dropping cmd %d after %d retries: %s", cmd_queue_at(0)->key, s_cmd_retries, app_message_result_to_string(reason));
+  cmd_queue_pop(); s_cmd_stats.failed++; log_cmd_queue_stats();
+  s_current_play_state = STATE_ERROR; snprintf(s_status_text_buffer, sizeof(s_status_text_buffer), "Error: TX Fail %s", app_message_result_to_string(reason)); schedule_ui_update(UI_DIRTY_ACTION_BAR | UI_DIRTY_TRACK | UI_DIRTY_STATUS);
+  return true;
+}
+
+static void cmd_queue_pump() {
+  if (s_cmd_in_flight || s_cmd_retry_timer || s_cmd_queue_len == 0) { return; }
+  QueuedCmd *cmd = cmd_queue_at(0);
+  uint8_t key = cmd->key;
+  uint8_t value = cmd->count;
+  if (is_volume_cmd(key)) { key = cmd->count > 0 ? KEY_CMD_VOL_UP : KEY_CMD_VOL_DOWN; value = cmd->count > 0 ? cmd->count : -cmd->count; }
+
+  DictionaryIterator *iter;
+  AppMessageResult result = app_message_outbox_begin(&iter);
+  if (result == APP_MSG_OK && !iter) { result = APP_MSG_INTERNAL_ERROR; }
+  if (result == APP_MSG_OK) {
+    if (key == KEY_CMD_ART_REQUEST) { art_write_request(iter); } else if (key == KEY_CMD_BROWSE) { browse_write_request(iter); } else if (key == KEY_CMD_BROWSE_PLAY) { browse_write_play(iter); } else if (key == KEY_CMD_SEEK) { seek_write_request(iter); } else { dict_write_uint8(iter, key, value); }
+    if (cmd->trace_seq) { dict_write_uint32(iter, KEY_TRACE_SEQ, cmd->trace_seq); dict_write_uint32(iter, KEY_TRACE_SENT_MS, cmd->pressed_ms); }
     dict_write_end(iter);
     result = app_message_outbox_send();
-    if (result != APP_MSG_OK) { APP_LOG(APP_LOG_LEVEL_ERROR, "Failed to send cmd %d: %s (%d)", key, app_message_result_to_string(result), (int)result); }
+  }
+  if (result == APP_MSG_OK) { s_cmd_in_flight = true; return; }
+  APP_LOG(APP_LOG_LEVEL_WARNING, "Failed to send cmd %d: %s (%d)", key, app_message_result_to_string(result), (int)result);
+  if (!cmd_queue_give_up(result)) { cmd_queue_schedule_retry(); } else { cmd_queue_pump(); }
 }
+
+// Volume commands carry a click count, KEY_CMD_SELECT_ZONE an index, the rest 1
+static void send_cmd_value(uint8_t key, int8_t value) {
+  if (cmd_queue_merge(key, value)) {
+    s_cmd_stats.merged++;
+  } else if (s_cmd_queue_len == CMD_QUEUE_SIZE) {
+    s_cmd_stats.dropped++;
+    APP_LOG(APP_LOG_LEVEL_WARNING, "Command queue full, dropping cmd %d", key);
+    log_cmd_queue_stats();
+    return;
+  } else {
+    QueuedCmd *cmd = cmd_queue_at(s_cmd_queue_len++);
+    cmd->key = is_volume_cmd(key) ? KEY_CMD_VOL_UP : key;
+    cmd->count = value;
+    trace_start(cmd);
+    if (s_cmd_queue_len > s_cmd_stats.max_depth) { s_cmd_stats.max_depth = s_cmd_queue_len; }
+  }
+  cmd_queue_pump();
+}
+static void send_cmd(uint8_t key) { send_cmd_value(key, key == KEY_CMD_VOL_DOWN ? -1 : 1); }
 static void request_status_update() { send_cmd(KEY_CMD_GET_STATUS); }
 
 static bool are_ui_components_valid() {
@@ -77,55 +253,578 @@ static bool are_ui_components_valid() {
   return true;
 }
 
+// Only the layers behind the dirty bits are touched. Every layer mutation is counted as an invalidation
+// so the cost of an update can be compared across platforms.
+typedef struct { uint32_t updates, invalidations, progress_redraws, update_ms_total, redraw_ms_total; } UiStats;
+static UiStats s_ui_stats;
+static uint16_t s_ui_dirty = 0;
+static GBitmap *s_action_bar_icons[BUTTON_ID_DOWN + 1];
+#define PROGRESS_NOT_DRAWN (-2)
+static int s_progress_drawn_width = PROGRESS_NOT_DRAWN;
+
+static void set_layer_hidden(Layer *layer, bool hidden) { if (layer_get_hidden(layer) == hidden) { return; } layer_set_hidden(layer, hidden); s_ui_stats.invalidations++; }
+// What each text layer last showed, so setting the same text again neither marks it dirty nor counts. Buffers are
+// rewritten in place, so the text is compared by hash as well as by pointer.
+#define SHOWN_TEXT_SLOTS 8
+typedef struct { TextLayer *layer; const char *text; uint32_t hash; } ShownText;
+static ShownText s_shown_text[SHOWN_TEXT_SLOTS];
+static uint32_t text_hash(const char *text) { uint32_t hash = 2166136261u; while (*text) { hash = (hash ^ (uint8_t)*text++) * 16777619u; } return hash; }
+static ShownText *shown_text_slot(TextLayer *layer) {
+  for (int i = 0; i < SHOWN_TEXT_SLOTS; i++) { if (s_shown_text[i].layer == layer) { return &s_shown_text[i]; } }
+  for (int i = 0; i < SHOWN_TEXT_SLOTS; i++) { if (!s_shown_text[i].layer) { return &s_shown_text[i]; } }
+  return NULL;
+}
+static void forget_shown_text(TextLayer *layer) { ShownText *shown = shown_text_slot(layer); if (shown && shown->layer == layer) { *shown = (ShownText) { 0 }; } }
+static void set_text(TextLayer *layer, const char *text) {
+  uint32_t hash = text_hash(text);
+  ShownText *shown = shown_text_slot(layer);
+  if (shown && shown->layer == layer && shown->text == text && shown->hash == hash) { return; }
+  if (shown) { *shown = (ShownText) { .layer = layer, .text = text, .hash = hash }; }
+  text_layer_set_text(layer, text); s_ui_stats.invalidations++;
+}
+static void set_action_bar_icon(ButtonId button, GBitmap *icon) { if (!icon || s_action_bar_icons[button] == icon) { return; } action_bar_layer_set_icon(s_action_bar_layer, button, icon); s_action_bar_icons[button] = icon; s_ui_stats.invalidations++; }
+
+static void apply_ui_updates(uint16_t dirty) {
+    if (!are_ui_components_valid()) { return; }
+    uint32_t started = now_ms();
+    if (dirty & UI_DIRTY_ACTION_BAR) { update_action_bar_icons(); }
+    if (dirty & UI_DIRTY_VOLUME) { update_volume_display(); }
+    if (dirty & UI_DIRTY_PROGRESS) { update_progress_layer(); }
+    if (dirty & (UI_DIRTY_TRACK | UI_DIRTY_TITLE | UI_DIRTY_ARTIST | UI_DIRTY_ALBUM)) { update_track_display(dirty); }
+    if (dirty & (UI_DIRTY_TRACK | UI_DIRTY_ART)) { update_art_layer(dirty); }
+    if (dirty & UI_DIRTY_STATUS) { update_status_text_layer(); }
+    s_ui_stats.updates++;
+    s_ui_stats.update_ms_total += now_ms() - started;
+    if (s_ui_stats.updates % 20 == 0) {
+      APP_LOG(APP_LOG_LEVEL_DEBUG, "ui: %d updates, %d invalidations, %d progress redraws, update %d ms, redraw %d ms total", (int)s_ui_stats.updates, (int)s_ui_stats.invalidations, (int)s_ui_stats.progress_redraws, (int)s_ui_stats.update_ms_total, (int)s_ui_stats.redraw_ms_total);
+    }
+}
+
 static void delayed_ui_update_callback(void *context) {
     s_ui_update_timer = NULL;
+    uint16_t dirty = s_ui_dirty;
+    s_ui_dirty = 0;
     if (!are_ui_components_valid()) { APP_LOG(APP_LOG_LEVEL_ERROR, "Not updating UI due to invalid components"); return; }
-    update_action_bar_icons();
-    update_volume_display();
-    update_progress_layer();
-    update_track_display();
-    update_status_text_layer();
+    apply_ui_updates(dirty);
 }
 
-static void schedule_ui_update() {
+static void schedule_ui_update(uint16_t dirty) {
+    s_ui_dirty |= dirty;
     if (s_ui_update_timer) { app_timer_reschedule(s_ui_update_timer, 50); return; }
     s_ui_update_timer = app_timer_register(50, delayed_ui_update_callback, NULL);
     if (!s_ui_update_timer) { APP_LOG(APP_LOG_LEVEL_ERROR, "Failed to schedule UI update timer!"); }
 }
+static bool copy_if_changed(char *buffer, size_t size, const char *text) {
+  if (strcmp(buffer, text) == 0) { return false; }
+  strncpy(buffer, text, size - 1); buffer[size - 1] = '\0';
+  return true;
+}
+
+// Cover art is offered by the phone as a content hash (KEY_ART_HASH + KEY_ART_LENGTH). Covers already in the LRU
+// are shown at once; others are requested with KEY_CMD_ART_REQUEST and streamed (KEY_ART_OFFSET + KEY_ART_DATA)
+// straight into a cache slot. A gap or a stall asks the phone to resume from the bytes we already hold.
+#define ART_SIZE 48
+#define ART_CACHE_SIZE 4
+#define ART_STALL_MS 2000
+#define ART_STALL_RETRIES 3
+#if defined(PBL_COLOR)
+#define ART_FORMAT GBitmapFormat8Bit
+#define ART_ROW_BYTES ART_SIZE
+#else
+#define ART_FORMAT GBitmapFormat1Bit
+#define ART_ROW_BYTES ((ART_SIZE + 7) / 8)
+#endif
+#define ART_BYTES (ART_ROW_BYTES * ART_SIZE)
+
+typedef struct { int32_t hash; GBitmap *bitmap; uint32_t last_used; bool complete; } ArtSlot;
+typedef struct { uint32_t offers, hits, transfers, bytes, resumes, abandoned, transfer_ms_total; } ArtStats;
+static ArtSlot s_art_cache[ART_CACHE_SIZE];
+static ArtStats s_art_stats;
+static uint32_t s_art_clock = 0;
+static int32_t s_art_current = 0;
+static ArtSlot *s_art_shown = NULL, *s_art_rx = NULL;
+static uint32_t s_art_received = 0, s_art_rx_started = 0;
+static uint8_t s_art_stalls = 0;
+static AppTimer *s_art_stall_timer = NULL;
+
+static void log_art_stats() {
+  APP_LOG(APP_LOG_LEVEL_DEBUG, "art: %d offers, %d cache hits (%d%%), %d transfers, %d bytes, %d ms avg, %d resumes, %d abandoned", (int)s_art_stats.offers, (int)s_art_stats.hits, (int)(s_art_stats.offers ? 100 * s_art_stats.hits / s_art_stats.offers : 0), (int)s_art_stats.transfers, (int)s_art_stats.bytes, (int)(s_art_stats.transfers ? s_art_stats.transfer_ms_total / s_art_stats.transfers : 0), (int)s_art_stats.resumes, (int)s_art_stats.abandoned);
+}
+
+static ArtSlot *art_cache_find(int32_t hash) {
+  for (int i = 0; i < ART_CACHE_SIZE; i++) { if (s_art_cache[i].complete && s_art_cache[i].hash == hash) { return &s_art_cache[i]; } }
+  return NULL;
+}
+static ArtSlot *art_cache_victim() {
+  ArtSlot *victim = &s_art_cache[0];
+  for (int i = 1; i < ART_CACHE_SIZE; i++) { if (s_art_cache[i].last_used < victim->last_used) { victim = &s_art_cache[i]; } }
+  return victim;
+}
+
+static void art_show(ArtSlot *slot) { if (s_art_shown == slot) { return; } s_art_shown = slot; schedule_ui_update(UI_DIRTY_ART); }
+
+static void art_stall_timer_callback(void *data);
+static void art_arm_stall_timer() { if (s_art_stall_timer) { app_timer_reschedule(s_art_stall_timer, ART_STALL_MS); } else { s_art_stall_timer = app_timer_register(ART_STALL_MS, art_stall_timer_callback, NULL); } }
+static void art_request() { send_cmd(KEY_CMD_ART_REQUEST); art_arm_stall_timer(); }
+// The offset is read when the request actually goes out, so a queued request never asks for stale bytes
+static void art_write_request(DictionaryIterator *iter) { dict_write_int32(iter, KEY_ART_HASH, s_art_rx ? s_art_rx->hash : 0); dict_write_uint32(iter, KEY_CMD_ART_REQUEST, s_art_received); }
+
+static void art_abandon() {
+  if (s_art_stall_timer) { app_timer_cancel(s_art_stall_timer); s_art_stall_timer = NULL; }
+  if (s_art_rx) { s_art_rx->hash = 0; s_art_rx->last_used = 0; s_art_rx = NULL; }
+}
+static void art_stall_timer_callback(void *data) {
+  s_art_stall_timer = NULL;
+  if (!s_art_rx) { return; }
+  if (++s_art_stalls > ART_STALL_RETRIES) {
+    APP_LOG(APP_LOG_LEVEL_WARNING, "Cover transfer stalled at %d of %d bytes, giving up", (int)s_art_received, ART_BYTES);
+    s_art_stats.abandoned++; art_abandon(); return;
+  }
+  s_art_stats.resumes++; art_request();
+}
+
+static void art_offer(int32_t hash, uint32_t length) {
+  s_art_current = hash;
+  if (hash == 0) { art_show(NULL); return; }
+  s_art_stats.offers++;
+  ArtSlot *slot = art_cache_find(hash);
+  if (slot) { s_art_stats.hits++; slot->last_used = ++s_art_clock; art_show(slot); log_art_stats(); return; }
+  art_show(NULL);
+  if (length != ART_BYTES) { APP_LOG(APP_LOG_LEVEL_WARNING, "Ignoring %d byte cover, expected %d", (int)length, ART_BYTES); return; }
+  if (s_art_rx && s_art_rx->hash == hash) { return; }
+  art_abandon();
+  slot = art_cache_victim();
+  if (!slot->bitmap) { slot->bitmap = gbitmap_create_blank(GSize(ART_SIZE, ART_SIZE), ART_FORMAT); }
+  if (!slot->bitmap) { APP_LOG(APP_LOG_LEVEL_ERROR, "No memory for cover art"); return; }
+  slot->hash = hash; slot->complete = false; slot->last_used = ++s_art_clock;
+  s_art_rx = slot; s_art_received = 0; s_art_stalls = 0; s_art_rx_started = now_ms();
+  s_art_stats.transfers++;
+  art_request();
+}
+
+static void art_chunk(int32_t hash, uint32_t offset, const uint8_t *data, uint16_t length) {
+  if (!s_art_rx || s_art_rx->hash != hash) { return; }
+  if (offset != s_art_received) {
+    // A lost chunk leaves a gap; repeats of bytes we already hold are ignored
+    if (offset > s_art_received) { s_art_stats.resumes++; art_request(); }
+    return;
+  }
+  if (length > ART_BYTES - s_art_received) { length = ART_BYTES - s_art_received; }
+  // Rows arrive unpadded and are copied into the bitmap's row stride
+  uint8_t *pixels = gbitmap_get_data(s_art_rx->bitmap);
+  uint16_t stride = gbitmap_get_bytes_per_row(s_art_rx->bitmap);
+  for (uint16_t copied = 0; copied < length;) {
+    uint32_t at = s_art_received + copied;
+    uint16_t column = at % ART_ROW_BYTES, run = ART_ROW_BYTES - column;
+    if (run > length - copied) { run = length - copied; }
+    memcpy(pixels + (at / ART_ROW_BYTES) * stride + column, data + copied, run);
+    copied += run;
+  }
+  s_art_received += length; s_art_stats.bytes += length; s_art_stalls = 0;
+  if (s_art_received < ART_BYTES) { art_arm_stall_timer(); return; }
+
+  ArtSlot *slot = s_art_rx;
+  uint32_t elapsed = now_ms() - s_art_rx_started;
+  slot->complete = true; s_art_rx = NULL;
+  if (s_art_stall_timer) { app_timer_cancel(s_art_stall_timer); s_art_stall_timer = NULL; }
+  s_art_stats.transfer_ms_total += elapsed;
+  APP_LOG(APP_LOG_LEVEL_DEBUG, "Cover received: %d bytes in %d ms", ART_BYTES, (int)elapsed);
+  log_art_stats();
+  if (slot->hash == s_art_current) { art_show(slot); }
+}
+
+// Latency diagnostics, a hidden screen behind a long press on select in the zone picker: p50/p95/max of the round
+// trip per command type over its last TRACE_SAMPLES, and where the time went on average.
+static Window *s_diag_window;
+static TextLayer *s_diag_text_layer;
+static char s_diag_text[320];
+
+static uint16_t clamp_u16(uint32_t value) { return value > UINT16_MAX ? UINT16_MAX : value; }
+
+// Percentiles of the round trip by insertion sort of the window; at most TRACE_SAMPLES entries
+static void trace_percentiles(const TraceHistogram *hist, uint16_t *p50, uint16_t *p95, uint16_t *max) {
+  uint16_t sorted[TRACE_SAMPLES];
+  for (int i = 0; i < hist->count; i++) {
+    uint16_t total = hist->samples[i].total; int j = i;
+    for (; j > 0 && sorted[j - 1] > total; j--) { sorted[j] = sorted[j - 1]; }
+    sorted[j] = total;
+  }
+  *p50 = sorted[(hist->count - 1) / 2]; *p95 = sorted[(hist->count * 95 - 1) / 100]; *max = sorted[hist->count - 1];
+}
+
+static void trace_means(const TraceHistogram *hist, TraceSample *mean) {
+  uint32_t link = 0, queue = 0, speaker = 0, refresh = 0;
+  for (int i = 0; i < hist->count; i++) { link += hist->samples[i].link; queue += hist->samples[i].queue; speaker += hist->samples[i].speaker; refresh += hist->samples[i].refresh; }
+  *mean = (TraceSample) { .link = link / hist->count, .queue = queue / hist->count, .speaker = speaker / hist->count, .refresh = refresh / hist->count };
+}
+
+static void log_trace_stats(int kind) {
+  const TraceHistogram *hist = &s_trace_hist[kind];
+  uint16_t p50, p95, max; TraceSample mean;
+  trace_percentiles(hist, &p50, &p95, &max); trace_means(hist, &mean);
+  APP_LOG(APP_LOG_LEVEL_DEBUG, "latency %s: p50 %d, p95 %d, max %d ms over %d; link %d, phone %d, speaker %d, refresh %d ms avg", s_trace_kind_names[kind], p50, p95, max, hist->count, mean.link, mean.queue, mean.speaker, mean.refresh);
+}
+
+static void diag_refresh() {
+  if (!s_diag_text_layer) { return; }
+  int length = snprintf(s_diag_text, sizeof(s_diag_text), "p50/p95/max ms, avg split");
+  for (int kind = 0; kind < TRACE_KINDS && length < (int)sizeof(s_diag_text); kind++) {
+    const TraceHistogram *hist = &s_trace_hist[kind];
+    if (hist->count == 0) { length += snprintf(s_diag_text + length, sizeof(s_diag_text) - length, "\n%s: none yet\n", s_trace_kind_names[kind]); continue; }
+    uint16_t p50, p95, max; TraceSample mean;
+    trace_percentiles(hist, &p50, &p95, &max); trace_means(hist, &mean);
+    length += snprintf(s_diag_text + length, sizeof(s_diag_text) - length, "\n%s (%d): %d/%d/%d\nbt %d js %d spk %d st %d", s_trace_kind_names[kind], hist->count, p50, p95, max, mean.link, mean.queue, mean.speaker, mean.refresh);
+  }
+  set_text(s_diag_text_layer, s_diag_text);
+}
+
+// The phone's echo of a traced command; commands it never answers simply leave their slot to be reused
+static void trace_received(DictionaryIterator *iterator) {
+  Tuple *seq_tuple = dict_find(iterator, KEY_TRACE_SEQ), *sent_tuple = dict_find(iterator, KEY_TRACE_SENT_MS), *timings_tuple = dict_find(iterator, KEY_TRACE_TIMINGS);
+  uint16_t seq = seq_tuple->value->uint32;
+  TracePending *pending = &s_trace_pending[seq % TRACE_PENDING];
+  if (!sent_tuple || seq == 0 || pending->seq != seq) { return; }
+  pending->seq = 0;
+  uint32_t total = (trace_clock() - sent_tuple->value->uint32) & TRACE_CLOCK_MASK;
+  uint16_t phone[TRACE_PHONE_FIELDS] = { 0 };
+  if (timings_tuple && timings_tuple->type == TUPLE_BYTE_ARRAY && timings_tuple->length >= TRACE_PHONE_FIELDS * 2) {
+    const uint8_t *data = timings_tuple->value->data;
+    for (int i = 0; i < TRACE_PHONE_FIELDS; i++) { phone[i] = data[2 * i] | (data[2 * i + 1] << 8); }
+  }
+  uint32_t phone_total = phone[0] + phone[1] + phone[2] + phone[3];
+  TraceHistogram *hist = &s_trace_hist[pending->kind];
+  hist->samples[hist->next] = (TraceSample) { .total = clamp_u16(total), .link = clamp_u16(total > phone_total ? total - phone_total : 0), .queue = phone[0], .speaker = clamp_u16(phone[1] + phone[2]), .refresh = phone[3] };
+  hist->next = (hist->next + 1) % TRACE_SAMPLES;
+  if (hist->count < TRACE_SAMPLES) { hist->count++; }
+  if (++hist->received % TRACE_SAMPLES == 0) { log_trace_stats(pending->kind); }
+  diag_refresh();
+}
+
+static void diag_window_load(Window *window) {
+  Layer *window_layer = window_get_root_layer(window);
+  s_diag_text_layer = text_layer_create(layer_get_bounds(window_layer)); text_layer_set_font(s_diag_text_layer, fonts_get_system_font(FONT_KEY_GOTHIC_14)); text_layer_set_overflow_mode(s_diag_text_layer, GTextOverflowModeWordWrap);
+  layer_add_child(window_layer, text_layer_get_layer(s_diag_text_layer));
+  diag_refresh();
+}
+static void diag_window_unload(Window *window) { forget_shown_text(s_diag_text_layer); text_layer_destroy(s_diag_text_layer); s_diag_text_layer = NULL; }
+
+static void diag_open() {
+  if (!s_diag_window) { s_diag_window = window_create(); window_set_window_handlers(s_diag_window, (WindowHandlers) { .load = diag_window_load, .unload = diag_window_unload }); }
+  window_stack_push(s_diag_window, true);
+}
+
+// Queue and favorites browser. Containers can hold thousands of items, so only a ring of BROWSE_RING_ROWS row
+// strings lives on the watch. Rows are asked for a screenful at a time (KEY_CMD_BROWSE with the source, the first
+// index, the window size and the scrolling direction, which the phone uses to read one window further ahead), the
+// one under the selection first and then the next one in the direction of scrolling; the phone answers one row per
+// message (KEY_BROWSE_INDEX of the container's KEY_BROWSE_COUNT, title and detail).
+// Only one window is asked for at a time, and the choice is made when the request goes out, so fast scrolling never
+// queues up windows that are already behind us. Selecting a row plays it (KEY_CMD_BROWSE_PLAY with its index).
+#define BROWSE_SOURCES 2
+#define BROWSE_ROW_HEIGHT 44
+#define BROWSE_RING_ROWS 16
+#define BROWSE_RETRY_MS 2000
+#define BROWSE_NOT_LOADED (-1)
+
+typedef struct { int32_t index; char title[32]; char detail[24]; } BrowseRow;
+typedef struct { uint32_t requests, rows, placeholders, retries, first_row_ms; } BrowseStats;
+
+static Window *s_browse_window;
+static MenuLayer *s_browse_menu;
+static BrowseRow *s_browse_rows;
+static BrowseStats s_browse_stats;
+static uint8_t s_browse_source = 0;
+static int32_t s_browse_total = -1, s_browse_pending = -1, s_browse_play_index = 0;
+static int s_browse_window_rows = 1, s_browse_direction = 0;
+static uint32_t s_browse_opened_ms = 0;
+static char s_browse_note[32];
+static AppTimer *s_browse_retry_timer = NULL;
+static const char *const s_browse_source_names[BROWSE_SOURCES] = { "Queue", "Favorites" };
+
+static BrowseRow *browse_row(int32_t index) { BrowseRow *row = &s_browse_rows[index % BROWSE_RING_ROWS]; return row->index == index ? row : NULL; }
+static void browse_clear() { for (int i = 0; i < BROWSE_RING_ROWS; i++) { s_browse_rows[i].index = BROWSE_NOT_LOADED; } }
+static int32_t browse_selected_row() { return s_browse_menu ? menu_layer_get_selected_index(s_browse_menu).row : 0; }
+
+static bool browse_window_loaded(int32_t start) {
+  if (s_browse_total < 0) { return false; }
+  for (int32_t i = start; i < start + s_browse_window_rows && i < s_browse_total; i++) { if (!browse_row(i)) { return false; } }
+  return true;
+}
+
+// The window under the selection, then the one ahead of it; -1 once both are held
+static int32_t browse_wanted_window() {
+  int32_t row = browse_selected_row(), start = row - row % s_browse_window_rows;
+  if (!browse_window_loaded(start)) { return start; }
+  int32_t ahead = start + s_browse_direction * s_browse_window_rows;
+  if (s_browse_direction && ahead >= 0 && ahead < s_browse_total && !browse_window_loaded(ahead)) { return ahead; }
+  return -1;
+}
+
+static void browse_retry_timer_callback(void *data);
+static void browse_fetch() {
+  if (!s_browse_rows || s_browse_pending >= 0 || s_browse_total == 0 || browse_wanted_window() < 0) { return; }
+  send_cmd(KEY_CMD_BROWSE);
+}
+static void browse_retry_timer_callback(void *data) { s_browse_retry_timer = NULL; s_browse_pending = -1; s_browse_stats.retries++; browse_fetch(); }
+static void browse_cancel_retry() { if (s_browse_retry_timer) { app_timer_cancel(s_browse_retry_timer); s_browse_retry_timer = NULL; } }
+
+static void browse_write_request(DictionaryIterator *iter) {
+  int32_t start = browse_wanted_window();
+  if (start < 0) { int32_t row = browse_selected_row(); start = row - row % s_browse_window_rows; }
+  s_browse_pending = start; s_browse_stats.requests++;
+  if (s_browse_retry_timer) { app_timer_reschedule(s_browse_retry_timer, BROWSE_RETRY_MS); } else { s_browse_retry_timer = app_timer_register(BROWSE_RETRY_MS, browse_retry_timer_callback, NULL); }
+  dict_write_uint8(iter, KEY_CMD_BROWSE, s_browse_source); dict_write_uint32(iter, KEY_BROWSE_INDEX, start); dict_write_uint8(iter, KEY_BROWSE_COUNT, s_browse_window_rows); dict_write_int32(iter, KEY_BROWSE_DIRECTION, s_browse_direction);
+}
+static void browse_write_play(DictionaryIterator *iter) { dict_write_uint8(iter, KEY_CMD_BROWSE_PLAY, s_browse_source); dict_write_uint32(iter, KEY_BROWSE_INDEX, s_browse_play_index); }
+
+static void log_browse_stats() {
+  APP_LOG(APP_LOG_LEVEL_DEBUG, "browse %s: %d items, %d requests, %d rows, %d placeholders drawn, %d retries, first row %d ms", s_browse_source_names[s_browse_source], (int)s_browse_total, (int)s_browse_stats.requests, (int)s_browse_stats.rows, (int)s_browse_stats.placeholders, (int)s_browse_stats.retries, (int)s_browse_stats.first_row_ms);
+}
+
+// A count of 0 means the container is empty or could not be read, with the reason as the title
+static void browse_received(DictionaryIterator *iterator) {
+  Tuple *source_tuple = dict_find(iterator, KEY_BROWSE_SOURCE), *index_tuple = dict_find(iterator, KEY_BROWSE_INDEX), *count_tuple = dict_find(iterator, KEY_BROWSE_COUNT), *title_tuple = dict_find(iterator, KEY_BROWSE_TITLE), *detail_tuple = dict_find(iterator, KEY_BROWSE_DETAIL);
+  if (!s_browse_rows || !count_tuple || (source_tuple && source_tuple->value->int32 != s_browse_source)) { return; }
+  int32_t index = index_tuple->value->int32, total = count_tuple->value->int32;
+  if (total <= 0) {
+    s_browse_total = 0; s_browse_pending = -1; browse_cancel_retry();
+    snprintf(s_browse_note, sizeof(s_browse_note), "%s", title_tuple ? title_tuple->value->cstring : "Empty");
+    if (s_browse_menu) { menu_layer_reload_data(s_browse_menu); }
+    return;
+  }
+  // The container changed under us; whatever the ring holds may have moved
+  if (s_browse_total >= 0 && total != s_browse_total) { browse_clear(); }
+  s_browse_total = total;
+  if (index < 0 || index >= total) { return; }
+  BrowseRow *row = &s_browse_rows[index % BROWSE_RING_ROWS];
+  row->index = index;
+  snprintf(row->title, sizeof(row->title), "%s", title_tuple ? title_tuple->value->cstring : "");
+  snprintf(row->detail, sizeof(row->detail), "%s", detail_tuple ? detail_tuple->value->cstring : "");
+  if (s_browse_stats.rows++ == 0) { s_browse_stats.first_row_ms = now_ms() - s_browse_opened_ms; APP_LOG(APP_LOG_LEVEL_DEBUG, "browse: first row %d ms after opening", (int)s_browse_stats.first_row_ms); }
+  int32_t selected = browse_selected_row();
+  if (s_browse_menu && index >= selected - s_browse_window_rows && index <= selected + s_browse_window_rows) { menu_layer_reload_data(s_browse_menu); }
+  if (s_browse_pending >= 0 && (index == s_browse_pending + s_browse_window_rows - 1 || index == total - 1)) { s_browse_pending = -1; browse_cancel_retry(); browse_fetch(); }
+}
+
+static uint16_t browse_menu_get_num_rows(MenuLayer *menu_layer, uint16_t section_index, void *context) { return s_browse_total > 0 ? MIN(s_browse_total, UINT16_MAX) : 1; }
+static void browse_menu_draw_row(GContext *ctx, const Layer *cell_layer, MenuIndex *cell_index, void *context) {
+  if (s_browse_total == 0) { menu_cell_basic_draw(ctx, cell_layer, s_browse_note, NULL, NULL); return; }
+  BrowseRow *row = s_browse_total > 0 ? browse_row(cell_index->row) : NULL;
+  if (!row) { s_browse_stats.placeholders++; menu_cell_basic_draw(ctx, cell_layer, "Loading...", NULL, NULL); return; }
+  char title[40];
+  if (s_browse_source == 0) { snprintf(title, sizeof(title), "%d. %s", (int)row->index + 1, row->title); } else { snprintf(title, sizeof(title), "%s", row->title); }
+  menu_cell_basic_draw(ctx, cell_layer, title, row->detail, NULL);
+}
+static void browse_menu_selection_changed(MenuLayer *menu_layer, MenuIndex new_index, MenuIndex old_index, void *context) { s_browse_direction = new_index.row > old_index.row ? 1 : -1; browse_fetch(); }
+static void browse_menu_select(MenuLayer *menu_layer, MenuIndex *cell_index, void *context) {
+  if (!browse_row(cell_index->row)) { return; }
+  s_browse_play_index = cell_index->row;
+  send_cmd(KEY_CMD_BROWSE_PLAY);
+  window_stack_pop(true);
+}
+
+static void browse_window_load(Window *window) {
+  Layer *window_layer = window_get_root_layer(window);
+  GRect bounds = layer_get_bounds(window_layer);
+  s_browse_rows = malloc(BROWSE_RING_ROWS * sizeof(BrowseRow));
+  if (!s_browse_rows) { APP_LOG(APP_LOG_LEVEL_ERROR, "Failed to allocate browse rows"); return; }
+  browse_clear();
+  s_browse_window_rows = MIN(bounds.size.h / BROWSE_ROW_HEIGHT + 1, BROWSE_RING_ROWS / 2);
+  s_browse_menu = menu_layer_create(bounds);
+  menu_layer_set_callbacks(s_browse_menu, NULL, (MenuLayerCallbacks) { .get_num_rows = browse_menu_get_num_rows, .draw_row = browse_menu_draw_row, .select_click = browse_menu_select, .selection_changed = browse_menu_selection_changed });
+  menu_layer_set_click_config_onto_window(s_browse_menu, window);
+  layer_add_child(window_layer, menu_layer_get_layer(s_browse_menu));
+  browse_fetch();
+}
+static void browse_window_unload(Window *window) {
+  log_browse_stats(); browse_cancel_retry();
+  if (s_browse_menu) { menu_layer_destroy(s_browse_menu); s_browse_menu = NULL; }
+  free(s_browse_rows); s_browse_rows = NULL;
+}
+
+// Every opening starts from the top with a fresh ring, so a long queue costs a single window to show
+static void browse_open(uint8_t source) {
+  if (!s_browse_window) { s_browse_window = window_create(); window_set_window_handlers(s_browse_window, (WindowHandlers) { .load = browse_window_load, .unload = browse_window_unload }); }
+  s_browse_source = source; s_browse_total = -1; s_browse_pending = -1; s_browse_direction = 0; s_browse_opened_ms = now_ms();
+  memset(&s_browse_stats, 0, sizeof(s_browse_stats));
+  window_stack_push(s_browse_window, true);
+}
+
+// Zone picker: the phone lists the household's groups one message each (KEY_ZONE_INDEX of KEY_ZONE_COUNT, name,
+// state with ZONE_SELECTED_FLAG on the group being controlled, and title), polled in parallel on its side.
+#define ZONE_MAX 8
+#define ZONE_SELECTED_FLAG 0x10
+
+typedef struct { char name[24]; char detail[40]; bool selected; } ZoneEntry;
+
+static Window *s_zone_window;
+static MenuLayer *s_zone_menu;
+static ZoneEntry s_zones[ZONE_MAX];
+static uint8_t s_zone_count = 0;
+static uint32_t s_zone_requested_ms = 0;
+
+static const char *play_state_name(enum PlayStates state) {
+  switch (state) {
+    case STATE_PLAYING: return "Playing";
+    case STATE_PAUSED: return "Paused";
+    case STATE_STOPPED: return "Stopped";
+    case STATE_TRANSITIONING: return "Loading";
+    case STATE_ERROR: return "Unreachable";
+    default: return "Unknown";
+  }
+}
+
+static void zone_received(DictionaryIterator *iterator) {
+  Tuple *index_tuple = dict_find(iterator, KEY_ZONE_INDEX), *count_tuple = dict_find(iterator, KEY_ZONE_COUNT), *name_tuple = dict_find(iterator, KEY_ZONE_NAME), *state_tuple = dict_find(iterator, KEY_ZONE_STATE), *title_tuple = dict_find(iterator, KEY_ZONE_TITLE);
+  int index = index_tuple->value->int32;
+  if (index < 0 || index >= ZONE_MAX) { return; }
+  int state = state_tuple ? state_tuple->value->int32 : STATE_UNKNOWN;
+  ZoneEntry *zone = &s_zones[index];
+  snprintf(zone->name, sizeof(zone->name), "%s", name_tuple ? name_tuple->value->cstring : "");
+  const char *title = title_tuple ? title_tuple->value->cstring : "";
+  snprintf(zone->detail, sizeof(zone->detail), title[0] ? "%s - %s" : "%s", play_state_name((enum PlayStates)(state & 0x0F)), title);
+  zone->selected = (state & ZONE_SELECTED_FLAG) != 0;
+  s_zone_count = count_tuple ? MIN((int)count_tuple->value->int32, ZONE_MAX) : index + 1;
+  if (index == s_zone_count - 1) { APP_LOG(APP_LOG_LEVEL_DEBUG, "Zone list: %d zones in %d ms", s_zone_count, (int)(now_ms() - s_zone_requested_ms)); }
+  if (!s_zone_menu) { return; }
+  menu_layer_reload_data(s_zone_menu);
+  if (zone->selected) { menu_layer_set_selected_index(s_zone_menu, (MenuIndex) { .section = 0, .row = index }, MenuRowAlignCenter, false); }
+}
+
+// The queue and favorites browsers are listed under the zones
+static uint16_t zone_menu_zone_rows() { return s_zone_count ? s_zone_count : 1; }
+static uint16_t zone_menu_get_num_rows(MenuLayer *menu_layer, uint16_t section_index, void *context) { return zone_menu_zone_rows() + BROWSE_SOURCES; }
+static void zone_menu_draw_row(GContext *ctx, const Layer *cell_layer, MenuIndex *cell_index, void *context) {
+  if (cell_index->row >= zone_menu_zone_rows()) { menu_cell_basic_draw(ctx, cell_layer, s_browse_source_names[cell_index->row - zone_menu_zone_rows()], NULL, NULL); return; }
+  if (s_zone_count == 0) { menu_cell_basic_draw(ctx, cell_layer, "Finding zones...", NULL, NULL); return; }
+  ZoneEntry *zone = &s_zones[cell_index->row];
+  char name[28];
+  snprintf(name, sizeof(name), zone->selected ? "> %s" : "%s", zone->name);
+  menu_cell_basic_draw(ctx, cell_layer, name, zone->detail, NULL);
+}
+static void zone_menu_select(MenuLayer *menu_layer, MenuIndex *cell_index, void *context) {
+  if (cell_index->row >= zone_menu_zone_rows()) { window_stack_pop(false); browse_open(cell_index->row - zone_menu_zone_rows()); return; }
+  if (s_zone_count == 0) { return; }
+  send_cmd_value(KEY_CMD_SELECT_ZONE, cell_index->row);
+  window_stack_pop(true);
+}
+static void zone_menu_select_long(MenuLayer *menu_layer, MenuIndex *cell_index, void *context) { diag_open(); }
+
+static void zone_window_load(Window *window) {
+  Layer *window_layer = window_get_root_layer(window);
+  s_zone_menu = menu_layer_create(layer_get_bounds(window_layer));
+  menu_layer_set_callbacks(s_zone_menu, NULL, (MenuLayerCallbacks) { .get_num_rows = zone_menu_get_num_rows, .draw_row = zone_menu_draw_row, .select_click = zone_menu_select, .select_long_click = zone_menu_select_long });
+  menu_layer_set_click_config_onto_window(s_zone_menu, window);
+  layer_add_child(window_layer, menu_layer_get_layer(s_zone_menu));
+}
+static void zone_window_unload(Window *window) { menu_layer_destroy(s_zone_menu); s_zone_menu = NULL; }
+
+// The list is fetched afresh each time, since grouping and what is playing change behind our back
+static void zone_picker_open() {
+  if (!s_zone_window) { s_zone_window = window_create(); window_set_window_handlers(s_zone_window, (WindowHandlers) { .load = zone_window_load, .unload = zone_window_unload }); }
+  s_zone_count = 0; s_zone_requested_ms = now_ms();
+  window_stack_push(s_zone_window, true);
+  send_cmd(KEY_CMD_ZONE_LIST);
+}
+
+static void request_status_resync() { s_status_seq = 0; send_cmd(KEY_CMD_RESYNC); }
+
 static void inbox_received_callback(DictionaryIterator *iterator, void *context) {
   if (!iterator) { return; }
-  bool state_changed = false;
+
+  // Cover art messages carry nothing else
+  Tuple *art_hash_tuple = dict_find(iterator, KEY_ART_HASH);
+  if (art_hash_tuple) {
+    Tuple *data_tuple = dict_find(iterator, KEY_ART_DATA), *offset_tuple = dict_find(iterator, KEY_ART_OFFSET), *length_tuple = dict_find(iterator, KEY_ART_LENGTH);
+    if (data_tuple) { art_chunk(art_hash_tuple->value->int32, offset_tuple ? offset_tuple->value->uint32 : 0, data_tuple->value->data, data_tuple->length); }
+    else { art_offer(art_hash_tuple->value->int32, length_tuple ? length_tuple->value->uint32 : 0); }
+    return;
+  }
+  if (dict_find(iterator, KEY_ZONE_INDEX)) { zone_received(iterator); return; }
+  if (dict_find(iterator, KEY_BROWSE_INDEX)) { browse_received(iterator); return; }
+  // Timed on arrival, before a stale base can send us off to resync
+  if (dict_find(iterator, KEY_TRACE_SEQ)) { trace_received(iterator); }
+
+  uint16_t dirty = 0;
   char received_error_msg[64] = "";
   bool error_received_this_time = false;
+  // Where the local clock had the track, to measure drift against a fresh position
+  uint32_t track_hash = s_meta_hash;
+  bool was_playing = s_current_play_state == STATE_PLAYING;
+  int32_t predicted_position_ms = current_track_position_ms();
+
+  // Status deltas only apply on top of the snapshot they were built against; base 0 starts a new session
+  Tuple *seq_tuple = dict_find(iterator, KEY_STATUS_SEQ);
+  if (seq_tuple) {
+    Tuple *base_tuple = dict_find(iterator, KEY_STATUS_BASE_SEQ);
+    int32_t base = base_tuple ? base_tuple->value->int32 : -1;
+    if (base != 0 && base != s_status_seq) {
+      APP_LOG(APP_LOG_LEVEL_WARNING, "Status base %d does not match seq %d, resyncing", (int)base, (int)s_status_seq);
+      request_status_resync();
+      return;
+    }
+    Tuple *packed_tuple = dict_find(iterator, KEY_STATUS_PACKED);
+    if (packed_tuple && (packed_tuple->value->uint32 >> 24) != STATUS_PROTOCOL_VERSION) {
+      APP_LOG(APP_LOG_LEVEL_ERROR, "Unsupported status protocol version %d", (int)(packed_tuple->value->uint32 >> 24));
+      return;
+    }
+    s_status_seq = seq_tuple->value->int32;
+    if (!s_first_status_seen) { s_first_status_seen = true; APP_LOG(APP_LOG_LEVEL_INFO, "First status %d ms after launch", (int)(now_ms() - s_launch_ms)); }
+  }
 
   Tuple *t = dict_read_first(iterator);
   while (t != NULL) {
     switch (t->key) {
-      case KEY_JS_READY:
-        request_status_update();
+      case KEY_STATUS_SEQ:
+      case KEY_STATUS_BASE_SEQ:
+      case KEY_TRACE_SEQ:
+      case KEY_TRACE_SENT_MS:
+      case KEY_TRACE_TIMINGS:
         break;
-      case KEY_STATUS_PLAY_STATE:
-        if (s_current_play_state != (enum PlayStates)t->value->int32) {
-          s_current_play_state = (enum PlayStates)t->value->int32;
-          state_changed = true;
-        }
+      case KEY_STATUS_PACKED: {
+        uint32_t packed = t->value->uint32;
+        enum PlayStates play_state = (enum PlayStates)(packed & 0x0F);
+        int volume = (packed >> 4) & 0x7F;
+        bool mute = (packed >> 11) & 1;
+        if (volume == STATUS_VOLUME_UNKNOWN) { volume = -1; }
+        if (s_current_play_state != play_state) { rebase_track_position(); s_current_play_state = play_state; dirty |= UI_DIRTY_ACTION_BAR | UI_DIRTY_TRACK | UI_DIRTY_STATUS | UI_DIRTY_PROGRESS; }
+        if (s_current_volume != volume) { s_current_volume = volume; dirty |= UI_DIRTY_PROGRESS; }
+        if (s_current_mute_state != mute) { s_current_mute_state = mute; }
         break;
-      case KEY_STATUS_VOLUME:
-        if (s_current_volume != t->value->int32) {
-          s_current_volume = t->value->int32;
-          state_changed = true;
+      }
+      case KEY_STATUS_META_HASH:
+        if (s_meta_hash != t->value->uint32) {
+          track_progress_finished();
+          // A target picked on the old track means nothing on the new one
+          if (s_scrub_target_ms >= 0) { s_scrub_target_ms = -1; snprintf(s_scrub_text_buffer, sizeof(s_scrub_text_buffer), "Scrub"); dirty |= UI_DIRTY_VOLUME | UI_DIRTY_PROGRESS; }
         }
+        s_meta_hash = t->value->uint32;
         break;
-      case KEY_STATUS_MUTE_STATE:
-        if (s_current_mute_state != (bool)t->value->int32) {
-          s_current_mute_state = (bool)t->value->int32;
-          state_changed = true;
-        }
+      case KEY_STATUS_POSITION:
+        s_track_position_ms = t->value->int32 * 1000;
+        s_position_received_at = now_ms();
+        dirty |= UI_DIRTY_PROGRESS;
+        break;
+      case KEY_STATUS_DURATION:
+        s_track_duration = t->value->int32;
+        dirty |= UI_DIRTY_PROGRESS;
         break;
       case KEY_CONFIG_IP_ADDRESS:
         // Just acknowledge we received the IP, no need to do anything else
         APP_LOG(APP_LOG_LEVEL_INFO, "Received IP address configuration");
         break;
+      case KEY_STATUS_HEALTH: {
+        int health = t->value->int32;
+        if (health <= HEALTH_OK || health >= HEALTH_STATES) { break; }
+        snprintf(received_error_msg, sizeof(received_error_msg), "%s", s_health_text[health]);
+        error_received_this_time = true;
+        if (health == HEALTH_UNREACHABLE) { status_unreachable(); }
+        if (s_current_play_state != STATE_ERROR) {
+          s_current_play_state = STATE_ERROR;
+          dirty |= UI_DIRTY_ACTION_BAR | UI_DIRTY_TRACK | UI_DIRTY_STATUS;
+        }
+        break;
+      }
       case KEY_STATUS_ERROR_MSG:
         if (t->type == TUPLE_CSTRING) {
           strncpy(received_error_msg, t->value->cstring, sizeof(received_error_msg) - 1);
@@ -134,35 +833,18 @@ static void inbox_received_callback(DictionaryIterator *iterator, void *context)
         }
         if (s_current_play_state != STATE_ERROR) {
           s_current_play_state = STATE_ERROR;
-          state_changed = true;
+          dirty |= UI_DIRTY_ACTION_BAR | UI_DIRTY_TRACK | UI_DIRTY_STATUS;
         }
         break;
+      // Metadata strings only arrive when the phone's hash says they changed
       case KEY_STATUS_TRACK_TITLE:
-        if (t->type == TUPLE_CSTRING) {
-          if (strcmp(s_title_buffer, t->value->cstring) != 0) {
-            strncpy(s_title_buffer, t->value->cstring, sizeof(s_title_buffer) - 1);
-            s_title_buffer[sizeof(s_title_buffer) - 1] = '\0';
-            state_changed = true;
-          }
-        }
+        if (t->type == TUPLE_CSTRING) { if (copy_if_changed(s_title_buffer, sizeof(s_title_buffer), t->value->cstring)) { dirty |= UI_DIRTY_TITLE; } }
         break;
       case KEY_STATUS_ARTIST_NAME:
-        if (t->type == TUPLE_CSTRING) {
-          if (strcmp(s_artist_buffer, t->value->cstring) != 0) {
-            strncpy(s_artist_buffer, t->value->cstring, sizeof(s_artist_buffer) - 1);
-            s_artist_buffer[sizeof(s_artist_buffer) - 1] = '\0';
-            state_changed = true;
-          }
-        }
+        if (t->type == TUPLE_CSTRING) { if (copy_if_changed(s_artist_buffer, sizeof(s_artist_buffer), t->value->cstring)) { dirty |= UI_DIRTY_ARTIST; } }
         break;
       case KEY_STATUS_ALBUM_NAME:
-        if (t->type == TUPLE_CSTRING) {
-          if (strcmp(s_album_buffer, t->value->cstring) != 0) {
-            strncpy(s_album_buffer, t->value->cstring, sizeof(s_album_buffer) - 1);
-            s_album_buffer[sizeof(s_album_buffer) - 1] = '\0';
-            state_changed = true;
-          }
-        }
+        if (t->type == TUPLE_CSTRING) { if (copy_if_changed(s_album_buffer, sizeof(s_album_buffer), t->value->cstring)) { dirty |= UI_DIRTY_ALBUM; } }
         break;
       default:
         APP_LOG(APP_LOG_LEVEL_WARNING, "Unexpected key received: %d", (int)t->key);
@@ -173,14 +855,20 @@ static void inbox_received_callback(DictionaryIterator *iterator, void *context)
 
   if (error_received_this_time) {
     strncpy(s_status_text_buffer, received_error_msg, sizeof(s_status_text_buffer));
-    state_changed = true;
-  } else if (state_changed) {
+    dirty |= UI_DIRTY_STATUS;
+  } else if (dirty & UI_DIRTY_STATUS) {
     s_status_text_buffer[0] = '\0';
   }
 
-  if (state_changed) {
-    schedule_ui_update();
+  if (was_playing && s_current_play_state == STATE_PLAYING && s_meta_hash == track_hash && dict_find(iterator, KEY_STATUS_POSITION)) {
+    track_progress_resynced(predicted_position_ms);
+  }
+
+  if (dirty) {
+    schedule_ui_update(dirty);
   }
+
+  if (seq_tuple || error_received_this_time) { status_received(); }
 }
 
 static char* app_message_result_to_string(AppMessageResult result) {
@@ -194,9 +882,18 @@ static char* app_message_result_to_string(AppMessageResult result) {
   }
 }
 
-static void inbox_dropped_callback(AppMessageResult reason, void *context) { s_current_play_state = STATE_ERROR; snprintf(s_status_text_buffer, sizeof(s_status_text_buffer), "Error: RX Drop %d", (int)reason); schedule_ui_update(); }
-static void outbox_failed_callback(DictionaryIterator *iterator, AppMessageResult reason, void *context) { s_current_play_state = STATE_ERROR; snprintf(s_status_text_buffer, sizeof(s_status_text_buffer), "Error: TX Fail %s", app_message_result_to_string(reason)); schedule_ui_update(); }
-static void outbox_sent_callback(DictionaryIterator *iterator, void *context) { }
+// A dropped status leaves us behind the phone's snapshot, so ask for a fresh one rather than showing an error
+static void inbox_dropped_callback(AppMessageResult reason, void *context) { s_inbox_drops++; APP_LOG(APP_LOG_LEVEL_WARNING, "Inbox dropped (%s), %d drops so far", app_message_result_to_string(reason), (int)s_inbox_drops); request_status_resync(); }
+static void outbox_failed_callback(DictionaryIterator *iterator, AppMessageResult reason, void *context) {
+  s_cmd_in_flight = false;
+  if (s_cmd_queue_len == 0) { return; }
+  if (cmd_queue_give_up(reason)) { cmd_queue_pump(); } else { cmd_queue_schedule_retry(); }
+}
+static void outbox_sent_callback(DictionaryIterator *iterator, void *context) {
+  s_cmd_in_flight = false;
+  if (s_cmd_queue_len > 0) { cmd_queue_pop(); }
+  cmd_queue_pump();
+}
 
 static void update_time_layer(struct tm *tick_time) { if (!s_time_layer) return; static char time_buffer[] = "00:00"; if (clock_is_24h_style() == true) { strftime(time_buffer, sizeof(time_buffer), "%H:%M", tick_time); } else { strftime(time_buffer, sizeof(time_buffer), "%I:%M", tick_time); } text_layer_set_text(s_time_layer, time_buffer); }
 static void update_status_text_layer() {
@@ -205,68 +902,133 @@ static void update_status_text_layer() {
     if (s_current_play_state == STATE_ERROR) { if (strlen(s_status_text_buffer) == 0) { snprintf(s_status_text_buffer, sizeof(s_status_text_buffer), "Error"); } show_status = true; }
     else if (s_current_play_state == STATE_STOPPED) { snprintf(s_status_text_buffer, sizeof(s_status_text_buffer), "Nothing playing"); show_status = true; }
     else if (s_current_play_state == STATE_UNKNOWN) { snprintf(s_status_text_buffer, sizeof(s_status_text_buffer), "Connecting..."); show_status = true; }
-    layer_set_hidden(text_layer_get_layer(s_status_text_layer), !show_status); if (show_status) { text_layer_set_text(s_status_text_layer, s_status_text_buffer); }
+    set_layer_hidden(text_layer_get_layer(s_status_text_layer), !show_status); if (show_status) { set_text(s_status_text_layer, s_status_text_buffer); }
 }
-static void update_track_display() {
+static void update_track_display(uint16_t dirty) {
   bool show_track = (s_current_play_state == STATE_PLAYING || s_current_play_state == STATE_PAUSED);
 
-  if (s_title_layer) {
-    layer_set_hidden(text_layer_get_layer(s_title_layer), !show_track);
-    if (show_track) {
-      text_layer_set_text(s_title_layer, s_title_buffer[0] != '\0' ? s_title_buffer : "Unknown Title");
-    }
-  }
+  // Text set while hidden is not drawn, so fields that change while hidden are refreshed when they reappear
+  if (show_track && layer_get_hidden(text_layer_get_layer(s_title_layer))) { dirty |= UI_DIRTY_TITLE | UI_DIRTY_ARTIST | UI_DIRTY_ALBUM; }
 
-  if (s_artist_layer) {
-    layer_set_hidden(text_layer_get_layer(s_artist_layer), !show_track);
-    if (show_track) {
-      text_layer_set_text(s_artist_layer, s_artist_buffer[0] != '\0' ? s_artist_buffer : "Unknown Artist");
-    }
+  set_layer_hidden(text_layer_get_layer(s_title_layer), !show_track);
+  set_layer_hidden(text_layer_get_layer(s_artist_layer), !show_track);
+  set_layer_hidden(text_layer_get_layer(s_album_layer), !show_track);
+  if (!show_track) { return; }
+
+  if (dirty & UI_DIRTY_TITLE) { set_text(s_title_layer, s_title_buffer[0] != '\0' ? s_title_buffer : "Unknown Title"); }
+  if (dirty & UI_DIRTY_ARTIST) { set_text(s_artist_layer, s_artist_buffer[0] != '\0' ? s_artist_buffer : "Unknown Artist"); }
+  if (dirty & UI_DIRTY_ALBUM) { set_text(s_album_layer, s_album_buffer[0] != '\0' ? s_album_buffer : "Unknown Album"); }
+}
+// The cover sits at the bottom right of the text column and the album name wraps beside it
+static int16_t s_album_width = 0;
+static void update_art_layer(uint16_t dirty) {
+  if (!s_art_layer) { return; }
+  bool visible = s_art_shown && (s_current_play_state == STATE_PLAYING || s_current_play_state == STATE_PAUSED);
+  if (visible && (dirty & UI_DIRTY_ART)) { bitmap_layer_set_bitmap(s_art_layer, s_art_shown->bitmap); s_ui_stats.invalidations++; }
+  set_layer_hidden(bitmap_layer_get_layer(s_art_layer), !visible);
+  Layer *album = text_layer_get_layer(s_album_layer);
+  GRect frame = layer_get_frame(album);
+  int16_t width = visible ? s_album_width - ART_SIZE - 4 : s_album_width;
+  if (frame.size.w != width) { frame.size.w = width; layer_set_frame(album, frame); s_ui_stats.invalidations++; }
+}
+static void update_volume_display() {
+  if (!s_volume_text_layer) { return; }
+  if (s_bottom_area_mode != DISPLAY_TRACK) { set_text(s_volume_text_layer, s_bottom_area_mode == DISPLAY_VOLUME ? "Volume" : s_scrub_text_buffer); }
+  set_layer_hidden(text_layer_get_layer(s_volume_text_layer), s_bottom_area_mode == DISPLAY_TRACK);
+}
+
+#define VOLUME_BAR_HEIGHT 6
+static bool track_progress_shown() { return s_track_duration > 0 && (s_current_play_state == STATE_PLAYING || s_current_play_state == STATE_PAUSED); }
+static int32_t scrub_preview_ms() { return s_scrub_target_ms >= 0 ? s_scrub_target_ms : current_track_position_ms(); }
+// Width of the filled part of the bottom bar, or -1 for the solid bar shown for streams and while nothing plays
+static int progress_fill_width(int bar_width) {
+  if (s_bottom_area_mode != DISPLAY_VOLUME) {
+    if (!track_progress_shown()) { return -1; }
+    int32_t position_ms = scrub_preview_ms(), duration_ms = s_track_duration * 1000;
+    if (position_ms <= 0) { return 0; }
+    if (position_ms >= duration_ms) { return bar_width; }
+    return (int)(((int64_t)position_ms * bar_width) / duration_ms);
   }
+  if (s_current_volume < 0 || s_current_volume > 100) { return 0; }
+  return (s_current_volume * bar_width) / 100;
+}
 
-  if (s_album_layer) {
-    layer_set_hidden(text_layer_get_layer(s_album_layer), !show_track);
-    if (show_track) {
-      text_layer_set_text(s_album_layer, s_album_buffer[0] != '\0' ? s_album_buffer : "Unknown Album");
-    }
+// Between status messages the track position is advanced on the watch. The tick is timed for the moment the bar
+// would grow by a pixel, so a track costs about one redraw per pixel of bar whatever its length, and every fresh
+// position from the phone rebases the clock. Redraws and the drift found at each resync are logged per track.
+#define PROGRESS_TICK_MIN_MS 250
+
+typedef struct { uint32_t redraws, resyncs; int32_t max_drift_ms; } TrackProgressStats;
+static TrackProgressStats s_track_stats;
+static AppTimer *s_progress_timer = NULL;
+
+static void track_progress_finished() {
+  if (s_track_stats.redraws || s_track_stats.resyncs) {
+    APP_LOG(APP_LOG_LEVEL_DEBUG, "progress: %d s track, %d redraws, %d resyncs, max drift %d ms", (int)s_track_duration, (int)s_track_stats.redraws, (int)s_track_stats.resyncs, (int)s_track_stats.max_drift_ms);
   }
+  memset(&s_track_stats, 0, sizeof(s_track_stats));
+}
+static void track_progress_resynced(int32_t predicted_ms) {
+  int32_t drift_ms = s_track_position_ms - predicted_ms;
+  if (drift_ms < 0) { drift_ms = -drift_ms; }
+  s_track_stats.resyncs++;
+  if (drift_ms > s_track_stats.max_drift_ms) { s_track_stats.max_drift_ms = drift_ms; }
+}
+
+static void progress_timer_callback(void *data) { s_progress_timer = NULL; update_progress_layer(); }
+static void cancel_progress_tick() { if (s_progress_timer) { app_timer_cancel(s_progress_timer); s_progress_timer = NULL; } }
+
+static void schedule_progress_tick(int bar_width, int fill_width) {
+  cancel_progress_tick();
+  if (s_polling_suspended || s_bottom_area_mode == DISPLAY_VOLUME || s_scrub_target_ms >= 0 || s_current_play_state != STATE_PLAYING || fill_width < 0 || fill_width >= bar_width) { return; }
+  int64_t duration_ms = s_track_duration * 1000;
+  // Round up so the tick lands on or just past the pixel boundary, never just before it
+  int32_t next_pixel_ms = (int32_t)(((fill_width + 1) * duration_ms + bar_width - 1) / bar_width);
+  int32_t delay = next_pixel_ms - current_track_position_ms();
+  s_progress_timer = app_timer_register(delay < PROGRESS_TICK_MIN_MS ? PROGRESS_TICK_MIN_MS : (uint32_t)delay, progress_timer_callback, NULL);
+}
+
+// Pebble redraws a dirty layer in full, so the saving is in not marking it dirty when no pixel would change
+static void update_progress_layer() {
+  if (!s_progress_layer) return;
+  int bar_width = layer_get_bounds(s_progress_layer).size.w;
+  int fill_width = progress_fill_width(bar_width);
+  schedule_progress_tick(bar_width, fill_width);
+  if (fill_width == s_progress_drawn_width) { return; }
+  layer_mark_dirty(s_progress_layer); s_ui_stats.invalidations++;
 }
-static void update_volume_display() { if (s_volume_text_layer) { layer_set_hidden(text_layer_get_layer(s_volume_text_layer), s_bottom_area_mode != DISPLAY_VOLUME); } }
-static void update_progress_layer() { if (!s_progress_layer) return; layer_mark_dirty(s_progress_layer); }
 static void update_action_bar_icons() { 
   if (!s_action_bar_layer) { return; } 
   if (s_icon_pause && s_icon_play) { 
-    action_bar_layer_set_icon(s_action_bar_layer, BUTTON_ID_SELECT, (s_current_play_state == STATE_PLAYING || s_current_play_state == STATE_TRANSITIONING) ? s_icon_pause : s_icon_play); 
+    set_action_bar_icon(BUTTON_ID_SELECT, (s_current_play_state == STATE_PLAYING || s_current_play_state == STATE_TRANSITIONING) ? s_icon_pause : s_icon_play); 
   } 
   if (s_up_down_button_mode == MODE_VOLUME) { 
-    if (s_icon_vol_up) { 
-      action_bar_layer_set_icon(s_action_bar_layer, BUTTON_ID_UP, s_icon_vol_up); 
-    } 
-    if (s_icon_vol_down) { 
-      action_bar_layer_set_icon(s_action_bar_layer, BUTTON_ID_DOWN, s_icon_vol_down); 
-    } 
+    set_action_bar_icon(BUTTON_ID_UP, s_icon_vol_up); 
+    set_action_bar_icon(BUTTON_ID_DOWN, s_icon_vol_down); 
+  } else if (s_up_down_button_mode == MODE_SCRUB) {
+    // Seek arrows, so up/down read as moving through the track rather than skipping it
+    set_action_bar_icon(BUTTON_ID_UP, s_icon_seek_forward);
+    set_action_bar_icon(BUTTON_ID_DOWN, s_icon_seek_back);
   } else { 
-    if (s_icon_next_track) { 
-      action_bar_layer_set_icon(s_action_bar_layer, BUTTON_ID_UP, s_icon_next_track); 
-    } 
-    if (s_icon_prev_track) { 
-      action_bar_layer_set_icon(s_action_bar_layer, BUTTON_ID_DOWN, s_icon_prev_track); 
-    } 
+    set_action_bar_icon(BUTTON_ID_UP, s_icon_next_track); 
+    set_action_bar_icon(BUTTON_ID_DOWN, s_icon_prev_track); 
   } 
 }
 
 static void select_click_handler(ClickRecognizerRef recognizer, void *context) {
   if (s_current_play_state == STATE_PLAYING || s_current_play_state == STATE_TRANSITIONING) {
     // Update UI immediately for better responsiveness
+    rebase_track_position();
     s_current_play_state = STATE_PAUSED;
-    schedule_ui_update();
+    schedule_ui_update(UI_DIRTY_ACTION_BAR | UI_DIRTY_TRACK | UI_DIRTY_STATUS | UI_DIRTY_PROGRESS);
     
     send_cmd(KEY_CMD_PAUSE);
     vibes_enqueue_custom_pattern((VibePattern){ .durations = (uint32_t []) {50}, .num_segments = 1 });
   } else if (s_current_play_state == STATE_PAUSED || s_current_play_state == STATE_STOPPED) {
     // Update UI immediately for better responsiveness
+    rebase_track_position();
     s_current_play_state = STATE_TRANSITIONING;
-    schedule_ui_update();
+    schedule_ui_update(UI_DIRTY_ACTION_BAR | UI_DIRTY_TRACK | UI_DIRTY_STATUS | UI_DIRTY_PROGRESS);
     
     send_cmd(KEY_CMD_PLAY);
     vibes_enqueue_custom_pattern((VibePattern){ .durations = (uint32_t []) {50}, .num_segments = 1 });
@@ -275,19 +1037,49 @@ static void select_click_handler(ClickRecognizerRef recognizer, void *context) {
 
 #define MODE_REVERT_TIMEOUT_MS (5 * 1000) // 5 seconds
 
+static void scrub_mode_left();
+
 static void mode_revert_timer_callback(void *data) {
   s_mode_revert_timer = NULL;
-  if (s_up_down_button_mode == MODE_TRACK) {
+  if (s_up_down_button_mode != MODE_VOLUME) {
     s_up_down_button_mode = MODE_VOLUME;
+    scrub_mode_left();
     update_action_bar_icons();
     vibes_short_pulse(); // Optional feedback
   }
 }
 
+// A long press toggles the up/down mode when released; holding on past ZONE_PICKER_HOLD_MS opens the zone picker
+#define ZONE_PICKER_HOLD_MS 1000
+static AppTimer *s_zone_hold_timer = NULL;
+
+static void zone_hold_timer_callback(void *data) {
+  s_zone_hold_timer = NULL;
+  vibes_enqueue_custom_pattern((VibePattern){ .durations = (uint32_t []) {50}, .num_segments = 1 });
+  zone_picker_open();
+}
+
 static void select_long_click_handler(ClickRecognizerRef recognizer, void *context) {
-  s_up_down_button_mode = (s_up_down_button_mode == MODE_VOLUME) ? MODE_TRACK : MODE_VOLUME;
+  s_zone_hold_timer = app_timer_register(ZONE_PICKER_HOLD_MS, zone_hold_timer_callback, NULL);
+}
+
+static void select_long_click_release_handler(ClickRecognizerRef recognizer, void *context) {
+  if (!s_zone_hold_timer) { return; }
+  app_timer_cancel(s_zone_hold_timer); s_zone_hold_timer = NULL;
+  // Volume, track, then scrub for a track that has a position to scrub through
+  if (s_up_down_button_mode == MODE_VOLUME) { s_up_down_button_mode = MODE_TRACK; }
+  else if (s_up_down_button_mode == MODE_TRACK && track_progress_shown()) { s_up_down_button_mode = MODE_SCRUB; }
+  else { s_up_down_button_mode = MODE_VOLUME; }
   update_action_bar_icons();
-  vibes_enqueue_custom_pattern((VibePattern){ .durations = (uint32_t []) {50}, .num_segments = 1 });
+  if (s_up_down_button_mode == MODE_SCRUB) {
+    snprintf(s_scrub_text_buffer, sizeof(s_scrub_text_buffer), "Scrub");
+    s_bottom_area_mode = DISPLAY_SCRUB;
+    apply_ui_updates(UI_DIRTY_VOLUME | UI_DIRTY_PROGRESS);
+    vibes_enqueue_custom_pattern((VibePattern){ .durations = (uint32_t []) {50, 100, 50}, .num_segments = 3 });
+  } else {
+    scrub_mode_left();
+    vibes_enqueue_custom_pattern((VibePattern){ .durations = (uint32_t []) {50}, .num_segments = 1 });
+  }
   
   // Cancel any existing timer
   if (s_mode_revert_timer) {
@@ -295,20 +1087,93 @@ static void select_long_click_handler(ClickRecognizerRef recognizer, void *conte
     s_mode_revert_timer = NULL;
   }
   
-  // If we switched to track mode, start a timer to revert back
-  if (s_up_down_button_mode == MODE_TRACK) {
+  // If we switched to track or scrub mode, start a timer to revert back
+  if (s_up_down_button_mode != MODE_VOLUME) {
     s_mode_revert_timer = app_timer_register(MODE_REVERT_TIMEOUT_MS, mode_revert_timer_callback, NULL);
   }
 }
 
+#define VOLUME_STEP 5
+
+// Move the volume bar from our own prediction; the phone keeps a matching shadow and reconciles it
+static void predict_volume_step(int delta) {
+  if (s_current_volume < 0) return;
+  s_current_volume += delta;
+  if (s_current_volume < 0) { s_current_volume = 0; }
+  if (s_current_volume > 100) { s_current_volume = 100; }
+}
+
+// Scrub mode. Each repeating click moves a target position, previewed on the progress bar with its time below it,
+// in steps that grow the longer the button is held. The target is only sent once the clicks stop for
+// SCRUB_COMMIT_MS, so a hold of any length costs one KEY_CMD_SEEK; the phone turns it into a single Seek and
+// lets a newer target supersede one it has not sent yet. The watch moves its own position to the target at once.
+#define SCRUB_STEP_MS (5 * 1000)
+#define SCRUB_STEP_MAX_MS (60 * 1000)
+#define SCRUB_ACCEL_CLICKS 8
+#define SCRUB_COMMIT_MS 600
+
+typedef struct { uint32_t scrubs, clicks, seeks; } ScrubStats;
+static ScrubStats s_scrub_stats;
+static AppTimer *s_scrub_commit_timer = NULL;
+static int32_t s_scrub_seek_ms = 0;
+static uint16_t s_scrub_clicks = 0;
+
+static void seek_write_request(DictionaryIterator *iter) { dict_write_int32(iter, KEY_CMD_SEEK, s_scrub_seek_ms / 1000); }
+
+static void format_track_time(char *buffer, size_t size, int32_t seconds) {
+  if (seconds >= 3600) { snprintf(buffer, size, "%d:%02d:%02d", (int)(seconds / 3600), (int)(seconds / 60 % 60), (int)(seconds % 60)); }
+  else { snprintf(buffer, size, "%d:%02d", (int)(seconds / 60), (int)(seconds % 60)); }
+}
+static void update_scrub_text() {
+  char target[16], duration[16];
+  format_track_time(target, sizeof(target), scrub_preview_ms() / 1000); format_track_time(duration, sizeof(duration), s_track_duration);
+  snprintf(s_scrub_text_buffer, sizeof(s_scrub_text_buffer), "%s / %s", target, duration);
+}
+
+static void scrub_commit_timer_callback(void *data) {
+  s_scrub_commit_timer = NULL;
+  if (s_scrub_target_ms < 0) { return; }
+  s_scrub_seek_ms = s_scrub_target_ms; s_scrub_target_ms = -1; s_scrub_clicks = 0;
+  s_track_position_ms = s_scrub_seek_ms; s_position_received_at = now_ms();
+  s_scrub_stats.seeks++;
+  APP_LOG(APP_LOG_LEVEL_DEBUG, "scrub: seek to %d s, %d seeks for %d clicks in %d scrubs", (int)(s_scrub_seek_ms / 1000), (int)s_scrub_stats.seeks, (int)s_scrub_stats.clicks, (int)s_scrub_stats.scrubs);
+  send_cmd(KEY_CMD_SEEK);
+  schedule_ui_update(UI_DIRTY_PROGRESS);
+}
+
+static void scrub_step(int direction) {
+  if (!track_progress_shown()) { return; }
+  if (s_scrub_target_ms < 0) { s_scrub_target_ms = current_track_position_ms(); s_scrub_stats.scrubs++; }
+  int32_t step = SCRUB_STEP_MS * (1 + s_scrub_clicks / SCRUB_ACCEL_CLICKS), last_ms = (s_track_duration - 1) * 1000;
+  if (step > SCRUB_STEP_MAX_MS) { step = SCRUB_STEP_MAX_MS; }
+  s_scrub_clicks++; s_scrub_stats.clicks++;
+  s_scrub_target_ms += direction * step;
+  if (s_scrub_target_ms > last_ms) { s_scrub_target_ms = last_ms; }
+  if (s_scrub_target_ms < 0) { s_scrub_target_ms = 0; }
+  update_scrub_text();
+  s_bottom_area_mode = DISPLAY_SCRUB;
+  apply_ui_updates(UI_DIRTY_VOLUME | UI_DIRTY_PROGRESS);
+  if (s_scrub_commit_timer) { app_timer_reschedule(s_scrub_commit_timer, SCRUB_COMMIT_MS); } else { s_scrub_commit_timer = app_timer_register(SCRUB_COMMIT_MS, scrub_commit_timer_callback, NULL); }
+  // Stay in scrub mode for as long as the button is held
+  if (s_mode_revert_timer) { app_timer_reschedule(s_mode_revert_timer, MODE_REVERT_TIMEOUT_MS); }
+}
+
+// Leaving scrub mode sends a target still being picked, and gives the bottom bar back to the track
+static void scrub_mode_left() {
+  if (s_scrub_commit_timer) { app_timer_cancel(s_scrub_commit_timer); scrub_commit_timer_callback(NULL); }
+  if (s_bottom_area_mode == DISPLAY_SCRUB) { s_bottom_area_mode = DISPLAY_TRACK; apply_ui_updates(UI_DIRTY_VOLUME | UI_DIRTY_PROGRESS); }
+}
+
 static void up_click_handler(ClickRecognizerRef recognizer, void *context) { 
   if (!s_progress_layer || !s_volume_text_layer) return; 
   if (s_up_down_button_mode == MODE_VOLUME) { 
     send_cmd(KEY_CMD_VOL_UP); 
+    predict_volume_step(VOLUME_STEP); 
     s_bottom_area_mode = DISPLAY_VOLUME; 
-    update_volume_display(); 
-    update_progress_layer(); 
+    apply_ui_updates(UI_DIRTY_VOLUME | UI_DIRTY_PROGRESS); 
     start_volume_display_revert_timer(); 
+  } else if (s_up_down_button_mode == MODE_SCRUB) { 
+    scrub_step(1); 
   } else { 
     send_cmd(KEY_CMD_NEXT_TRACK); 
   } 
@@ -318,46 +1183,127 @@ static void down_click_handler(ClickRecognizerRef recognizer, void *context) {
   if (!s_progress_layer || !s_volume_text_layer) return; 
   if (s_up_down_button_mode == MODE_VOLUME) { 
     send_cmd(KEY_CMD_VOL_DOWN); 
+    predict_volume_step(-VOLUME_STEP); 
     s_bottom_area_mode = DISPLAY_VOLUME; 
-    update_volume_display(); 
-    update_progress_layer(); 
+    apply_ui_updates(UI_DIRTY_VOLUME | UI_DIRTY_PROGRESS); 
     start_volume_display_revert_timer(); 
+  } else if (s_up_down_button_mode == MODE_SCRUB) { 
+    scrub_step(-1); 
   } else { 
     send_cmd(KEY_CMD_PREV_TRACK); 
   } 
 }
-static void click_config_provider(void *context) { window_single_click_subscribe(BUTTON_ID_SELECT, select_click_handler); window_long_click_subscribe(BUTTON_ID_SELECT, 500, select_long_click_handler, NULL); window_single_repeating_click_subscribe(BUTTON_ID_UP, 150, up_click_handler); window_single_repeating_click_subscribe(BUTTON_ID_DOWN, 150, down_click_handler); }
+static void click_config_provider(void *context) { window_single_click_subscribe(BUTTON_ID_SELECT, select_click_handler); window_long_click_subscribe(BUTTON_ID_SELECT, 500, select_long_click_handler, select_long_click_release_handler); window_single_repeating_click_subscribe(BUTTON_ID_UP, 150, up_click_handler); window_single_repeating_click_subscribe(BUTTON_ID_DOWN, 150, down_click_handler); }
+
+// Status polling adapts to what the speaker is doing: rare when stopped or unreachable (with backoff),
+// moderate when paused, and when playing timed to land just after the predicted end of the track.
+#define POLL_PLAYING_MAX_MS (15 * 1000)
+#define POLL_PAUSED_MS (20 * 1000)
+#define POLL_STOPPED_MS (60 * 1000)
+#define POLL_TRANSITIONING_MS (1 * 1000)
+#define POLL_UNKNOWN_MS (5 * 1000)
+#define POLL_ERROR_BASE_MS (5 * 1000)
+#define POLL_ERROR_MAX_MS (60 * 1000)
+#define POLL_TRACK_END_SLACK_MS 1500
+#define POLL_MIN_MS 1000
+
+typedef struct { uint32_t wakeups, by_state[STATE_UNKNOWN + 1], track_end, interval_total_ms; } PollStats;
+static PollStats s_poll_stats;
+static uint32_t s_error_backoff_ms = POLL_ERROR_BASE_MS;
+
+static uint32_t now_ms() { time_t seconds; uint16_t millis; time_ms(&seconds, &millis); return (uint32_t)seconds * 1000 + millis; }
+
+// Position extrapolated from the last report while playing
+static int32_t current_track_position_ms() {
+  int32_t position_ms = s_track_position_ms;
+  if (s_current_play_state == STATE_PLAYING) { position_ms += (int32_t)(now_ms() - s_position_received_at); }
+  return position_ms;
+}
+// Called before the play state changes, so a pause freezes the position where it was and a resume extrapolates from now
+static void rebase_track_position() { s_track_position_ms = current_track_position_ms(); s_position_received_at = now_ms(); }
+
+static uint32_t next_status_interval_ms() {
+  switch (s_current_play_state) {
+    case STATE_PLAYING: {
+      if (s_track_duration <= 0) { return POLL_PLAYING_MAX_MS; }
+      int32_t remaining_ms = s_track_duration * 1000 - current_track_position_ms() + POLL_TRACK_END_SLACK_MS;
+      if (remaining_ms > POLL_PLAYING_MAX_MS) { return POLL_PLAYING_MAX_MS; }
+      s_poll_stats.track_end++;
+      return remaining_ms < POLL_MIN_MS ? POLL_MIN_MS : (uint32_t)remaining_ms;
+    }
+    case STATE_PAUSED: return POLL_PAUSED_MS;
+    case STATE_STOPPED: return POLL_STOPPED_MS;
+    case STATE_TRANSITIONING: return POLL_TRANSITIONING_MS;
+    case STATE_ERROR: return s_error_backoff_ms;
+    default: return POLL_UNKNOWN_MS;
+  }
+}
 
-#define STATUS_UPDATE_INTERVAL_MS (5 * 1000)
-static void status_update_timer_callback(void *data) { request_status_update(); s_status_update_timer = app_timer_register(STATUS_UPDATE_INTERVAL_MS, status_update_timer_callback, NULL); }
-static void start_status_updates() { if (s_status_update_timer) { app_timer_cancel(s_status_update_timer); s_status_update_timer = NULL; } request_status_update(); s_status_update_timer = app_timer_register(STATUS_UPDATE_INTERVAL_MS, status_update_timer_callback, NULL); }
+static void schedule_status_update() {
+  if (s_status_update_timer) { app_timer_cancel(s_status_update_timer); s_status_update_timer = NULL; }
+  if (s_polling_suspended) { return; }
+  uint32_t interval = next_status_interval_ms();
+  s_poll_stats.interval_total_ms += interval;
+  s_status_update_timer = app_timer_register(interval, status_update_timer_callback, NULL);
+}
+
+static void status_update_timer_callback(void *data) {
+  s_status_update_timer = NULL;
+  s_poll_stats.wakeups++;
+  if (s_current_play_state <= STATE_UNKNOWN) { s_poll_stats.by_state[s_current_play_state]++; }
+  if (s_current_play_state == STATE_ERROR) {
+    s_error_backoff_ms = s_error_backoff_ms * 2 > POLL_ERROR_MAX_MS ? POLL_ERROR_MAX_MS : s_error_backoff_ms * 2;
+  }
+  if (s_poll_stats.wakeups % 20 == 0) {
+    APP_LOG(APP_LOG_LEVEL_DEBUG, "polls: %d (playing %d, paused %d, stopped %d, error %d, track end %d), avg interval %d ms", (int)s_poll_stats.wakeups, (int)s_poll_stats.by_state[STATE_PLAYING], (int)s_poll_stats.by_state[STATE_PAUSED], (int)s_poll_stats.by_state[STATE_STOPPED], (int)s_poll_stats.by_state[STATE_ERROR], (int)s_poll_stats.track_end, (int)(s_poll_stats.interval_total_ms / s_poll_stats.wakeups));
+  }
+  request_status_update();
+  schedule_status_update();
+}
+
+// Fresh status: pick the next poll from the new state
+static void status_received() {
+  if (s_current_play_state != STATE_ERROR) { s_error_backoff_ms = POLL_ERROR_BASE_MS; }
+  if (s_status_update_timer) { schedule_status_update(); }
+}
+
+// The phone probes an unreachable speaker itself and pushes a status when it answers, so polls only back that up
+static void status_unreachable() { s_error_backoff_ms = POLL_ERROR_MAX_MS; }
+
+static void start_status_updates() { s_polling_suspended = false; request_status_update(); schedule_status_update(); }
 static void stop_status_updates() { if (s_status_update_timer) { app_timer_cancel(s_status_update_timer); s_status_update_timer = NULL; } }
 
+// Stop polling while another app or notification has focus, and catch up as soon as we get it back
+static void app_focus_changed(bool in_focus) {
+  if (in_focus && s_polling_suspended) { start_status_updates(); schedule_ui_update(UI_DIRTY_PROGRESS); }
+  else if (!in_focus) { s_polling_suspended = true; stop_status_updates(); cancel_progress_tick(); }
+}
+
 #define VOLUME_DISPLAY_TIMEOUT_MS (3 * 1000)
-static void volume_display_revert_timer_callback(void *data) { s_volume_display_revert_timer = NULL; if (s_bottom_area_mode == DISPLAY_VOLUME) { s_bottom_area_mode = DISPLAY_TRACK; update_volume_display(); update_progress_layer(); } }
+static void volume_display_revert_timer_callback(void *data) { s_volume_display_revert_timer = NULL; if (s_bottom_area_mode == DISPLAY_VOLUME) { s_bottom_area_mode = DISPLAY_TRACK; apply_ui_updates(UI_DIRTY_VOLUME | UI_DIRTY_PROGRESS); } }
 static void start_volume_display_revert_timer() { if (s_volume_display_revert_timer) { app_timer_reschedule(s_volume_display_revert_timer, VOLUME_DISPLAY_TIMEOUT_MS); } else { s_volume_display_revert_timer = app_timer_register(VOLUME_DISPLAY_TIMEOUT_MS, volume_display_revert_timer_callback, NULL); } }
 
-#define VOLUME_BAR_HEIGHT 6
 static void progress_layer_update_proc(Layer *layer, GContext *ctx) {
     if (!layer || !ctx || !layer_get_window(layer)) { return; }
     GRect bounds = layer_get_bounds(layer);
     if (bounds.size.w <= 0 || bounds.size.h <= 0) { return; }
-    if (s_bottom_area_mode == DISPLAY_VOLUME) {
+    uint32_t started = now_ms();
+    int fg_width = progress_fill_width(bounds.size.w);
+    if (fg_width >= 0) {
         graphics_context_set_fill_color(ctx, GColorDarkGray);
         graphics_fill_rect(ctx, GRect(0, 0, bounds.size.w, VOLUME_BAR_HEIGHT), 0, GCornerNone);
-        if (s_current_volume >= 0 && s_current_volume <= 100) {
-            int fg_width = (s_current_volume * bounds.size.w) / 100;
-            if (fg_width < 0) { fg_width = 0; }
-            if (fg_width > bounds.size.w) { fg_width = bounds.size.w; }
-            if (fg_width > 0) {
-               graphics_context_set_fill_color(ctx, GColorWhite);
-               graphics_fill_rect(ctx, GRect(0, 0, fg_width, VOLUME_BAR_HEIGHT), 0, GCornerNone);
-            }
+        if (fg_width > 0) {
+           graphics_context_set_fill_color(ctx, GColorWhite);
+           graphics_fill_rect(ctx, GRect(0, 0, fg_width, VOLUME_BAR_HEIGHT), 0, GCornerNone);
         }
+        if (s_bottom_area_mode == DISPLAY_TRACK) { s_track_stats.redraws++; }
     } else {
         graphics_context_set_fill_color(ctx, GColorFromHEX(0xFFAA00));
         graphics_fill_rect(ctx, bounds, 0, GCornerNone);
     }
+    s_progress_drawn_width = fg_width;
+    s_ui_stats.progress_redraws++;
+    s_ui_stats.redraw_ms_total += now_ms() - started;
 }
 
 static void tick_handler(struct tm *tick_time, TimeUnits units_changed) { update_time_layer(tick_time); }
@@ -371,6 +1317,8 @@ static void main_window_load(Window *window) {
   s_icon_vol_down = gbitmap_create_with_resource(RESOURCE_ID_ICON_VOL_DOWN); if (!s_icon_vol_down) APP_LOG(APP_LOG_LEVEL_ERROR, "Failed to load ICON_VOL_DOWN");
   s_icon_prev_track = gbitmap_create_with_resource(RESOURCE_ID_ICON_PREV_TRACK); if (!s_icon_prev_track) APP_LOG(APP_LOG_LEVEL_ERROR, "Failed to load ICON_PREV_TRACK");
   s_icon_next_track = gbitmap_create_with_resource(RESOURCE_ID_ICON_NEXT_TRACK); if (!s_icon_next_track) APP_LOG(APP_LOG_LEVEL_ERROR, "Failed to load ICON_NEXT_TRACK");
+  s_icon_seek_back = gbitmap_create_with_resource(RESOURCE_ID_ICON_SEEK_BACK); if (!s_icon_seek_back) APP_LOG(APP_LOG_LEVEL_ERROR, "Failed to load ICON_SEEK_BACK");
+  s_icon_seek_forward = gbitmap_create_with_resource(RESOURCE_ID_ICON_SEEK_FORWARD); if (!s_icon_seek_forward) APP_LOG(APP_LOG_LEVEL_ERROR, "Failed to load ICON_SEEK_FORWARD");
 
   int current_y = 0;
   GRect time_frame = GRect(0, current_y, bounds.size.w - action_bar_width, 18);
@@ -382,7 +1330,7 @@ static void main_window_load(Window *window) {
   GRect artist_frame = GRect(5, current_y, bounds.size.w - action_bar_width - 10, 22);
   s_artist_layer = text_layer_create(artist_frame); text_layer_set_background_color(s_artist_layer, GColorClear); text_layer_set_text_color(s_artist_layer, GColorBlack); text_layer_set_font(s_artist_layer, fonts_get_system_font(FONT_KEY_GOTHIC_18_BOLD)); text_layer_set_text_alignment(s_artist_layer, GTextAlignmentLeft); text_layer_set_overflow_mode(s_artist_layer, GTextOverflowModeTrailingEllipsis); layer_add_child(window_layer, text_layer_get_layer(s_artist_layer)); current_y = artist_frame.origin.y + artist_frame.size.h;
 
-  GRect album_frame = GRect(5, current_y, bounds.size.w - action_bar_width - 10, 36); 
+  GRect album_frame = GRect(5, current_y, bounds.size.w - action_bar_width - 10, 36); s_album_width = album_frame.size.w;
   s_album_layer = text_layer_create(album_frame); text_layer_set_background_color(s_album_layer, GColorClear); text_layer_set_text_color(s_album_layer, GColorBlack); text_layer_set_font(s_album_layer, fonts_get_system_font(FONT_KEY_GOTHIC_18)); text_layer_set_text_alignment(s_album_layer, GTextAlignmentLeft); text_layer_set_overflow_mode(s_album_layer, GTextOverflowModeWordWrap); layer_add_child(window_layer, text_layer_get_layer(s_album_layer)); current_y = album_frame.origin.y + album_frame.size.h + 5;
 
   GRect status_text_frame = GRect(5, current_y, bounds.size.w - action_bar_width - 10, 40);
@@ -392,6 +1340,9 @@ static void main_window_load(Window *window) {
   GRect progress_frame = GRect(5, progress_area_y, bounds.size.w - action_bar_width - 10, VOLUME_BAR_HEIGHT + 2);
   s_progress_layer = layer_create(progress_frame); layer_set_update_proc(s_progress_layer, progress_layer_update_proc); layer_add_child(window_layer, s_progress_layer);
 
+  GRect art_frame = GRect(bounds.size.w - action_bar_width - 5 - ART_SIZE, progress_area_y - ART_SIZE - 4, ART_SIZE, ART_SIZE);
+  s_art_layer = bitmap_layer_create(art_frame); layer_add_child(window_layer, bitmap_layer_get_layer(s_art_layer)); layer_set_hidden(bitmap_layer_get_layer(s_art_layer), true);
+
   GRect volume_text_frame = GRect(5, progress_area_y - 20, 50, 18);
   s_volume_text_layer = text_layer_create(volume_text_frame); text_layer_set_background_color(s_volume_text_layer, GColorClear); text_layer_set_text_color(s_volume_text_layer, GColorBlack); text_layer_set_font(s_volume_text_layer, fonts_get_system_font(FONT_KEY_GOTHIC_14)); text_layer_set_text_alignment(s_volume_text_layer, GTextAlignmentLeft); text_layer_set_text(s_volume_text_layer, "Volume"); layer_add_child(window_layer, text_layer_get_layer(s_volume_text_layer)); layer_set_hidden(text_layer_get_layer(s_volume_text_layer), true);
 
@@ -399,7 +1350,8 @@ static void main_window_load(Window *window) {
   action_bar_layer_set_background_color(s_action_bar_layer, GColorWhite); action_bar_layer_set_icon_press_animation(s_action_bar_layer, BUTTON_ID_SELECT, ActionBarLayerIconPressAnimationNone); action_bar_layer_set_icon_press_animation(s_action_bar_layer, BUTTON_ID_UP, ActionBarLayerIconPressAnimationNone); action_bar_layer_set_icon_press_animation(s_action_bar_layer, BUTTON_ID_DOWN, ActionBarLayerIconPressAnimationNone); action_bar_layer_add_to_window(s_action_bar_layer, window); window_set_click_config_provider(s_main_window, click_config_provider);
 
   time_t temp = time(NULL); struct tm *tick_time = localtime(&temp); update_time_layer(tick_time); tick_timer_service_subscribe(MINUTE_UNIT, tick_handler);
-  snprintf(s_status_text_buffer, sizeof(s_status_text_buffer), "Connecting..."); update_status_text_layer(); update_action_bar_icons(); update_track_display(); update_progress_layer(); update_volume_display();
+  snprintf(s_status_text_buffer, sizeof(s_status_text_buffer), "Connecting...");
+  memset(s_action_bar_icons, 0, sizeof(s_action_bar_icons)); memset(s_shown_text, 0, sizeof(s_shown_text)); s_progress_drawn_width = PROGRESS_NOT_DRAWN; apply_ui_updates(UI_DIRTY_ALL);
 }
 
 static void main_window_unload(Window *window) { 
@@ -407,6 +1359,7 @@ static void main_window_unload(Window *window) {
   if (s_action_bar_layer) { action_bar_layer_destroy(s_action_bar_layer); s_action_bar_layer = NULL; } 
   if (s_progress_layer) { layer_destroy(s_progress_layer); s_progress_layer = NULL; } 
   if (s_volume_text_layer) { text_layer_destroy(s_volume_text_layer); s_volume_text_layer = NULL; } 
+  if (s_art_layer) { bitmap_layer_destroy(s_art_layer); s_art_layer = NULL; }
   if (s_album_layer) { text_layer_destroy(s_album_layer); s_album_layer = NULL; } 
   if (s_artist_layer) { text_layer_destroy(s_artist_layer); s_artist_layer = NULL; } 
   if (s_title_layer) { text_layer_destroy(s_title_layer); s_title_layer = NULL; } 
@@ -418,24 +1371,55 @@ static void main_window_unload(Window *window) {
   if(s_icon_vol_down) { gbitmap_destroy(s_icon_vol_down); s_icon_vol_down = NULL; } 
   if(s_icon_prev_track) { gbitmap_destroy(s_icon_prev_track); s_icon_prev_track = NULL; } 
   if(s_icon_next_track) { gbitmap_destroy(s_icon_next_track); s_icon_next_track = NULL; } 
+  if(s_icon_seek_back) { gbitmap_destroy(s_icon_seek_back); s_icon_seek_back = NULL; }
+  if(s_icon_seek_forward) { gbitmap_destroy(s_icon_seek_forward); s_icon_seek_forward = NULL; }
   stop_status_updates(); 
   if (s_volume_display_revert_timer) { app_timer_cancel(s_volume_display_revert_timer); s_volume_display_revert_timer = NULL; } 
   if (s_ui_update_timer) { app_timer_cancel(s_ui_update_timer); s_ui_update_timer = NULL; }
   if (s_mode_revert_timer) { app_timer_cancel(s_mode_revert_timer); s_mode_revert_timer = NULL; }
+  if (s_zone_hold_timer) { app_timer_cancel(s_zone_hold_timer); s_zone_hold_timer = NULL; }
+  if (s_scrub_commit_timer) { app_timer_cancel(s_scrub_commit_timer); s_scrub_commit_timer = NULL; }
+  cancel_progress_tick();
+}
+
+// Last known state is persisted on exit and drawn on the first frame of the next launch, until the phone's
+// cached snapshot and then its single startup refresh replace it.
+enum PersistKeys { PERSIST_KEY_PLAY_STATE=1, PERSIST_KEY_VOLUME=2, PERSIST_KEY_TITLE=3, PERSIST_KEY_ARTIST=4, PERSIST_KEY_ALBUM=5 };
+
+static void load_persisted_state() {
+  if (!persist_exists(PERSIST_KEY_PLAY_STATE)) { return; }
+  s_current_play_state = (enum PlayStates)persist_read_int(PERSIST_KEY_PLAY_STATE);
+  s_current_volume = persist_exists(PERSIST_KEY_VOLUME) ? persist_read_int(PERSIST_KEY_VOLUME) : -1;
+  persist_read_string(PERSIST_KEY_TITLE, s_title_buffer, sizeof(s_title_buffer));
+  persist_read_string(PERSIST_KEY_ARTIST, s_artist_buffer, sizeof(s_artist_buffer));
+  persist_read_string(PERSIST_KEY_ALBUM, s_album_buffer, sizeof(s_album_buffer));
 }
 
-static void app_ready_timer_callback(void *data) { uint8_t key_to_send = (uint8_t)(uintptr_t)data; send_cmd(key_to_send); }
+static void save_persisted_state() {
+  // Only settled states are worth showing again; errors and transitions keep the previous snapshot
+  if (s_current_play_state != STATE_PLAYING && s_current_play_state != STATE_PAUSED && s_current_play_state != STATE_STOPPED) { return; }
+  persist_write_int(PERSIST_KEY_PLAY_STATE, s_current_play_state);
+  persist_write_int(PERSIST_KEY_VOLUME, s_current_volume);
+  persist_write_string(PERSIST_KEY_TITLE, s_title_buffer);
+  persist_write_string(PERSIST_KEY_ARTIST, s_artist_buffer);
+  persist_write_string(PERSIST_KEY_ALBUM, s_album_buffer);
+}
 
 static void init() {
+  s_launch_ms = now_ms();
   s_title_buffer[0] = '\0'; s_artist_buffer[0] = '\0'; s_album_buffer[0] = '\0'; s_status_text_buffer[0] = '\0';
+  load_persisted_state();
   s_main_window = window_create(); if (!s_main_window) { APP_LOG(APP_LOG_LEVEL_ERROR, "Failed to create main window!"); return; }
   window_set_window_handlers(s_main_window, (WindowHandlers) { .load = main_window_load, .unload = main_window_unload, });
   app_message_register_inbox_received(inbox_received_callback); app_message_register_inbox_dropped(inbox_dropped_callback); app_message_register_outbox_failed(outbox_failed_callback); app_message_register_outbox_sent(outbox_sent_callback);
-  const uint32_t inbox_size = 256; const uint32_t outbox_size = 64; AppMessageResult result = app_message_open(inbox_size, outbox_size);
+  // The inbox takes a whole cover art chunk (960 bytes plus hash and offset)
+  const uint32_t inbox_size = 1024; const uint32_t outbox_size = 64; AppMessageResult result = app_message_open(inbox_size, outbox_size);
   if (result != APP_MSG_OK) { APP_LOG(APP_LOG_LEVEL_ERROR, "Failed to open AppMessage: %s (%d)", app_message_result_to_string(result), (int)result); s_current_play_state = STATE_ERROR; snprintf(s_status_text_buffer, sizeof(s_status_text_buffer), "Error: AppMsg Init"); }
   window_stack_push(s_main_window, true);
-  app_timer_register(500, app_ready_timer_callback, (void*)((uintptr_t)KEY_CMD_APP_READY));
-  start_status_updates();
+  // The phone pushes its cached snapshot and runs the one startup refresh when its JS is ready, so we only arm the
+  // poll timer
+  schedule_status_update();
+  app_focus_service_subscribe_handlers((AppFocusHandlers) { .did_focus = app_focus_changed });
 }
-static void deinit() { stop_status_updates(); if (s_volume_display_revert_timer) { app_timer_cancel(s_volume_display_revert_timer); s_volume_display_revert_timer = NULL; } if (s_ui_update_timer) { app_timer_cancel(s_ui_update_timer); s_ui_update_timer = NULL; } if (s_main_window) window_destroy(s_main_window); }
+static void deinit() { track_progress_finished(); save_persisted_state(); art_abandon(); for (int i = 0; i < ART_CACHE_SIZE; i++) { if (s_art_cache[i].bitmap) { gbitmap_destroy(s_art_cache[i].bitmap); s_art_cache[i].bitmap = NULL; } } app_focus_service_unsubscribe(); stop_status_updates(); if (s_cmd_retry_timer) { app_timer_cancel(s_cmd_retry_timer); s_cmd_retry_timer = NULL; } if (s_volume_display_revert_timer) { app_timer_cancel(s_volume_display_revert_timer); s_volume_display_revert_timer = NULL; } if (s_ui_update_timer) { app_timer_cancel(s_ui_update_timer); s_ui_update_timer = NULL; } if (s_browse_window) window_destroy(s_browse_window); if (s_diag_window) window_destroy(s_diag_window); if (s_zone_window) window_destroy(s_zone_window); if (s_main_window) window_destroy(s_main_window); }
 int main(void) { init(); app_event_loop(); deinit(); }
\ No newline at end of file
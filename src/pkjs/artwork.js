@@ -0,0 +1,126 @@
+// Turns album art from the speaker into the exact bytes the watch's cover
+// bitmap holds, so the watch only ever copies.
+//
+// The image is centre-cropped to a square, box-filtered down to the cover
+// size and error-diffused (Floyd-Steinberg) into either the 64-colour
+// GBitmapFormat8Bit palette or packed GBitmapFormat1Bit rows. Rows are sent
+// unpadded; the watch applies its own row stride.
+
+var jpeg = require('./jpeg');
+var png = require('./png');
+
+var LEVELS = [0, 85, 170, 255];
+
+// Cover bytes per AppMessage: fits the watch's 1024-byte inbox alongside the
+// hash and offset tuples
+var CHUNK_BYTES = 960;
+
+function decodeImage(bytes, size) {
+  if (bytes[0] === 0xFF && bytes[1] === 0xD8) return jpeg.decode(bytes, size);
+  if (bytes[0] === 0x89 && bytes[1] === 0x50 && bytes[2] === 0x4E && bytes[3] === 0x47) return png.decode(bytes);
+  throw new Error('Unrecognised image format');
+}
+
+// Average the source pixels covered by each destination pixel of a
+// size x size cover taken from the centre square of the image
+function resize(image, size) {
+  var side = Math.min(image.width, image.height);
+  var left = (image.width - side) >> 1;
+  var top = (image.height - side) >> 1;
+  var out = new Float32Array(size * size * 3);
+  var o = 0;
+  for (var y = 0; y < size; y++) {
+    var y0 = top + Math.floor(y * side / size);
+    var y1 = Math.max(y0 + 1, top + Math.floor((y + 1) * side / size));
+    for (var x = 0; x < size; x++) {
+      var x0 = left + Math.floor(x * side / size);
+      var x1 = Math.max(x0 + 1, left + Math.floor((x + 1) * side / size));
+      var r = 0, g = 0, b = 0;
+      for (var sy = y0; sy < y1; sy++) {
+        var i = (sy * image.width + x0) * 3;
+        for (var sx = x0; sx < x1; sx++) {
+          r += image.data[i]; g += image.data[i + 1]; b += image.data[i + 2];
+          i += 3;
+        }
+      }
+      var count = (y1 - y0) * (x1 - x0);
+      out[o++] = r / count; out[o++] = g / count; out[o++] = b / count;
+    }
+  }
+  return out;
+}
+
+// Push the quantisation error of pixel i to its unvisited neighbours
+function diffuse(pixels, size, x, y, channel, channels, error) {
+  var i = (y * size + x) * channels + channel;
+  if (x + 1 < size) pixels[i + channels] += error * 7 / 16;
+  if (y + 1 < size) {
+    var below = i + size * channels;
+    if (x > 0) pixels[below - channels] += error * 3 / 16;
+    pixels[below] += error * 5 / 16;
+    if (x + 1 < size) pixels[below + channels] += error / 16;
+  }
+}
+
+// One byte per pixel, 0b11RRGGBB
+function quantizeColor(pixels, size) {
+  var out = new Uint8Array(size * size);
+  for (var y = 0; y < size; y++) {
+    for (var x = 0; x < size; x++) {
+      var value = 0xC0;
+      for (var c = 0; c < 3; c++) {
+        var v = pixels[(y * size + x) * 3 + c];
+        var level = v <= 0 ? 0 : (v >= 255 ? 3 : Math.round(v / 85));
+        diffuse(pixels, size, x, y, c, 3, v - LEVELS[level]);
+        value |= level << (4 - 2 * c);
+      }
+      out[y * size + x] = value;
+    }
+  }
+  return out;
+}
+
+// Packed rows of (size + 7) / 8 bytes, least significant bit first, 1 = white
+function quantizeMono(pixels, size) {
+  var rowBytes = (size + 7) >> 3;
+  var out = new Uint8Array(rowBytes * size);
+  var luma = new Float32Array(size * size);
+  for (var i = 0; i < size * size; i++) {
+    luma[i] = 0.299 * pixels[i * 3] + 0.587 * pixels[i * 3 + 1] + 0.114 * pixels[i * 3 + 2];
+  }
+  for (var y = 0; y < size; y++) {
+    for (var x = 0; x < size; x++) {
+      var v = luma[y * size + x];
+      var white = v >= 128;
+      diffuse(luma, size, x, y, 0, 1, v - (white ? 255 : 0));
+      if (white) out[y * rowBytes + (x >> 3)] |= 1 << (x & 7);
+    }
+  }
+  return out;
+}
+
+// 32-bit FNV-1a of the cover bytes; 0 is reserved for "no cover"
+function hashBytes(bytes) {
+  var hash = 0x811c9dc5;
+  for (var i = 0; i < bytes.length; i++) {
+    hash ^= bytes[i];
+    hash = Math.imul(hash, 0x01000193);
+  }
+  return (hash | 0) || 1;
+}
+
+// spec is { size: pixels per side, color: true for 8-bit, false for 1-bit }.
+// Returns { data, hash, width, height } with the decoded image's dimensions.
+function renderCover(bytes, spec) {
+  var image = decodeImage(bytes, spec.size);
+  var pixels = resize(image, spec.size);
+  var data = spec.color ? quantizeColor(pixels, spec.size) : quantizeMono(pixels, spec.size);
+  return { data: data, hash: hashBytes(data), width: image.width, height: image.height };
+}
+
+module.exports = {
+  CHUNK_BYTES: CHUNK_BYTES,
+  decodeImage: decodeImage,
+  renderCover: renderCover,
+  hashBytes: hashBytes
+};
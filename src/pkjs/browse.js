@@ -0,0 +1,134 @@
+// Paged ContentDirectory browsing for the watch's queue and favorites browser.
+//
+// A Browser serves windows of rows from one container of one speaker: the
+// queue (Q:0) or Sonos Favorites (FV:2). The watch asks for windows of its
+// own screenful of rows, aligned to that size, and each window is exactly one
+// Browse page, so opening the browser costs a single request however long the
+// container is. Pages are kept in a small LRU for PAGE_TTL_MS, and once the
+// watch is scrolling, the page after the one asked for in the direction of
+// travel is fetched ahead. A new UpdateID (the queue was edited) drops the
+// cached pages.
+
+var soap = require('./soap');
+
+var PAGE_CACHE = 8;
+var PAGE_TTL_MS = 60 * 1000;
+var SOURCES = [
+  { id: 'Q:0', filter: 'dc:title,dc:creator' },
+  { id: 'FV:2', filter: 'dc:title,r:description,res,r:resMD' }
+];
+
+function browseBody(source, start, count) {
+  return '<s:Envelope xmlns:s="http://schemas.xmlsoap.org/soap/envelope/" s:encodingStyle="http://schemas.xmlsoap.org/soap/encoding/">' +
+    '<s:Body>' +
+    '<u:Browse xmlns:u="urn:schemas-upnp-org:service:ContentDirectory:1">' +
+    '<ObjectID>' + source.id + '</ObjectID>' +
+    '<BrowseFlag>BrowseDirectChildren</BrowseFlag>' +
+    '<Filter>' + source.filter + '</Filter>' +
+    '<StartingIndex>' + start + '</StartingIndex>' +
+    '<RequestedCount>' + count + '</RequestedCount>' +
+    '<SortCriteria></SortCriteria>' +
+    '</u:Browse>' +
+    '</s:Body>' +
+    '</s:Envelope>';
+}
+
+// request(url, headers, body, callback(err, text)) performs a SOAP POST, as
+// for zones.Topology. source indexes SOURCES.
+function Browser(request, host, source, pageSize) {
+  this.request = request;
+  this.host = host;
+  this.source = source;
+  this.pageSize = pageSize;
+  this.pages = {};        // { items, at } by page start
+  this.order = [];        // page starts, least recently used first
+  this.loading = {};      // callbacks by page start while its fetch runs
+  this.total = -1;
+  this.updateID = null;
+  this.stats = { windows: 0, hits: 0, fetches: 0, prefetches: 0, failures: 0, fetchMs: 0 };
+}
+
+Browser.prototype.touch = function(start) {
+  var i = this.order.indexOf(start);
+  if (i !== -1) this.order.splice(i, 1);
+  this.order.push(start);
+};
+
+Browser.prototype.cached = function(start) {
+  var cached = this.pages[start];
+  return cached && Date.now() - cached.at < PAGE_TTL_MS;
+};
+
+// callback(err, items) with the page starting at start, fetched once however
+// many callers want it
+Browser.prototype.page = function(start, callback) {
+  var self = this;
+  if (this.cached(start)) {
+    this.stats.hits++;
+    this.touch(start);
+    callback(null, this.pages[start].items);
+    return;
+  }
+  if (this.loading[start]) {
+    this.loading[start].push(callback);
+    return;
+  }
+  this.loading[start] = [callback];
+  var started = Date.now();
+  this.stats.fetches++;
+  var headers = {
+    'SOAPAction': 'urn:schemas-upnp-org:service:ContentDirectory:1#Browse',
+    'Content-Type': 'text/xml; charset="utf-8"'
+  };
+  var body = browseBody(SOURCES[this.source], start, this.pageSize);
+  this.request('http://' + this.host + '/MediaServer/ContentDirectory/Control', headers, body, function(err, response) {
+    var waiters = self.loading[start];
+    delete self.loading[start];
+    var result = err ? null : soap.parseBrowse(response);
+    if (!result) {
+      self.stats.failures++;
+      waiters.forEach(function(waiter) { waiter(err, null); });
+      return;
+    }
+    self.stats.fetchMs += Date.now() - started;
+    if (self.updateID !== null && result.updateID !== self.updateID) {
+      console.log('Browse: container changed (UpdateID ' + self.updateID + ' -> ' + result.updateID + '), dropping cached pages');
+      self.pages = {};
+      self.order = [];
+    }
+    self.updateID = result.updateID;
+    self.total = result.total;
+    self.pages[start] = { items: result.items, at: Date.now() };
+    self.touch(start);
+    while (self.order.length > PAGE_CACHE) delete self.pages[self.order.shift()];
+    waiters.forEach(function(waiter) { waiter(null, result.items); });
+  });
+};
+
+// A window the watch asked for. Its page is fetched (or served from cache),
+// and then the next page in the direction the watch is scrolling (1 down, -1
+// up, 0 when it has only just opened).
+Browser.prototype.window = function(start, direction, callback) {
+  var self = this;
+  this.stats.windows++;
+  this.page(start, function(err, items) {
+    callback(err, items);
+    var ahead = start + direction * self.pageSize;
+    if (err || direction === 0 || ahead < 0 || ahead >= self.total || self.cached(ahead) || self.loading[ahead]) return;
+    self.stats.prefetches++;
+    self.page(ahead, function() {});
+  });
+};
+
+// callback(err, item) for one row, e.g. to play it after its page was evicted
+Browser.prototype.item = function(index, callback) {
+  var start = index - index % this.pageSize;
+  this.page(start, function(err, items) {
+    callback(err, items && items[index - start] ? items[index - start] : null);
+  });
+};
+
+module.exports = {
+  SOURCES: SOURCES,
+  Browser: Browser
+};
@@ -1,12 +1,16 @@
 // Basic Clay configuration handler
 var Clay = require('pebble-clay');
 var clayConfig = require('./config.json');
+var soap = require('./soap');
+var artwork = require('./artwork');
+var zones = require('./zones');
+var browse = require('./browse');
+var requests = require('./requests');
 
 var clay = new Clay(clayConfig, null, { autoHandleEvents: true });
 
 // Message key definitions
 var Keys = {
-  KEY_CMD_APP_READY: 0,
   KEY_CMD_PLAY: 1,
   KEY_CMD_PAUSE: 2,
   KEY_CMD_STOP: 3,
@@ -15,7 +19,6 @@ var Keys = {
   KEY_CMD_PREV_TRACK: 6,
   KEY_CMD_NEXT_TRACK: 7,
   KEY_CMD_GET_STATUS: 8,
-  KEY_JS_READY: 9,
   KEY_STATUS_PLAY_STATE: 10,
   KEY_STATUS_VOLUME: 11,
   KEY_STATUS_MUTE_STATE: 12,
@@ -23,7 +26,39 @@ var Keys = {
   KEY_CONFIG_IP_ADDRESS: 14,
   KEY_STATUS_TRACK_TITLE: 15,
   KEY_STATUS_ARTIST_NAME: 16,
-  KEY_STATUS_ALBUM_NAME: 17
+  KEY_STATUS_ALBUM_NAME: 17,
+  KEY_STATUS_PACKED: 18,
+  KEY_STATUS_META_HASH: 19,
+  KEY_STATUS_SEQ: 20,
+  KEY_STATUS_BASE_SEQ: 21,
+  KEY_CMD_RESYNC: 22,
+  KEY_STATUS_POSITION: 23,
+  KEY_STATUS_DURATION: 24,
+  KEY_ART_HASH: 25,
+  KEY_ART_LENGTH: 26,
+  KEY_ART_OFFSET: 27,
+  KEY_ART_DATA: 28,
+  KEY_CMD_ART_REQUEST: 29,
+  KEY_CMD_ZONE_LIST: 30,
+  KEY_ZONE_INDEX: 31,
+  KEY_ZONE_COUNT: 32,
+  KEY_ZONE_NAME: 33,
+  KEY_ZONE_STATE: 34,
+  KEY_ZONE_TITLE: 35,
+  KEY_CMD_SELECT_ZONE: 36,
+  KEY_TRACE_SEQ: 37,
+  KEY_TRACE_SENT_MS: 38,
+  KEY_TRACE_TIMINGS: 39,
+  KEY_CMD_BROWSE: 40,
+  KEY_BROWSE_SOURCE: 41,
+  KEY_BROWSE_INDEX: 42,
+  KEY_BROWSE_COUNT: 43,
+  KEY_BROWSE_TITLE: 44,
+  KEY_BROWSE_DETAIL: 45,
+  KEY_CMD_BROWSE_PLAY: 46,
+  KEY_BROWSE_DIRECTION: 47,
+  KEY_STATUS_HEALTH: 48,
+  KEY_CMD_SEEK: 49
 };
 
 // Play state definitions
@@ -39,51 +74,266 @@ var PlayState = {
 // Store the Sonos IP address
 var sonosIP = '';
 
-// Simple XML parser function for Sonos responses
-function extractValue(xml, tag) {
-  var start = xml.indexOf('<' + tag + '>');
-  var end = xml.indexOf('</' + tag + '>', start);
-  if (start !== -1 && end !== -1) {
-    return xml.substring(start + tag.length + 2, end);
+// Zones. Commands go to the coordinator of the group being controlled: the
+// group holding the zone picked on the watch, else the one holding the
+// configured speaker. The topology is persisted so a launch within its TTL
+// costs no extra request.
+var TOPOLOGY_STORAGE_KEY = 'topology';
+var ZONE_STORAGE_KEY = 'KEY_ZONE_ID';
+var ZONE_POLL_CONCURRENCY = 4;
+var ZONE_LIST_MAX = 8;        // ZONE_MAX in the watch app
+var ZONE_SELECTED = 0x10;     // KEY_ZONE_STATE flag for the group being controlled
+
+var topology = new zones.Topology(function(url, headers, body, callback) {
+  sendRequest(url, 'POST', headers, body, callback);
+}, function(saved) {
+  localStorage.setItem(TOPOLOGY_STORAGE_KEY, JSON.stringify(saved));
+});
+var selectedZone = null;  // UUID of the speaker picked on the watch
+var zoneList = [];        // groups as last listed on the watch
+var zoneStats = { polls: 0, pollMs: 0, zones: 0 };
+
+function loadTopology() {
+  try {
+    topology.restore(JSON.parse(localStorage.getItem(TOPOLOGY_STORAGE_KEY)));
+  } catch (e) {
+    console.log('Ignoring stored topology: ' + e);
   }
-  return '';
+  selectedZone = localStorage.getItem(ZONE_STORAGE_KEY);
+}
+
+// The configured speaker as host:port
+function configuredHost() {
+  if (!sonosIP) return '';
+  return sonosIP.indexOf(':') === -1 ? sonosIP + ':1400' : sonosIP;
+}
+
+function activeGroup() {
+  return topology.findGroup(selectedZone, null) || topology.findGroup(null, configuredHost());
+}
+
+// Transport and group volume actions are only honoured by the coordinator
+function activeHost() {
+  var group = activeGroup();
+  return group ? group.coordinator.host : configuredHost();
+}
+
+// A speaker that rejects a transport action has most likely been regrouped
+function routed(callback) {
+  return function(err, response) {
+    if (err && err.indexOf('HTTP Error: 5') === 0) topology.invalidate('transport action rejected');
+    callback(err, response);
+  };
+}
+
+function logZoneStats() {
+  var stats = topology.stats;
+  console.log('Topology: ' + stats.hits + '/' + stats.lookups + ' lookups cached (' +
+              Math.round(100 * stats.hits / Math.max(stats.lookups, 1)) + '%), ' + stats.fetches + ' refreshes (' +
+              stats.failures + ' failed), ' + Math.round(stats.fetchMs / Math.max(stats.fetches - stats.failures, 1)) +
+              ' ms per refresh, ' + stats.invalidations + ' invalidations');
+  console.log('Zone polls: ' + zoneStats.polls + ', ' + Math.round(zoneStats.pollMs / Math.max(zoneStats.polls, 1)) +
+              ' ms per fan-out over ' + zoneStats.zones + ' zones');
+}
+
+// Link counters, logged periodically by logLinkStats()
+var linkStats = { statusSent: 0, statusSuppressed: 0, statusBytes: 0, resyncs: 0, soapRequests: 0, refreshes: 0, refreshMs: 0, since: Date.now() };
+
+// Per-action SOAP timings: queued is when sendRequest() was called, opened
+// when the XHR went out, firstByte when the response headers arrived
+var soapStats = {};
+
+function recordSoapTiming(timing) {
+  var stats = soapStats[timing.action] || (soapStats[timing.action] = { count: 0, queueMs: 0, firstByteMs: 0, totalMs: 0, maxMs: 0 });
+  var total = timing.done - timing.queued;
+  stats.count++;
+  stats.queueMs += timing.opened - timing.queued;
+  stats.firstByteMs += (timing.firstByte || timing.done) - timing.opened;
+  stats.totalMs += total;
+  stats.maxMs = Math.max(stats.maxMs, total);
+}
+
+function logSoapStats() {
+  Object.keys(soapStats).forEach(function(action) {
+    var stats = soapStats[action];
+    console.log('SOAP ' + action + ': ' + stats.count + ' requests, queue ' + Math.round(stats.queueMs / stats.count) +
+                ' ms, first byte ' + Math.round(stats.firstByteMs / stats.count) + ' ms, total ' +
+                Math.round(stats.totalMs / stats.count) + ' ms avg (' + stats.maxMs + ' max)');
+  });
+}
+
+// Command latency tracing. Commands from the watch carry a sequence number and
+// the watch clock at the press (KEY_TRACE_SEQ, KEY_TRACE_SENT_MS). The first
+// SOAP request made on the command's behalf is timed, and both are echoed with
+// the phone's share (KEY_TRACE_TIMINGS) on the first status fetched after the
+// command completed; the watch works out the Bluetooth time from its own clock.
+// Volume commands change no status the watch does not already show, so their
+// trace goes back on its own as soon as SetVolume returns.
+var TRACE_FIELD_MAX = 0xFFFF;
+var requestTrace = null;  // trace the next sendRequest() is made for
+var statusTrace = null;   // completed trace waiting for a status to ride on
+
+function startTrace(cmd) {
+  if (cmd[Keys.KEY_TRACE_SEQ] === undefined) return null;
+  return { seq: cmd[Keys.KEY_TRACE_SEQ], sentMs: cmd[Keys.KEY_TRACE_SENT_MS], received: Date.now(), request: null, done: 0 };
+}
+
+// Run fn with its first SOAP request attributed to trace
+function traced(trace, fn) {
+  requestTrace = trace;
+  try {
+    fn();
+  } finally {
+    requestTrace = null;
+  }
+}
+
+// Run a transport action for a traced command; once it returns, the status
+// refresh that follows is what the trace waits for
+function runTraced(trace, action, callback) {
+  traced(trace, function() {
+    action(function(err, response) {
+      if (trace) {
+        trace.done = Date.now();
+        statusTrace = trace;
+      }
+      callback(err, response);
+    });
+  });
+}
+
+// Queueing before the request, its first byte, the rest of the response and
+// the status refresh after it, as little-endian uint16 ms
+function writeTrace(msg, trace) {
+  var request = trace.request || { queued: trace.done, opened: trace.done, firstByte: trace.done, done: trace.done };
+  var firstByte = request.firstByte || request.done;
+  var fields = [request.opened - trace.received, firstByte - request.opened, request.done - firstByte, Date.now() - trace.done];
+  var bytes = [];
+  fields.forEach(function(ms) {
+    ms = Math.max(0, Math.min(TRACE_FIELD_MAX, Math.round(ms)));
+    bytes.push(ms & 0xFF, ms >> 8);
+  });
+  msg[Keys.KEY_TRACE_SEQ] = trace.seq;
+  msg[Keys.KEY_TRACE_SENT_MS] = trace.sentMs;
+  msg[Keys.KEY_TRACE_TIMINGS] = bytes;
+  console.log('Trace ' + trace.seq + ': queue ' + fields[0] + ' ms, first byte ' + fields[1] + ' ms, transfer ' +
+              fields[2] + ' ms, status ' + fields[3] + ' ms');
+}
+
+function sendTrace(trace) {
+  var msg = {};
+  writeTrace(msg, trace);
+  Pebble.sendAppMessage(msg, null, function(err) {
+    console.log('Failed to send trace: ' + JSON.stringify(err));
+  });
 }
 
 // Basic HTTP request function
-function sendRequest(url, method, headers, body, callback) {
-  var xhr = new XMLHttpRequest();
+// Requests go through the dispatcher (see requests.js) for their deadline, a
+// slot among those in flight and the speaker's circuit breaker. A probe is
+// the breaker's own recovery request, let through while it is open.
+var dispatcher = new requests.Dispatcher(probeSpeaker, speakerHealthChanged);
+
+function sendRequest(url, method, headers, body, callback, probe) {
+  var timing = { action: String((headers && headers.SOAPAction) || method).replace(/^.*#/, ''),
+                 queued: Date.now(), opened: 0, firstByte: 0, done: 0 };
+  if (requestTrace) {
+    requestTrace.request = timing;
+    requestTrace = null;
+  }
+  linkStats.soapRequests++;
   
-  xhr.onload = function() {
-    if (xhr.readyState === 4) {
-      if (xhr.status === 200) {
-        callback(null, xhr.responseText);
-      } else {
-        callback('HTTP Error: ' + xhr.status, null);
+  function finish(err, response) {
+    timing.done = Date.now();
+    recordSoapTiming(timing);
+    callback(err, response);
+  }
+  
+  var host = (/^https?:\/\/([^\/]+)/.exec(url) || [])[1] || '';
+  dispatcher.run({ host: host, action: timing.action, probe: probe }, function(done) {
+    var xhr = new XMLHttpRequest();
+    
+    xhr.onreadystatechange = function() {
+      if (xhr.readyState >= 2 && !timing.firstByte) timing.firstByte = Date.now();
+    };
+    
+    xhr.onload = function() {
+      if (xhr.readyState === 4) {
+        if (xhr.status === 200) {
+          done(null, xhr.responseText);
+        } else {
+          done('HTTP Error: ' + xhr.status, null);
+        }
       }
+    };
+    
+    xhr.onerror = function() {
+      done('Network Error', null);
+    };
+    
+    try {
+      timing.opened = Date.now();
+      xhr.open(method, url);
+      
+      if (headers) {
+        for (var header in headers) {
+          xhr.setRequestHeader(header, headers[header]);
+        }
+      }
+      
+      xhr.send(body || null);
+    } catch (e) {
+      done(e.toString(), null);
     }
-  };
+    return function() { xhr.abort(); };
+  }, finish);
+}
+
+// The breaker's probe: the smallest request every speaker answers
+function probeSpeaker(host, callback) {
+  var body = 
+    '<s:Envelope xmlns:s="http://schemas.xmlsoap.org/soap/envelope/" s:encodingStyle="http://schemas.xmlsoap.org/soap/encoding/">' +
+    '<s:Body>' +
+    '<u:GetTransportInfo xmlns:u="urn:schemas-upnp-org:service:AVTransport:1">' +
+    '<InstanceID>0</InstanceID>' +
+    '</u:GetTransportInfo>' +
+    '</s:Body>' +
+    '</s:Envelope>';
   
-  xhr.onerror = function() {
-    callback('Network Error', null);
+  var headers = {
+    'SOAPAction': 'urn:schemas-upnp-org:service:AVTransport:1#GetTransportInfo',
+    'Content-Type': 'text/xml; charset="utf-8"'
   };
   
-  try {
-    xhr.open(method, url);
-    
-    if (headers) {
-      for (var header in headers) {
-        xhr.setRequestHeader(header, headers[header]);
-      }
-    }
-    
-    xhr.send(body || null);
-  } catch (e) {
-    callback(e.toString(), null);
+  sendRequest('http://' + host + '/MediaRenderer/AVTransport/Control', 'POST', headers, body, callback, true);
+}
+
+// Only the speaker being controlled matters to the watch. It hears of an
+// outage at once; on recovery a fresh status replaces the error screen.
+function speakerHealthChanged(host, reachable) {
+  if (host !== activeHost()) return;
+  if (!reachable) {
+    topology.invalidate('coordinator unreachable');
+    sendHealth(Health.UNREACHABLE);
+    return;
   }
+  getStatus();
 }
 
-// Simple get volume function
+function logDispatchStats() {
+  var stats = dispatcher.stats;
+  console.log('Dispatch: ' + stats.requests + ' requests, ' + stats.waited + ' waited for a slot (' + stats.maxWaiting +
+              ' at most, ' + stats.maxInFlight + ' in flight at most), ' + stats.timeouts + ' timed out, ' +
+              stats.fastFails + ' failed fast, ' + stats.opens + ' breaker opens, ' + stats.probes + ' probes');
+}
+
+// Simple get volume function; a group of several speakers reports its group volume
 function getVolume(callback) {
+  var group = activeGroup();
+  if (group && group.members.length > 1) {
+    getGroupVolume(group.coordinator.host, callback);
+    return;
+  }
   var body = 
     '<s:Envelope xmlns:s="http://schemas.xmlsoap.org/soap/envelope/" s:encodingStyle="http://schemas.xmlsoap.org/soap/encoding/">' +
     '<s:Body>' +
@@ -99,18 +349,23 @@ function getVolume(callback) {
     'Content-Type': 'text/xml; charset="utf-8"'
   };
   
-  sendRequest('http://' + sonosIP + ':1400/MediaRenderer/RenderingControl/Control', 'POST', headers, body, function(err, response) {
+  sendRequest('http://' + activeHost() + '/MediaRenderer/RenderingControl/Control', 'POST', headers, body, function(err, response) {
     if (err) {
       callback(err, 0);
     } else {
-      var volume = parseInt(extractValue(response, 'CurrentVolume'));
+      var volume = parseInt(soap.extractValue(response, 'CurrentVolume'));
       callback(null, isNaN(volume) ? 0 : volume);
     }
   });
 }
 
-// Simple set volume function
+// Simple set volume function; a group of several speakers is scaled as a whole
 function setVolume(volume, callback) {
+  var group = activeGroup();
+  if (group && group.members.length > 1) {
+    setGroupVolume(group.coordinator.host, volume, callback);
+    return;
+  }
   var body = 
     '<s:Envelope xmlns:s="http://schemas.xmlsoap.org/soap/envelope/" s:encodingStyle="http://schemas.xmlsoap.org/soap/encoding/">' +
     '<s:Body>' +
@@ -127,7 +382,217 @@ function setVolume(volume, callback) {
     'Content-Type': 'text/xml; charset="utf-8"'
   };
   
-  sendRequest('http://' + sonosIP + ':1400/MediaRenderer/RenderingControl/Control', 'POST', headers, body, callback);
+  sendRequest('http://' + activeHost() + '/MediaRenderer/RenderingControl/Control', 'POST', headers, body, callback);
+}
+
+// Group volume, answered by the group coordinator
+function getGroupVolume(host, callback) {
+  var body = 
+    '<s:Envelope xmlns:s="http://schemas.xmlsoap.org/soap/envelope/" s:encodingStyle="http://schemas.xmlsoap.org/soap/encoding/">' +
+    '<s:Body>' +
+    '<u:GetGroupVolume xmlns:u="urn:schemas-upnp-org:service:GroupRenderingControl:1">' +
+    '<InstanceID>0</InstanceID>' +
+    '</u:GetGroupVolume>' +
+    '</s:Body>' +
+    '</s:Envelope>';
+  
+  var headers = {
+    'SOAPAction': 'urn:schemas-upnp-org:service:GroupRenderingControl:1#GetGroupVolume',
+    'Content-Type': 'text/xml; charset="utf-8"'
+  };
+  
+  sendRequest('http://' + host + '/MediaRenderer/GroupRenderingControl/Control', 'POST', headers, body, function(err, response) {
+    if (err) {
+      callback(err, 0);
+    } else {
+      var volume = parseInt(soap.extractValue(response, 'CurrentVolume'));
+      callback(null, isNaN(volume) ? 0 : volume);
+    }
+  });
+}
+
+// SetGroupVolume keeps the members' relative levels from the last snapshot,
+// so take one first
+function setGroupVolume(host, volume, callback) {
+  var url = 'http://' + host + '/MediaRenderer/GroupRenderingControl/Control';
+  var snapshotBody = 
+    '<s:Envelope xmlns:s="http://schemas.xmlsoap.org/soap/envelope/" s:encodingStyle="http://schemas.xmlsoap.org/soap/encoding/">' +
+    '<s:Body>' +
+    '<u:SnapshotGroupVolume xmlns:u="urn:schemas-upnp-org:service:GroupRenderingControl:1">' +
+    '<InstanceID>0</InstanceID>' +
+    '</u:SnapshotGroupVolume>' +
+    '</s:Body>' +
+    '</s:Envelope>';
+  var body = 
+    '<s:Envelope xmlns:s="http://schemas.xmlsoap.org/soap/envelope/" s:encodingStyle="http://schemas.xmlsoap.org/soap/encoding/">' +
+    '<s:Body>' +
+    '<u:SetGroupVolume xmlns:u="urn:schemas-upnp-org:service:GroupRenderingControl:1">' +
+    '<InstanceID>0</InstanceID>' +
+    '<DesiredVolume>' + volume + '</DesiredVolume>' +
+    '</u:SetGroupVolume>' +
+    '</s:Body>' +
+    '</s:Envelope>';
+  
+  sendRequest(url, 'POST', {
+    'SOAPAction': 'urn:schemas-upnp-org:service:GroupRenderingControl:1#SnapshotGroupVolume',
+    'Content-Type': 'text/xml; charset="utf-8"'
+  }, snapshotBody, function(err) {
+    if (err) {
+      callback(err, null);
+      return;
+    }
+    sendRequest(url, 'POST', {
+      'SOAPAction': 'urn:schemas-upnp-org:service:GroupRenderingControl:1#SetGroupVolume',
+      'Content-Type': 'text/xml; charset="utf-8"'
+    }, body, callback);
+  });
+}
+
+// Phone-side volume shadow. Clicks move it immediately; a debounced SetVolume
+// carries it to the speaker and status results reconcile it once the speaker
+// has caught up.
+var VOLUME_STEP = 5;
+var VOLUME_DEBOUNCE_MS = 250;
+var VOLUME_MAX_WAIT_MS = 750;
+var volumeShadow = -1;          // -1 until the speaker volume is known
+var volumePendingDelta = 0;     // steps taken before the volume was known
+var volumeFetching = false;
+var volumeDirty = false;        // shadow is ahead of the speaker
+var volumeTimer = null;
+var volumeBurstStart = 0;
+var volumeSetInFlight = false;
+var volumeSettledAt = 0;        // when the last SetVolume completed
+var volumeTrace = null;         // latest traced volume command not yet sent
+
+function clampVolume(volume) {
+  return Math.max(0, Math.min(100, volume));
+}
+
+function stepVolume(delta) {
+  if (volumeShadow < 0) {
+    volumePendingDelta += delta;
+    if (volumeFetching) return;
+    volumeFetching = true;
+    getVolume(function(err, volume) {
+      volumeFetching = false;
+      var pending = volumePendingDelta;
+      volumePendingDelta = 0;
+      if (err) {
+        console.log('Error getting volume: ' + err);
+        return;
+      }
+      volumeShadow = volume;
+      stepVolume(pending);
+    });
+    return;
+  }
+  
+  volumeShadow = clampVolume(volumeShadow + delta);
+  volumeDirty = true;
+  
+  // Trailing debounce, but never hold a burst back longer than the max wait
+  var now = Date.now();
+  if (volumeTimer) {
+    clearTimeout(volumeTimer);
+  } else {
+    volumeBurstStart = now;
+  }
+  var wait = Math.min(VOLUME_DEBOUNCE_MS, Math.max(0, volumeBurstStart + VOLUME_MAX_WAIT_MS - now));
+  volumeTimer = setTimeout(flushVolume, wait);
+}
+
+function flushVolume() {
+  volumeTimer = null;
+  if (!volumeDirty || volumeSetInFlight) return;
+  
+  volumeDirty = false;
+  volumeSetInFlight = true;
+  var target = volumeShadow;
+  var trace = volumeTrace;
+  volumeTrace = null;
+  console.log('Setting volume to: ' + target);
+  
+  function settled(err) {
+    volumeSetInFlight = false;
+    volumeSettledAt = Date.now();
+    if (trace) {
+      trace.done = volumeSettledAt;
+      sendTrace(trace);
+    }
+    if (err) {
+      // Let the next status result tell us where the speaker really is
+      console.log('Error setting volume: ' + err);
+      volumeShadow = -1;
+      volumeDirty = false;
+      return;
+    }
+    // Steps taken while this request was out go in the next one
+    if (volumeDirty && !volumeTimer) flushVolume();
+  }
+  traced(trace, function() { setVolume(target, settled); });
+}
+
+// Pick the volume to report for a status fetch that started at fetchStarted.
+// While steps are pending, or the reading predates the last SetVolume, the
+// shadow wins; otherwise the speaker's reading becomes the new shadow.
+function reconcileVolume(volume, fetchStarted) {
+  if (volumeDirty || volumeSetInFlight || volumeTimer || fetchStarted < volumeSettledAt) {
+    return volumeShadow >= 0 ? volumeShadow : volume;
+  }
+  volumeShadow = volume;
+  return volume;
+}
+
+// Scrub seeks. The watch sends one KEY_CMD_SEEK when a scrub settles and has
+// already moved its own position there. Only one Seek is on the wire at a
+// time: a target arriving meanwhile waits, and a newer one replaces it, so
+// intermediate targets are never sent. Positions read before the last Seek
+// settled are stale and give way to the watch's, as volume does to its shadow.
+var seekTarget = -1;            // waiting for the Seek on the wire, or -1
+var seekInFlight = false;
+var seekSettledAt = 0;
+var seekStats = { targets: 0, seeks: 0, superseded: 0, failed: 0 };
+
+function requestSeek(seconds) {
+  seekStats.targets++;
+  if (seekTarget >= 0) seekStats.superseded++;
+  seekTarget = seconds;
+  // The watch jumped to the target; predict from there
+  watchSession.position = seconds;
+  watchSession.positionAt = Date.now();
+  if (!seekInFlight) flushSeek();
+}
+
+function flushSeek() {
+  var target = seekTarget;
+  seekTarget = -1;
+  seekInFlight = true;
+  seekStats.seeks++;
+  console.log('Seeking to ' + target + ' s');
+  seekPosition(target, function(err) {
+    seekInFlight = false;
+    seekSettledAt = Date.now();
+    if (err) {
+      seekStats.failed++;
+      console.log('Error seeking: ' + err);
+    }
+    if (seekTarget >= 0) {
+      flushSeek();
+      return;
+    }
+    console.log('Seeks: ' + seekStats.seeks + ' sent for ' + seekStats.targets + ' targets (' + seekStats.superseded +
+                ' superseded, ' + seekStats.failed + ' failed)');
+    getStatus();
+  });
+}
+
+// Pick the position to report for a status fetch that started at fetchStarted
+function reconcilePosition(position, fetchStarted) {
+  if ((seekInFlight || seekTarget >= 0 || fetchStarted < seekSettledAt) && watchSession.position >= 0) {
+    var playing = latestStatus && latestStatus.state === PlayState.PLAYING;
+    return watchSession.position + (playing ? Math.round((Date.now() - watchSession.positionAt) / 1000) : 0);
+  }
+  return position;
 }
 
 // Basic play function
@@ -147,7 +612,7 @@ function play(callback) {
     'Content-Type': 'text/xml; charset="utf-8"'
   };
   
-  sendRequest('http://' + sonosIP + ':1400/MediaRenderer/AVTransport/Control', 'POST', headers, body, callback);
+  sendRequest('http://' + activeHost() + '/MediaRenderer/AVTransport/Control', 'POST', headers, body, routed(callback));
 }
 
 // Basic pause function
@@ -166,7 +631,7 @@ function pause(callback) {
     'Content-Type': 'text/xml; charset="utf-8"'
   };
   
-  sendRequest('http://' + sonosIP + ':1400/MediaRenderer/AVTransport/Control', 'POST', headers, body, callback);
+  sendRequest('http://' + activeHost() + '/MediaRenderer/AVTransport/Control', 'POST', headers, body, routed(callback));
 }
 
 // Next track function
@@ -185,7 +650,7 @@ function next(callback) {
     'Content-Type': 'text/xml; charset="utf-8"'
   };
   
-  sendRequest('http://' + sonosIP + ':1400/MediaRenderer/AVTransport/Control', 'POST', headers, body, callback);
+  sendRequest('http://' + activeHost() + '/MediaRenderer/AVTransport/Control', 'POST', headers, body, routed(callback));
 }
 
 // Previous track function
@@ -204,11 +669,105 @@ function previous(callback) {
     'Content-Type': 'text/xml; charset="utf-8"'
   };
   
-  sendRequest('http://' + sonosIP + ':1400/MediaRenderer/AVTransport/Control', 'POST', headers, body, callback);
+  sendRequest('http://' + activeHost() + '/MediaRenderer/AVTransport/Control', 'POST', headers, body, routed(callback));
 }
 
-// Get transport state
-function getTransportState(callback) {
+// Jump to a track of the queue currently loaded (numbered from 1)
+function seekTrack(number, callback) {
+  var body = 
+    '<s:Envelope xmlns:s="http://schemas.xmlsoap.org/soap/envelope/" s:encodingStyle="http://schemas.xmlsoap.org/soap/encoding/">' +
+    '<s:Body>' +
+    '<u:Seek xmlns:u="urn:schemas-upnp-org:service:AVTransport:1">' +
+    '<InstanceID>0</InstanceID>' +
+    '<Unit>TRACK_NR</Unit>' +
+    '<Target>' + number + '</Target>' +
+    '</u:Seek>' +
+    '</s:Body>' +
+    '</s:Envelope>';
+  
+  var headers = {
+    'SOAPAction': 'urn:schemas-upnp-org:service:AVTransport:1#Seek',
+    'Content-Type': 'text/xml; charset="utf-8"'
+  };
+  
+  sendRequest('http://' + activeHost() + '/MediaRenderer/AVTransport/Control', 'POST', headers, body, routed(callback));
+}
+
+// Seek within the current track, to a position in seconds
+function seekPosition(seconds, callback) {
+  var hh = Math.floor(seconds / 3600), mm = Math.floor(seconds / 60) % 60, ss = seconds % 60;
+  var body = 
+    '<s:Envelope xmlns:s="http://schemas.xmlsoap.org/soap/envelope/" s:encodingStyle="http://schemas.xmlsoap.org/soap/encoding/">' +
+    '<s:Body>' +
+    '<u:Seek xmlns:u="urn:schemas-upnp-org:service:AVTransport:1">' +
+    '<InstanceID>0</InstanceID>' +
+    '<Unit>REL_TIME</Unit>' +
+    '<Target>' + hh + ':' + (mm < 10 ? '0' : '') + mm + ':' + (ss < 10 ? '0' : '') + ss + '</Target>' +
+    '</u:Seek>' +
+    '</s:Body>' +
+    '</s:Envelope>';
+  
+  var headers = {
+    'SOAPAction': 'urn:schemas-upnp-org:service:AVTransport:1#Seek',
+    'Content-Type': 'text/xml; charset="utf-8"'
+  };
+  
+  sendRequest('http://' + activeHost() + '/MediaRenderer/AVTransport/Control', 'POST', headers, body, routed(callback));
+}
+
+// Load a URI (a stream, or the queue itself) with its DIDL-Lite metadata
+function setTransportURI(uri, metadata, callback) {
+  var body = 
+    '<s:Envelope xmlns:s="http://schemas.xmlsoap.org/soap/envelope/" s:encodingStyle="http://schemas.xmlsoap.org/soap/encoding/">' +
+    '<s:Body>' +
+    '<u:SetAVTransportURI xmlns:u="urn:schemas-upnp-org:service:AVTransport:1">' +
+    '<InstanceID>0</InstanceID>' +
+    '<CurrentURI>' + soap.escape(uri) + '</CurrentURI>' +
+    '<CurrentURIMetaData>' + soap.escape(metadata) + '</CurrentURIMetaData>' +
+    '</u:SetAVTransportURI>' +
+    '</s:Body>' +
+    '</s:Envelope>';
+  
+  var headers = {
+    'SOAPAction': 'urn:schemas-upnp-org:service:AVTransport:1#SetAVTransportURI',
+    'Content-Type': 'text/xml; charset="utf-8"'
+  };
+  
+  sendRequest('http://' + activeHost() + '/MediaRenderer/AVTransport/Control', 'POST', headers, body, routed(callback));
+}
+
+// Append a container (album, playlist) to the queue; calls back with the
+// number of its first track
+function addURIToQueue(uri, metadata, callback) {
+  var body = 
+    '<s:Envelope xmlns:s="http://schemas.xmlsoap.org/soap/envelope/" s:encodingStyle="http://schemas.xmlsoap.org/soap/encoding/">' +
+    '<s:Body>' +
+    '<u:AddURIToQueue xmlns:u="urn:schemas-upnp-org:service:AVTransport:1">' +
+    '<InstanceID>0</InstanceID>' +
+    '<EnqueuedURI>' + soap.escape(uri) + '</EnqueuedURI>' +
+    '<EnqueuedURIMetaData>' + soap.escape(metadata) + '</EnqueuedURIMetaData>' +
+    '<DesiredFirstTrackNumberEnqueued>0</DesiredFirstTrackNumberEnqueued>' +
+    '<EnqueueAsNext>0</EnqueueAsNext>' +
+    '</u:AddURIToQueue>' +
+    '</s:Body>' +
+    '</s:Envelope>';
+  
+  var headers = {
+    'SOAPAction': 'urn:schemas-upnp-org:service:AVTransport:1#AddURIToQueue',
+    'Content-Type': 'text/xml; charset="utf-8"'
+  };
+  
+  sendRequest('http://' + activeHost() + '/MediaRenderer/AVTransport/Control', 'POST', headers, body, routed(function(err, response) {
+    if (err) {
+      callback(err, 0);
+    } else {
+      callback(null, parseInt(soap.extractValue(response, 'FirstTrackNumberEnqueued'), 10) || 1);
+    }
+  }));
+}
+
+// Get transport state, of the active group unless host is given
+function getTransportState(callback, host) {
   var body = 
     '<s:Envelope xmlns:s="http://schemas.xmlsoap.org/soap/envelope/" s:encodingStyle="http://schemas.xmlsoap.org/soap/encoding/">' +
     '<s:Body>' +
@@ -223,19 +782,18 @@ function getTransportState(callback) {
     'Content-Type': 'text/xml; charset="utf-8"'
   };
   
-  sendRequest('http://' + sonosIP + ':1400/MediaRenderer/AVTransport/Control', 'POST', headers, body, function(err, response) {
+  sendRequest('http://' + (host || activeHost()) + '/MediaRenderer/AVTransport/Control', 'POST', headers, body, function(err, response) {
     if (err) {
       callback(err, 'ERROR');
     } else {
-      var state = extractValue(response, 'CurrentTransportState');
+      var state = soap.extractValue(response, 'CurrentTransportState');
       callback(null, state);
     }
   });
 }
 
-// Get current track info with extensive debugging
-// Get current track info
-function getTrackInfo(callback) {
+// Get current track info and position, of the active group unless host is given
+function getTrackInfo(callback, host) {
   var body = 
     '<s:Envelope xmlns:s="http://schemas.xmlsoap.org/soap/envelope/" s:encodingStyle="http://schemas.xmlsoap.org/soap/encoding/">' +
     '<s:Body>' +
@@ -250,82 +808,22 @@ function getTrackInfo(callback) {
     'Content-Type': 'text/xml; charset="utf-8"'
   };
   
-  sendRequest('http://' + sonosIP + ':1400/MediaRenderer/AVTransport/Control', 'POST', headers, body, function(err, response) {
+  sendRequest('http://' + (host || activeHost()) + '/MediaRenderer/AVTransport/Control', 'POST', headers, body, function(err, response) {
     if (err) {
-      callback(err, { title: '', artist: '', album: '' });
+      callback(err, { title: '', artist: '', album: '', position: 0, duration: 0 });
       return;
     }
     
-    try {
-      // Extract the encoded metadata
-      var metadataStart = response.indexOf('<TrackMetaData>') + 14;
-      var metadataEnd = response.indexOf('</TrackMetaData>');
-      
-      if (metadataStart === -1 || metadataEnd === -1) {
-        callback(null, { title: '', artist: '', album: '' });
-        return;
-      }
-      
-      // Get the encoded XML
-      var encodedMetadata = response.substring(metadataStart, metadataEnd);
-      
-      // Decode HTML entities
-      encodedMetadata = encodedMetadata.replace(/&lt;/g, '<')
-                                       .replace(/&gt;/g, '>')
-                                       .replace(/&quot;/g, '"')
-                                       .replace(/&apos;/g, "'")
-                                       .replace(/&amp;/g, '&');
-      
-      console.log('Decoded metadata:', encodedMetadata);
-      
-      // Now extract the actual info
-      var title = '';
-      var artist = '';
-      var album = '';
-      
-      // Find title
-      var titleStart = encodedMetadata.indexOf('<dc:title>');
-      if (titleStart !== -1) {
-        var titleEnd = encodedMetadata.indexOf('</dc:title>', titleStart);
-        if (titleEnd !== -1) {
-          title = encodedMetadata.substring(titleStart + 10, titleEnd);
-          console.log('Extracted title:', title);
-        }
-      }
-      
-      // Find artist
-      var artistStart = encodedMetadata.indexOf('<dc:creator>');
-      if (artistStart !== -1) {
-        var artistEnd = encodedMetadata.indexOf('</dc:creator>', artistStart);
-        if (artistEnd !== -1) {
-          artist = encodedMetadata.substring(artistStart + 12, artistEnd);
-          console.log('Extracted artist:', artist);
-        }
-      }
-      
-      // Find album
-      var albumStart = encodedMetadata.indexOf('<upnp:album>');
-      if (albumStart !== -1) {
-        var albumEnd = encodedMetadata.indexOf('</upnp:album>', albumStart);
-        if (albumEnd !== -1) {
-          album = encodedMetadata.substring(albumStart + 12, albumEnd);
-          console.log('Extracted album:', album);
-        }
-      }
-      
-      callback(null, {
-        title: title || 'Unknown Title',
-        artist: artist || 'Unknown Artist',
-        album: album || 'Unknown Album'
-      });
-    } catch (e) {
-      console.log('Error parsing track info:', e);
-      callback(null, { title: '', artist: '', album: '' });
-    }
+    // A group member plays its coordinator's stream (x-rincon:<uuid>)
+    if (!host && response.indexOf('<TrackURI>x-rincon:') !== -1) topology.invalidate('polled a group member');
+    var track = soap.parsePositionInfo(response);
+    track.title = track.title || 'Unknown Title';
+    track.artist = track.artist || 'Unknown Artist';
+    track.album = track.album || 'Unknown Album';
+    callback(null, track);
   });
 }
 
-
 // Alternate method to get track info using GetMediaInfo
 function getMediaInfo(callback) {
   var body = 
@@ -342,25 +840,518 @@ function getMediaInfo(callback) {
     'Content-Type': 'text/xml; charset="utf-8"'
   };
   
-  console.log('Sending GetMediaInfo request to ' + sonosIP);
-  
-  sendRequest('http://' + sonosIP + ':1400/MediaRenderer/AVTransport/Control', 'POST', headers, body, function(err, response) {
+  sendRequest('http://' + activeHost() + '/MediaRenderer/AVTransport/Control', 'POST', headers, body, function(err, response) {
     if (err) {
       console.log('Error getting media info: ' + err);
       callback(err, null);
       return;
     }
     
-    console.log('GetMediaInfo response received:');
-    console.log('------ MEDIA INFO START ------');
-    console.log(response);
-    console.log('------ MEDIA INFO END ------');
-    
     callback(null, response);
   });
 }
 
-// Get full status and send to watch
+// Compact status protocol. State, volume and mute travel packed into one
+// integer, and the metadata strings are identified by a hash so unchanged
+// strings never cross Bluetooth. Every status message carries the sequence
+// number of the snapshot it is a delta against; the watch asks for a resync
+// (KEY_CMD_RESYNC) when that base does not match what it last applied.
+var STATUS_PROTOCOL_VERSION = 1;
+var VOLUME_UNKNOWN = 0x7F;
+var POSITION_TOLERANCE_S = 2;
+
+// Snapshot the watch has acknowledged this session; deltas are computed against it
+var watchSession = null;
+var latestStatus = null;
+var statusSendInFlight = false;
+var pendingStatus = null;
+
+function packStatus(status) {
+  var volume = (status.volume >= 0 && status.volume <= 100) ? status.volume : VOLUME_UNKNOWN;
+  return (STATUS_PROTOCOL_VERSION << 24) | ((status.mute ? 1 : 0) << 11) | (volume << 4) | (status.state & 0x0F);
+}
+
+// 32-bit FNV-1a over the three metadata strings
+function metadataHash(status) {
+  var text = status.title + '\u001f' + status.artist + '\u001f' + status.album;
+  var hash = 0x811c9dc5;
+  for (var i = 0; i < text.length; i++) {
+    hash ^= text.charCodeAt(i);
+    hash = Math.imul(hash, 0x01000193);
+  }
+  return hash | 0;
+}
+
+// Rough AppMessage size: dictionary header plus a tuple header per field
+function messageBytes(msg) {
+  var bytes = 1;
+  for (var key in msg) {
+    var value = msg[key];
+    bytes += 7 + (typeof value === 'string' ? value.length + 1 : 4);
+  }
+  return bytes;
+}
+
+function logLinkStats() {
+  var hours = Math.max((Date.now() - linkStats.since) / 3600000, 1 / 3600);
+  var minutes = hours * 60;
+  console.log('Status pushes: ' + linkStats.statusSent + ' sent, ' + linkStats.statusSuppressed +
+              ' suppressed, ' + linkStats.resyncs + ' resyncs (' + Math.round(linkStats.statusSent / hours) + '/h, ' +
+              Math.round(linkStats.statusBytes / hours) + ' bytes/h)');
+  console.log('SOAP requests: ' + Math.round(linkStats.soapRequests / minutes) + '/min, refresh latency: ' +
+              Math.round(linkStats.refreshMs / Math.max(linkStats.refreshes, 1)) + ' ms avg');
+  logSoapStats();
+  logDispatchStats();
+}
+
+// Forget what the watch has seen, so the next status is pushed in full
+function resetWatchSession() {
+  watchSession = { seq: 0, packed: -1, metaHash: null, title: null, artist: null, album: null,
+                   position: -1, positionAt: 0, duration: -1 };
+}
+resetWatchSession();
+
+// The last status pushed to the watch is kept in localStorage so the next
+// launch can show it before the speaker has answered. Position is left out:
+// it is stale by then, and the startup refresh supplies a fresh one.
+var STATUS_SNAPSHOT_KEY = 'lastStatus';
+var startup = null;
+
+function saveStatusSnapshot(status) {
+  localStorage.setItem(STATUS_SNAPSHOT_KEY, JSON.stringify({
+    state: status.state, volume: status.volume, mute: status.mute,
+    title: status.title, artist: status.artist, album: status.album
+  }));
+}
+
+function loadStatusSnapshot() {
+  try {
+    return JSON.parse(localStorage.getItem(STATUS_SNAPSHOT_KEY));
+  } catch (e) {
+    return null;
+  }
+}
+
+// The watch changed its own play state or volume (optimistic UI, error
+// screen), so the packed field must go out again even if ours is unchanged.
+// Counted, so the ack of a status already on the wire does not undo it.
+var watchInvalidations = 0;
+
+function invalidateWatchState() {
+  watchSession.packed = -1;
+  watchInvalidations++;
+}
+
+// Push a status snapshot to the watch as a delta against the acknowledged one.
+// Only one status message is on the wire at a time; newer snapshots replace
+// any that are waiting.
+function sendStatus(status) {
+  if (statusSendInFlight) {
+    pendingStatus = status;
+    return;
+  }
+  
+  // Without track info the watch keeps the strings it already has
+  if (status.title === undefined) {
+    status.title = watchSession.title || '';
+    status.artist = watchSession.artist || '';
+    status.album = watchSession.album || '';
+  }
+  latestStatus = status;
+  
+  var packed = packStatus(status);
+  var metaHash = metadataHash(status);
+  var msg = {};
+  if (packed !== watchSession.packed) {
+    msg[Keys.KEY_STATUS_PACKED] = packed;
+  }
+  if (metaHash !== watchSession.metaHash) {
+    msg[Keys.KEY_STATUS_META_HASH] = metaHash;
+    if (status.title !== watchSession.title) msg[Keys.KEY_STATUS_TRACK_TITLE] = status.title;
+    if (status.artist !== watchSession.artist) msg[Keys.KEY_STATUS_ARTIST_NAME] = status.artist;
+    if (status.album !== watchSession.album) msg[Keys.KEY_STATUS_ALBUM_NAME] = status.album;
+  }
+  if (status.duration !== undefined) {
+    if (status.duration !== watchSession.duration) {
+      msg[Keys.KEY_STATUS_DURATION] = status.duration;
+    }
+    // The watch advances the position itself while playing; only correct it
+    // when it has drifted or the play state changed
+    var predicted = watchSession.position;
+    if (watchSession.packed === packed && (packed & 0x0F) === PlayState.PLAYING) {
+      predicted += (status.positionAt - watchSession.positionAt) / 1000;
+    }
+    if (watchSession.position < 0 || packed !== watchSession.packed ||
+        Math.abs(status.position - predicted) > POSITION_TOLERANCE_S) {
+      msg[Keys.KEY_STATUS_POSITION] = status.position;
+    }
+  }
+  // A traced command's result goes out even when the snapshot has not changed
+  if (statusTrace && status.fetchStarted >= statusTrace.done) {
+    writeTrace(msg, statusTrace);
+    statusTrace = null;
+  }
+  if (Object.keys(msg).length === 0) {
+    linkStats.statusSuppressed++;
+    return;
+  }
+  
+  saveStatusSnapshot(status);
+  healthSent = Health.OK;
+  if (startup && !startup.firstPushMs) {
+    startup.firstPushMs = Date.now() - startup.at;
+    console.log('First status push ' + startup.firstPushMs + ' ms after ready (' +
+                (linkStats.soapRequests - startup.soapRequests) + ' SOAP requests)');
+  }
+  
+  var seq = watchSession.seq + 1;
+  msg[Keys.KEY_STATUS_BASE_SEQ] = watchSession.seq;
+  msg[Keys.KEY_STATUS_SEQ] = seq;
+  
+  linkStats.statusSent++;
+  linkStats.statusBytes += messageBytes(msg);
+  if (linkStats.statusSent % 20 === 0) logLinkStats();
+  
+  var session = watchSession;
+  var invalidations = watchInvalidations;
+  statusSendInFlight = true;
+  Pebble.sendAppMessage(msg,
+    function() {
+      // A resync while this was on the wire started a new session; keep it
+      if (watchSession === session) {
+        var sentPosition = msg[Keys.KEY_STATUS_POSITION] !== undefined;
+        // The watch moved off this state while it was on the wire; send it again
+        var invalidated = watchInvalidations !== invalidations;
+        if (invalidated && !pendingStatus) pendingStatus = status;
+        watchSession = { seq: seq, packed: invalidated ? -1 : packed, metaHash: metaHash,
+                         title: status.title, artist: status.artist, album: status.album,
+                         position: sentPosition ? status.position : session.position,
+                         positionAt: sentPosition ? status.positionAt : session.positionAt,
+                         duration: status.duration !== undefined ? status.duration : session.duration };
+      }
+      statusSendInFlight = false;
+      sendPendingStatus();
+    },
+    function(err) {
+      console.log('Failed to send status: ' + JSON.stringify(err));
+      statusSendInFlight = false;
+      sendPendingStatus();
+    }
+  );
+}
+
+function sendPendingStatus() {
+  if (!pendingStatus) return;
+  var status = pendingStatus;
+  pendingStatus = null;
+  sendStatus(status);
+}
+
+// Errors put the watch into its error state, so whatever follows must be resent
+function sendError(text) {
+  invalidateWatchState();
+  var msg = {};
+  msg[Keys.KEY_STATUS_ERROR_MSG] = text;
+  Pebble.sendAppMessage(msg);
+}
+
+// Link health goes to the watch as a code (KEY_STATUS_HEALTH) rather than an
+// error string, once per change; the next status it gets means OK again.
+var Health = { OK: 0, RETRYING: 1, UNREACHABLE: 2, NOT_CONFIGURED: 3 };
+var healthSent = Health.OK;
+
+function sendHealth(health) {
+  if (health === healthSent) return;
+  healthSent = health;
+  invalidateWatchState();
+  var msg = {};
+  msg[Keys.KEY_STATUS_HEALTH] = health;
+  Pebble.sendAppMessage(msg);
+}
+
+// The speaker did not answer: retrying until its breaker opens, then unreachable
+function linkFailed() {
+  sendHealth(dispatcher.isOpen(activeHost()) ? Health.UNREACHABLE : Health.RETRYING);
+}
+
+// A command that never reached the speaker is a link problem, not the command's
+function commandFailed(err, text) {
+  if (requests.isTransportFailure(err)) {
+    linkFailed();
+  } else {
+    sendError(text);
+  }
+}
+
+// Cover art. When the album art URI changes, the cover is fetched from the
+// speaker, rendered to the watch's bitmap format (see artwork.js) and offered
+// to the watch by content hash (KEY_ART_HASH + KEY_ART_LENGTH). The watch
+// answers with KEY_CMD_ART_REQUEST and the offset it needs only when the cover
+// is not in its cache; chunks then go out one at a time, and a failed chunk is
+// retried from the same offset. The watch asks again from its own offset if a
+// transfer stalls, so nothing is resent that it already holds.
+var ART_SIZE = 48;
+var ART_PHONE_CACHE_SIZE = 8;
+var ART_RETRY_MAX = 4;
+var ART_RETRY_BASE_MS = 100;
+var ART_FETCH_TIMEOUT_MS = 10000;
+
+var artCache = [];      // rendered covers by URI, most recently used last
+var artURI = null;      // URI of the cover for the current track
+var offeredArt = null;  // cover the watch was last offered
+var artTransfer = null; // { cover, offset, started, retries } while streaming
+var artStats = { offers: 0, transfers: 0, resumes: 0, chunks: 0, bytes: 0, retries: 0, transferMs: 0, fetches: 0, fetchFailures: 0, fetchMs: 0, renderMs: 0 };
+
+function logArtStats() {
+  var served = artStats.offers - artStats.transfers;
+  console.log('Covers: ' + artStats.offers + ' offered, ' + artStats.transfers + ' transferred (' +
+              Math.round(100 * served / Math.max(artStats.offers, 1)) + '% from watch cache), ' +
+              Math.round(artStats.bytes / Math.max(artStats.transfers, 1)) + ' bytes and ' +
+              Math.round(artStats.transferMs / Math.max(artStats.transfers, 1)) + ' ms per transfer, ' +
+              artStats.resumes + ' resumes, ' + artStats.retries + ' retries');
+  console.log('Cover fetches: ' + artStats.fetches + ' (' + artStats.fetchFailures + ' failed), ' +
+              Math.round(artStats.fetchMs / Math.max(artStats.fetches, 1)) + ' ms fetch, ' +
+              Math.round(artStats.renderMs / Math.max(artStats.fetches, 1)) + ' ms render on average');
+}
+
+// Colour watches get 8-bit covers, the others dithered 1-bit
+function artSpec() {
+  var info = Pebble.getActiveWatchInfo ? Pebble.getActiveWatchInfo() : null;
+  var mono = info && (info.platform === 'aplite' || info.platform === 'diorite');
+  return { size: ART_SIZE, color: !mono };
+}
+
+function cachedArt(uri) {
+  for (var i = 0; i < artCache.length; i++) {
+    if (artCache[i].uri === uri) {
+      var cover = artCache.splice(i, 1)[0];
+      artCache.push(cover);
+      return cover;
+    }
+  }
+  return null;
+}
+
+// Album art URIs are usually relative to the speaker (/getaa?...)
+function fetchArt(uri, callback) {
+  if (!/^https?:\/\//.test(uri) && dispatcher.isOpen(activeHost())) {
+    callback(requests.ERR_UNREACHABLE, null);
+    return;
+  }
+  var url = /^https?:\/\//.test(uri) ? uri : 'http://' + activeHost() + (uri.charAt(0) === '/' ? '' : '/') + uri;
+  var xhr = new XMLHttpRequest();
+  var started = Date.now();
+  artStats.fetches++;
+  
+  xhr.onload = function() {
+    if (xhr.status !== 200) {
+      callback('HTTP Error: ' + xhr.status, null);
+      return;
+    }
+    var bytes;
+    if (xhr.response && xhr.response.byteLength !== undefined) {
+      bytes = new Uint8Array(xhr.response);
+    } else {
+      // No arraybuffer support: fall back to the binary-safe text decoding
+      var text = xhr.responseText;
+      bytes = new Uint8Array(text.length);
+      for (var i = 0; i < text.length; i++) bytes[i] = text.charCodeAt(i) & 0xFF;
+    }
+    artStats.fetchMs += Date.now() - started;
+    
+    var rendered = Date.now();
+    try {
+      var cover = artwork.renderCover(bytes, artSpec());
+      cover.uri = uri;
+      artStats.renderMs += Date.now() - rendered;
+      console.log('Cover ' + cover.width + 'x' + cover.height + ' from ' + bytes.length + ' bytes rendered in ' +
+                  (Date.now() - rendered) + ' ms (fetch ' + (rendered - started) + ' ms)');
+      callback(null, cover);
+    } catch (e) {
+      callback(e.message, null);
+    }
+  };
+  xhr.onerror = function() { callback('Network Error', null); };
+  xhr.ontimeout = function() { callback('Timeout', null); };
+  
+  try {
+    xhr.open('GET', url);
+    xhr.responseType = 'arraybuffer';
+    if (xhr.overrideMimeType) xhr.overrideMimeType('text/plain; charset=x-user-defined');
+    xhr.timeout = ART_FETCH_TIMEOUT_MS;
+    xhr.send(null);
+  } catch (e) {
+    callback(e.toString(), null);
+  }
+}
+
+// Called with every track snapshot; only a changed URI costs anything
+function updateArt(uri) {
+  if (uri === artURI) return;
+  artURI = uri;
+  if (!uri) {
+    offerArt(null);
+    return;
+  }
+  var cover = cachedArt(uri);
+  if (cover) {
+    offerArt(cover);
+    return;
+  }
+  fetchArt(uri, function(err, result) {
+    if (err) {
+      artStats.fetchFailures++;
+      console.log('Cover art unavailable: ' + err);
+    } else {
+      artCache.push(result);
+      if (artCache.length > ART_PHONE_CACHE_SIZE) artCache.shift();
+    }
+    // The track may have changed while this was loading
+    if (uri === artURI) offerArt(err ? null : result);
+  });
+}
+
+function offerArt(cover) {
+  offeredArt = cover;
+  artTransfer = null;
+  if (cover) artStats.offers++;
+  var msg = {};
+  msg[Keys.KEY_ART_HASH] = cover ? cover.hash : 0;
+  msg[Keys.KEY_ART_LENGTH] = cover ? cover.data.length : 0;
+  Pebble.sendAppMessage(msg, null, function(err) {
+    console.log('Failed to offer cover: ' + JSON.stringify(err));
+  });
+}
+
+// The watch wants the offered cover from offset onwards
+function startArtTransfer(hash, offset) {
+  if (!offeredArt || offeredArt.hash !== hash) {
+    console.log('Ignoring request for cover ' + hash + ', no longer current');
+    return;
+  }
+  if (artTransfer && artTransfer.cover === offeredArt) {
+    artStats.resumes++;
+    artTransfer = { cover: offeredArt, offset: offset, started: artTransfer.started, retries: 0 };
+  } else {
+    artStats.transfers++;
+    artTransfer = { cover: offeredArt, offset: offset, started: Date.now(), retries: 0 };
+  }
+  sendArtChunk(artTransfer);
+}
+
+function sendArtChunk(transfer) {
+  // Superseded by a newer cover or a resume from the watch
+  if (transfer !== artTransfer) return;
+  var data = transfer.cover.data;
+  if (transfer.offset >= data.length) {
+    var elapsed = Date.now() - transfer.started;
+    artStats.transferMs += elapsed;
+    console.log('Cover ' + transfer.cover.hash + ' sent: ' + data.length + ' bytes in ' + elapsed + ' ms');
+    artTransfer = null;
+    logArtStats();
+    return;
+  }
+  
+  var chunk = data.subarray(transfer.offset, transfer.offset + artwork.CHUNK_BYTES);
+  var msg = {};
+  msg[Keys.KEY_ART_HASH] = transfer.cover.hash;
+  msg[Keys.KEY_ART_OFFSET] = transfer.offset;
+  msg[Keys.KEY_ART_DATA] = Array.prototype.slice.call(chunk);
+  Pebble.sendAppMessage(msg,
+    function() {
+      artStats.chunks++;
+      artStats.bytes += chunk.length;
+      transfer.offset += chunk.length;
+      transfer.retries = 0;
+      sendArtChunk(transfer);
+    },
+    function(err) {
+      if (++transfer.retries > ART_RETRY_MAX) {
+        // The watch notices the stall and asks to resume from what it has
+        console.log('Cover chunk at ' + transfer.offset + ' failed, waiting for the watch: ' + JSON.stringify(err));
+        return;
+      }
+      artStats.retries++;
+      setTimeout(function() { sendArtChunk(transfer); }, ART_RETRY_BASE_MS << transfer.retries);
+    }
+  );
+}
+
+// Map a UPnP transport state onto PlayState
+function toPlayState(state) {
+  switch (state) {
+    case 'PLAYING': return PlayState.PLAYING;
+    case 'PAUSED_PLAYBACK': return PlayState.PAUSED;
+    case 'STOPPED': return PlayState.STOPPED;
+    case 'TRANSITIONING': return PlayState.TRANSITIONING;
+    default: return PlayState.UNKNOWN;
+  }
+}
+
+// Status fetches are single-flight: callers arriving while one is running
+// share it, and at most one trailing refresh is queued behind it.
+var statusInFlight = false;
+var statusRefreshQueued = false;
+
+// Query transport state, volume and track info concurrently and merge them
+// into one status snapshot
+function fetchStatus(done) {
+  var started = Date.now();
+  var pending = 3;
+  var stateErr = null, trackErr = null, state = '', volume = 0, track = null;
+  
+  function finish() {
+    if (--pending > 0) return;
+    linkStats.refreshes++;
+    linkStats.refreshMs += Date.now() - started;
+    
+    if (stateErr) {
+      console.log('Error getting transport state: ' + stateErr);
+      // The coordinator may have gone away; look again next time, unless its breaker already knows
+      if (stateErr !== requests.ERR_UNREACHABLE) topology.invalidate('coordinator unreachable');
+      linkFailed();
+      done();
+      return;
+    }
+    
+    var playState = toPlayState(state);
+    console.log('Current play state: ' + state + ' (' + playState + '), volume: ' + volume);
+    
+    var status = { state: playState, volume: volume, mute: false, fetchStarted: started };
+    
+    // Without a track reading the fields are left out, so the watch keeps the
+    // track, position and cover it shows rather than blanking them
+    if (trackErr) console.log('Error getting track info: ' + trackErr);
+    if ((playState === PlayState.PLAYING || playState === PlayState.PAUSED) && track) {
+      updateArt(track.albumArtURI || '');
+      status.title = track.title;
+      status.artist = track.artist;
+      status.album = track.album;
+      status.position = reconcilePosition(track.position, started);
+      status.duration = track.duration;
+      status.positionAt = Date.now();
+    }
+    
+    sendStatus(status);
+    done();
+  }
+  
+  getTransportState(function(err, result) {
+    stateErr = err;
+    state = result;
+    finish();
+  });
+  getVolume(function(err, result) {
+    volume = err ? volumeShadow : reconcileVolume(result, started);
+    finish();
+  });
+  getTrackInfo(function(err, result) {
+    trackErr = err;
+    track = err ? null : result;
+    finish();
+  });
+}
+
 // Get full status and send to watch
 function getStatus() {
   // Try to get IP from local storage if not set yet
@@ -372,60 +1363,218 @@ function getStatus() {
   // Check if we have an IP
   if (!sonosIP) {
     console.log('No IP address configured');
-    var msg = {};
-    msg[Keys.KEY_STATUS_ERROR_MSG] = "No IP configured";
-    Pebble.sendAppMessage(msg);
+    sendHealth(Health.NOT_CONFIGURED);
     return;
   }
   
-  console.log('Using Sonos IP: ' + sonosIP);
+  if (statusInFlight) {
+    statusRefreshQueued = true;
+    return;
+  }
   
-  getTransportState(function(err, state) {
-    if (err) {
-      console.log('Error getting transport state: ' + err);
+  statusInFlight = true;
+  // Resolve the coordinator first; without a topology the configured speaker is used
+  topology.get([configuredHost()], function() {
+    fetchStatus(function() {
+      statusInFlight = false;
+      if (statusRefreshQueued) {
+        statusRefreshQueued = false;
+        getStatus();
+      }
+    });
+  });
+}
+
+// Poll every group's coordinator for its transport state and track title,
+// with at most ZONE_POLL_CONCURRENCY requests in flight
+function pollZones(groups, callback) {
+  var started = Date.now();
+  var results = groups.map(function() { return { state: PlayState.UNKNOWN, title: '' }; });
+  var tasks = [];
+  groups.forEach(function(group, i) {
+    var host = group.coordinator.host;
+    tasks.push(function(done) {
+      getTransportState(function(err, state) {
+        results[i].state = err ? PlayState.ERROR : toPlayState(state);
+        done();
+      }, host);
+    });
+    tasks.push(function(done) {
+      getTrackInfo(function(err, track) {
+        if (!err) results[i].title = track.title;
+        done();
+      }, host);
+    });
+  });
+  zones.runLimited(tasks, ZONE_POLL_CONCURRENCY, function() {
+    zoneStats.polls++;
+    zoneStats.pollMs += Date.now() - started;
+    zoneStats.zones = groups.length;
+    console.log('Polled ' + groups.length + ' zones in ' + (Date.now() - started) + ' ms');
+    logZoneStats();
+    callback(results);
+  });
+}
+
+// Send the zone picker one message per group, each after the previous is acknowledged
+function sendZoneList() {
+  topology.get([configuredHost()], function(err, groups) {
+    if (!groups || groups.length === 0) {
+      console.log('No zones: ' + err);
+      sendError("No zones found");
+      return;
+    }
+    groups = groups.slice(0, ZONE_LIST_MAX);
+    pollZones(groups, function(results) {
+      var active = activeGroup();
+      zoneList = groups;
+      (function send(i) {
+        if (i >= groups.length) return;
+        var msg = {};
+        var selected = active && active.coordinator.uuid === groups[i].coordinator.uuid;
+        msg[Keys.KEY_ZONE_INDEX] = i;
+        msg[Keys.KEY_ZONE_COUNT] = groups.length;
+        msg[Keys.KEY_ZONE_NAME] = zones.groupName(groups[i]).substring(0, 23);
+        msg[Keys.KEY_ZONE_STATE] = results[i].state | (selected ? ZONE_SELECTED : 0);
+        msg[Keys.KEY_ZONE_TITLE] = results[i].title.substring(0, 31);
+        Pebble.sendAppMessage(msg,
+          function() { send(i + 1); },
+          function(e) { console.log('Zone list send failed: ' + JSON.stringify(e)); }
+        );
+      })(0);
+    });
+  });
+}
+
+// Switch control to a group from the last list sent to the watch
+function selectZone(index) {
+  var group = zoneList[index];
+  if (!group) return;
+  console.log('Selected zone: ' + zones.groupName(group));
+  selectedZone = group.coordinator.uuid;
+  localStorage.setItem(ZONE_STORAGE_KEY, selectedZone);
+  // The volume shadow belonged to the previous group
+  volumeShadow = -1;
+  volumePendingDelta = 0;
+  getStatus();
+}
+
+// Queue and favorites browser (see browse.js). The watch asks for windows of
+// rows; each is answered one row per message, each after the previous is
+// acknowledged, and a newer request stops an older one still being sent.
+var BROWSE_TITLE_MAX = 31;    // BrowseRow in the watch app
+var BROWSE_DETAIL_MAX = 23;
+var BROWSE_QUEUE = 0;
+var browsers = [];            // Browser per source, for the group and window size last asked for
+var browseGeneration = 0;
+
+function browserFor(source, pageSize) {
+  var host = activeHost();
+  var current = browsers[source];
+  if (!current || current.host !== host || current.pageSize !== pageSize) {
+    if (current) logBrowseStats(current);
+    current = browsers[source] = new browse.Browser(function(url, headers, body, callback) {
+      sendRequest(url, 'POST', headers, body, callback);
+    }, host, source, pageSize);
+  }
+  return current;
+}
+
+function logBrowseStats(browser) {
+  var stats = browser.stats;
+  console.log('Browse ' + browse.SOURCES[browser.source].id + ': ' + stats.windows + ' windows, ' + stats.hits +
+              ' page hits, ' + stats.fetches + ' fetches (' + stats.prefetches + ' ahead, ' + stats.failures +
+              ' failed), ' + Math.round(stats.fetchMs / Math.max(stats.fetches - stats.failures, 1)) + ' ms per fetch');
+}
+
+function sendBrowseWindow(source, start, count, direction) {
+  var generation = ++browseGeneration;
+  if (!browse.SOURCES[source] || !activeHost()) return;
+  var browser = browserFor(source, count);
+  browser.window(start, direction, function(err, items) {
+    if (generation !== browseGeneration) return;
+    if (!items || items.length === 0) {
+      if (err) console.log('Browse failed: ' + err);
       var msg = {};
-      msg[Keys.KEY_STATUS_ERROR_MSG] = "Connection Error";
+      msg[Keys.KEY_BROWSE_SOURCE] = source;
+      msg[Keys.KEY_BROWSE_INDEX] = start;
+      msg[Keys.KEY_BROWSE_COUNT] = 0;
+      msg[Keys.KEY_BROWSE_TITLE] = err ? 'Not available' : 'Empty';
       Pebble.sendAppMessage(msg);
       return;
     }
-    
-    var playState;
-    switch (state) {
-      case 'PLAYING': playState = PlayState.PLAYING; break;
-      case 'PAUSED_PLAYBACK': playState = PlayState.PAUSED; break;
-      case 'STOPPED': playState = PlayState.STOPPED; break;
-      case 'TRANSITIONING': playState = PlayState.TRANSITIONING; break;
-      default: playState = PlayState.UNKNOWN;
-    }
-    
-    console.log('Current play state: ' + state + ' (' + playState + ')');
-    
-    getVolume(function(volErr, volume) {
+    (function send(i) {
+      if (i >= items.length || generation !== browseGeneration) return;
+      var item = items[i];
       var msg = {};
-      msg[Keys.KEY_STATUS_PLAY_STATE] = playState;
-      msg[Keys.KEY_STATUS_VOLUME] = volume || 0;
-      
-      console.log('Current volume: ' + volume);
-      
-      if (playState === PlayState.PLAYING || playState === PlayState.PAUSED) {
-        getTrackInfo(function(trackErr, track) {
-          msg[Keys.KEY_STATUS_TRACK_TITLE] = track.title;
-          msg[Keys.KEY_STATUS_ARTIST_NAME] = track.artist;
-          msg[Keys.KEY_STATUS_ALBUM_NAME] = track.album;
-          
-          console.log('Sending status with track info:', track);
-          Pebble.sendAppMessage(msg, 
-            function() { console.log('Status sent successfully'); },
-            function(err) { console.log('Failed to send status: ' + JSON.stringify(err)); }
-          );
-        });
-      } else {
-        Pebble.sendAppMessage(msg);
-      }
-    });
+      msg[Keys.KEY_BROWSE_SOURCE] = source;
+      msg[Keys.KEY_BROWSE_INDEX] = start + i;
+      msg[Keys.KEY_BROWSE_COUNT] = browser.total;
+      msg[Keys.KEY_BROWSE_TITLE] = item.title.substring(0, BROWSE_TITLE_MAX);
+      msg[Keys.KEY_BROWSE_DETAIL] = (source === BROWSE_QUEUE ? item.artist : item.description).substring(0, BROWSE_DETAIL_MAX);
+      Pebble.sendAppMessage(msg,
+        function() { send(i + 1); },
+        function(e) { console.log('Browse row send failed: ' + JSON.stringify(e)); }
+      );
+    })(0);
   });
 }
 
+// Favorites that are containers (albums, playlists) are queued and played
+// from their first track; the rest (streams, single tracks) are loaded as is
+function isContainerURI(uri) {
+  return uri.indexOf('x-rincon-cpcontainer:') === 0 || uri.indexOf('file:///jffs/settings/savedqueues.rsq') === 0;
+}
+
+// Switch to the group's queue (when its coordinator is known) at a track, then play
+function playQueueTrack(number, callback) {
+  var group = activeGroup();
+  function seek(err) {
+    if (err) { callback(err); return; }
+    seekTrack(number, function(err) {
+      if (err) { callback(err); return; }
+      play(callback);
+    });
+  }
+  if (group) {
+    setTransportURI('x-rincon-queue:' + group.coordinator.uuid + '#0', '', seek);
+  } else {
+    seek(null);
+  }
+}
+
+function playBrowsed(source, index) {
+  var browser = browsers[source];
+  if (!browser) return;
+  browser.item(index, function(err, item) {
+    if (!item) {
+      console.log('Browse item ' + index + ' not found: ' + err);
+      sendError('Not found');
+      return;
+    }
+    console.log('Playing ' + browse.SOURCES[source].id + ' item ' + index + ': ' + item.title);
+    function done(err) {
+      if (err) {
+        console.log('Error playing ' + item.title + ': ' + err);
+        commandFailed(err, 'Play Error');
+      }
+      getStatus();
+    }
+    if (source === BROWSE_QUEUE) {
+      playQueueTrack(index + 1, done);
+    } else if (isContainerURI(item.uri)) {
+      addURIToQueue(item.uri, item.resMD, function(err, first) {
+        if (err) { done(err); return; }
+        playQueueTrack(first, done);
+      });
+    } else {
+      setTransportURI(item.uri, item.resMD, function(err) {
+        if (err) { done(err); return; }
+        play(done);
+      });
+    }
+  });
+}
 
 // App ready event
 Pebble.addEventListener('ready', function() {
@@ -434,18 +1583,22 @@ Pebble.addEventListener('ready', function() {
   // Try to load IP address from localStorage
   sonosIP = localStorage.getItem('KEY_CONFIG_IP_ADDRESS');
   console.log('Stored IP: ' + sonosIP);
+  loadTopology();
+  resetWatchSession();
+  startup = { at: Date.now(), soapRequests: linkStats.soapRequests, firstPushMs: 0 };
   
-  // Notify the watch that JS is ready
-  Pebble.sendAppMessage({
-    [Keys.KEY_JS_READY]: 1
-  }, 
-  function() { console.log('Ready message sent successfully'); },
-  function(err) { console.log('Failed to send ready message: ' + JSON.stringify(err)); }
-  );
-  
-  // Get status if we have an IP
-  if (sonosIP) {  
+  // Show the cached snapshot straight away (the watch may already be drawing
+  // its own persisted copy, in which case this is a no-op there), then make
+  // the one startup refresh. The first status message doubles as the ready
+  // signal.
+  var snapshot = loadStatusSnapshot();
+  if (snapshot && sonosIP) {
+    sendStatus(snapshot);
+  }
+  if (sonosIP) {
     getStatus();
+  } else {
+    sendHealth(Health.NOT_CONFIGURED);
   }
 });
 
@@ -454,104 +1607,84 @@ Pebble.addEventListener('appmessage', function(e) {
   var cmd = e.payload;
   console.log('Received message: ' + JSON.stringify(cmd));
   
-  if (cmd[Keys.KEY_CMD_APP_READY]) {
-    console.log('Watch app is ready');
-    Pebble.sendAppMessage({
-      [Keys.KEY_JS_READY]: 1
-    });
+  // Commands update the watch UI optimistically, so it no longer matches
+  // what we last sent; make sure the next status carries the packed state.
+  var artRequest = cmd[Keys.KEY_CMD_ART_REQUEST] !== undefined;
+  var zoneSelect = cmd[Keys.KEY_CMD_SELECT_ZONE] !== undefined;
+  var browseRequest = cmd[Keys.KEY_CMD_BROWSE] !== undefined;
+  var browsePlay = cmd[Keys.KEY_CMD_BROWSE_PLAY] !== undefined;
+  var trace = startTrace(cmd);
+  if (!cmd[Keys.KEY_CMD_GET_STATUS] && !artRequest && !cmd[Keys.KEY_CMD_ZONE_LIST] && !browseRequest) {
+    invalidateWatchState();
+  }
+  
+  if (artRequest) {
+    startArtTransfer(cmd[Keys.KEY_ART_HASH], cmd[Keys.KEY_CMD_ART_REQUEST]);
+  } else if (zoneSelect) {
+    selectZone(cmd[Keys.KEY_CMD_SELECT_ZONE]);
+  } else if (cmd[Keys.KEY_CMD_ZONE_LIST]) {
+    console.log('Zone list');
+    sendZoneList();
+  } else if (browseRequest) {
+    sendBrowseWindow(cmd[Keys.KEY_CMD_BROWSE], cmd[Keys.KEY_BROWSE_INDEX], cmd[Keys.KEY_BROWSE_COUNT], cmd[Keys.KEY_BROWSE_DIRECTION] || 0);
+  } else if (browsePlay) {
+    playBrowsed(cmd[Keys.KEY_CMD_BROWSE_PLAY], cmd[Keys.KEY_BROWSE_INDEX]);
+  } else if (cmd[Keys.KEY_CMD_SEEK] !== undefined) {
+    console.log('Seek to ' + cmd[Keys.KEY_CMD_SEEK] + ' s');
+    requestSeek(Math.max(0, cmd[Keys.KEY_CMD_SEEK]));
+  } else if (cmd[Keys.KEY_CMD_RESYNC]) {
+    console.log('Watch requested status resync');
+    linkStats.resyncs++;
+    resetWatchSession();
+    // A dropped message may have been a cover offer
+    if (artURI !== null) offerArt(offeredArt);
+    if (latestStatus) {
+      sendStatus(latestStatus);
+    } else {
+      getStatus();
+    }
   } else if (cmd[Keys.KEY_CMD_GET_STATUS]) {
     console.log('Get status');
     getStatus();
   } else if (cmd[Keys.KEY_CMD_PLAY]) {
     console.log('Play');
     
-    // First, immediately send a message indicating we're transitioning
-    Pebble.sendAppMessage({
-      [Keys.KEY_STATUS_PLAY_STATE]: PlayState.TRANSITIONING
-    });
-    
-    play(function(err) {
+    // The watch already shows TRANSITIONING from its own optimistic update
+    runTraced(trace, play, function(err) {
       if (err) {
         console.log('Error playing: ' + err);
-        Pebble.sendAppMessage({
-          [Keys.KEY_STATUS_ERROR_MSG]: "Play Error"
-        });
+        commandFailed(err, "Play Error");
       }
-      
-      // Poll status more frequently after play
+      // A speaker still buffering answers TRANSITIONING, which the watch polls every second until it settles
       getStatus();
-      
-      // Set up a series of status checks at decreasing intervals
-      setTimeout(function() { 
-        getStatus(); 
-        setTimeout(function() { 
-          getStatus(); 
-          setTimeout(getStatus, 1000);
-        }, 1000);
-      }, 500);
     });
-  
-
-  
-
   } else if (cmd[Keys.KEY_CMD_PAUSE]) {
     console.log('Pause');
-    pause(function(err) {
+    runTraced(trace, pause, function(err) {
       if (err) console.log('Error pausing: ' + err);
       getStatus();
     });
   } else if (cmd[Keys.KEY_CMD_NEXT_TRACK]) {
     console.log('Next track');
-    next(function(err) {
+    runTraced(trace, next, function(err) {
       if (err) console.log('Error next track: ' + err);
       getStatus();
     });
   } else if (cmd[Keys.KEY_CMD_PREV_TRACK]) {
     console.log('Previous track');
-    previous(function(err) {
+    runTraced(trace, previous, function(err) {
       if (err) console.log('Error previous track: ' + err);
       getStatus();
     });
   } else if (cmd[Keys.KEY_CMD_VOL_UP]) {
-    console.log('Volume up');
-    getVolume(function(err, volume) {
-      if (err) {
-        console.log('Error getting volume: ' + err);
-        return;
-      }
-      
-      volume = Math.min(100, volume + 5);
-      console.log('Setting volume to: ' + volume);
-      setVolume(volume, function(setErr) {
-        if (setErr) {
-          console.log('Error setting volume: ' + setErr);
-        } else {
-          Pebble.sendAppMessage({
-            [Keys.KEY_STATUS_VOLUME]: volume
-          });
-        }
-      });
-    });
+    // The watch nets queued clicks into one command carrying the step count
+    console.log('Volume up x' + cmd[Keys.KEY_CMD_VOL_UP]);
+    if (trace) volumeTrace = trace;
+    stepVolume(VOLUME_STEP * cmd[Keys.KEY_CMD_VOL_UP]);
   } else if (cmd[Keys.KEY_CMD_VOL_DOWN]) {
-    console.log('Volume down');
-    getVolume(function(err, volume) {
-      if (err) {
-        console.log('Error getting volume: ' + err);
-        return;
-      }
-      
-      volume = Math.max(0, volume - 5);
-      console.log('Setting volume to: ' + volume);
-      setVolume(volume, function(setErr) {
-        if (setErr) {
-          console.log('Error setting volume: ' + setErr);
-        } else {
-          Pebble.sendAppMessage({
-            [Keys.KEY_STATUS_VOLUME]: volume
-          });
-        }
-      });
-    });
+    console.log('Volume down x' + cmd[Keys.KEY_CMD_VOL_DOWN]);
+    if (trace) volumeTrace = trace;
+    stepVolume(-VOLUME_STEP * cmd[Keys.KEY_CMD_VOL_DOWN]);
   }
 });
 
@@ -573,6 +1706,7 @@ Pebble.addEventListener('webviewclosed', function(e) {
       sonosIP = settings.KEY_CONFIG_IP_ADDRESS;
       console.log('Setting Sonos IP: ' + sonosIP);
       localStorage.setItem('KEY_CONFIG_IP_ADDRESS', sonosIP);
+      topology.invalidate('speaker changed');
       
       // Notify Pebble app about the new IP
       console.log('Sending config data to Pebble');
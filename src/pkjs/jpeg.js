@@ -0,0 +1,391 @@
+// Baseline JPEG decoder for cover art.
+//
+// Handles what speakers and streaming services serve for album art: 8-bit
+// sequential Huffman JPEGs (SOF0/SOF1), greyscale or YCbCr, any sampling
+// factors, restart markers and multi-scan files. Progressive, lossless,
+// arithmetic-coded and CMYK files are rejected with an error.
+//
+// Covers end up a few dozen pixels wide on the watch, so when the caller's
+// target is at most 1/8 of the source in both directions only the DC
+// coefficient of each block is kept: every 8x8 block becomes one pixel and
+// the inverse DCT is skipped entirely.
+
+var ZIGZAG = [
+   0,  1,  8, 16,  9,  2,  3, 10, 17, 24, 32, 25, 18, 11,  4,  5,
+  12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13,  6,  7, 14, 21, 28,
+  35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+  58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63
+];
+
+// cos((2x + 1) * u * pi / 16) scaled by C(u) / 2, indexed [u * 8 + x]
+var IDCT_TABLE = (function() {
+  var table = new Float32Array(64);
+  for (var u = 0; u < 8; u++) {
+    var scale = (u === 0 ? Math.SQRT1_2 : 1) / 2;
+    for (var x = 0; x < 8; x++) {
+      table[u * 8 + x] = scale * Math.cos((2 * x + 1) * u * Math.PI / 16);
+    }
+  }
+  return table;
+})();
+
+// Canonical Huffman table in the form of ITU T.81 F.2.2.3
+function buildHuffman(counts, symbols) {
+  var maxcode = new Int32Array(18);
+  var mincode = new Int32Array(17);
+  var valptr = new Int32Array(17);
+  var code = 0;
+  var k = 0;
+  for (var length = 1; length <= 16; length++) {
+    var n = counts[length - 1];
+    if (n) {
+      valptr[length] = k;
+      mincode[length] = code;
+      code += n;
+      k += n;
+      maxcode[length] = code - 1;
+    } else {
+      maxcode[length] = -1;
+    }
+    code <<= 1;
+  }
+  maxcode[17] = 0x7FFFFFFF;
+  return { maxcode: maxcode, mincode: mincode, valptr: valptr, symbols: symbols };
+}
+
+function clamp(value) {
+  return value < 0 ? 0 : (value > 255 ? 255 : value | 0);
+}
+
+// Separable 8x8 inverse DCT of coef (natural order, dequantized) into
+// plane[offset], adding the level shift
+function idct(coef, work, plane, offset, stride) {
+  var x, y, u;
+  for (y = 0; y < 8; y++) {
+    var row = y * 8;
+    for (x = 0; x < 8; x++) {
+      var sum = 0;
+      for (u = 0; u < 8; u++) {
+        var c = coef[row + u];
+        if (c !== 0) sum += c * IDCT_TABLE[u * 8 + x];
+      }
+      work[row + x] = sum;
+    }
+  }
+  for (x = 0; x < 8; x++) {
+    for (y = 0; y < 8; y++) {
+      var total = 0;
+      for (u = 0; u < 8; u++) {
+        total += work[u * 8 + x] * IDCT_TABLE[u * 8 + y];
+      }
+      plane[offset + y * stride + x] = clamp(total + 128.5);
+    }
+  }
+}
+
+// Entropy-decode one scan starting at bytes[pos]; returns the position of
+// the marker that ends it
+function decodeScan(bytes, pos, frame, components, restartInterval, dcOnly) {
+  var bitBuffer = 0;
+  var bitsLeft = 0;
+  var coef = new Float32Array(64);
+  var work = new Float32Array(64);
+
+  function readBit() {
+    if (bitsLeft === 0) {
+      var value = bytes[pos];
+      if (value === 0xFF) {
+        // Stuffed zero byte, or a marker: feed zeros until the scan ends
+        if (bytes[pos + 1] === 0) { pos += 2; } else { value = 0; }
+      } else {
+        pos++;
+      }
+      bitBuffer = value;
+      bitsLeft = 8;
+    }
+    bitsLeft--;
+    return (bitBuffer >> bitsLeft) & 1;
+  }
+
+  function receive(length) {
+    var value = 0;
+    while (length--) value = (value << 1) | readBit();
+    return value;
+  }
+
+  function receiveExtend(length) {
+    if (length === 0) return 0;
+    var value = receive(length);
+    return value < (1 << (length - 1)) ? value - (1 << length) + 1 : value;
+  }
+
+  function decodeHuffman(table) {
+    var code = 0;
+    for (var length = 1; length <= 16; length++) {
+      code = (code << 1) | readBit();
+      if (code <= table.maxcode[length]) {
+        return table.symbols[table.valptr[length] + code - table.mincode[length]];
+      }
+    }
+    throw new Error('Bad Huffman code');
+  }
+
+  function decodeBlock(component, blockRow, blockCol) {
+    var quant = component.quant;
+    var diff = receiveExtend(decodeHuffman(component.dcTable));
+    component.pred += diff;
+    if (dcOnly) {
+      // Skip the AC coefficients without storing them
+      for (var s = 1; s < 64;) {
+        var skip = decodeHuffman(component.acTable);
+        if ((skip & 15) === 0) {
+          if (skip >> 4 !== 15) break;
+          s += 16;
+          continue;
+        }
+        s += (skip >> 4);
+        receive(skip & 15);
+        s++;
+      }
+      component.plane[blockRow * component.planeWidth + blockCol] = clamp(component.pred * quant[0] / 8 + 128.5);
+      return;
+    }
+
+    coef.fill(0);
+    coef[0] = component.pred * quant[0];
+    for (var k = 1; k < 64;) {
+      var rs = decodeHuffman(component.acTable);
+      var size = rs & 15;
+      var run = rs >> 4;
+      if (size === 0) {
+        if (run !== 15) break;
+        k += 16;
+        continue;
+      }
+      k += run;
+      if (k > 63) break;
+      var z = ZIGZAG[k];
+      coef[z] = receiveExtend(size) * quant[z];
+      k++;
+    }
+    idct(coef, work, component.plane, blockRow * 8 * component.planeWidth + blockCol * 8, component.planeWidth);
+  }
+
+  function resetDecoder() {
+    bitsLeft = 0;
+    for (var i = 0; i < components.length; i++) components[i].pred = 0;
+  }
+
+  function skipToRestart() {
+    while (pos < bytes.length - 1 && !(bytes[pos] === 0xFF && bytes[pos + 1] >= 0xD0 && bytes[pos + 1] <= 0xD7)) pos++;
+    pos += 2;
+    resetDecoder();
+  }
+
+  resetDecoder();
+  var i, v, h, mcu = 0;
+  if (components.length === 1) {
+    // Non-interleaved scan: the component's own blocks, no MCU padding
+    var component = components[0];
+    for (var row = 0; row < component.blocksPerColumn; row++) {
+      for (var col = 0; col < component.blocksPerLine; col++) {
+        if (restartInterval && mcu && mcu % restartInterval === 0) skipToRestart();
+        decodeBlock(component, row, col);
+        mcu++;
+      }
+    }
+  } else {
+    for (var mcuRow = 0; mcuRow < frame.mcusPerColumn; mcuRow++) {
+      for (var mcuCol = 0; mcuCol < frame.mcusPerLine; mcuCol++) {
+        if (restartInterval && mcu && mcu % restartInterval === 0) skipToRestart();
+        for (i = 0; i < components.length; i++) {
+          var c = components[i];
+          for (v = 0; v < c.v; v++) {
+            for (h = 0; h < c.h; h++) {
+              decodeBlock(c, mcuRow * c.v + v, mcuCol * c.h + h);
+            }
+          }
+        }
+        mcu++;
+      }
+    }
+  }
+
+  // Find the marker that ends the scan (skipping stuffed bytes and restarts)
+  while (pos < bytes.length - 1) {
+    if (bytes[pos] === 0xFF && bytes[pos + 1] !== 0 && !(bytes[pos + 1] >= 0xD0 && bytes[pos + 1] <= 0xD7)) break;
+    pos++;
+  }
+  return pos;
+}
+
+function readFrame(bytes, p, dcOnlyTarget) {
+  if (bytes[p] !== 8) throw new Error('Unsupported JPEG precision ' + bytes[p]);
+  var frame = {
+    height: (bytes[p + 1] << 8) | bytes[p + 2],
+    width: (bytes[p + 3] << 8) | bytes[p + 4],
+    components: []
+  };
+  var count = bytes[p + 5];
+  var hmax = 1, vmax = 1, i;
+  for (i = 0; i < count; i++) {
+    var q = p + 6 + i * 3;
+    var component = { id: bytes[q], h: bytes[q + 1] >> 4, v: bytes[q + 1] & 15, tq: bytes[q + 2], pred: 0 };
+    hmax = Math.max(hmax, component.h);
+    vmax = Math.max(vmax, component.v);
+    frame.components.push(component);
+  }
+  if (!frame.width || !frame.height) throw new Error('JPEG without dimensions');
+
+  frame.hmax = hmax;
+  frame.vmax = vmax;
+  frame.mcusPerLine = Math.ceil(frame.width / (8 * hmax));
+  frame.mcusPerColumn = Math.ceil(frame.height / (8 * vmax));
+  frame.dcOnly = dcOnlyTarget > 0 && frame.width >= dcOnlyTarget * 8 && frame.height >= dcOnlyTarget * 8;
+  var blockSize = frame.dcOnly ? 1 : 8;
+  for (i = 0; i < frame.components.length; i++) {
+    var c = frame.components[i];
+    c.blocksPerLine = Math.ceil(Math.ceil(frame.width * c.h / hmax) / 8);
+    c.blocksPerColumn = Math.ceil(Math.ceil(frame.height * c.v / vmax) / 8);
+    c.planeWidth = frame.mcusPerLine * c.h * blockSize;
+    c.plane = new Uint8Array(c.planeWidth * frame.mcusPerColumn * c.v * blockSize);
+  }
+  return frame;
+}
+
+// Combine the component planes into packed RGB
+function toRGB(frame, transform) {
+  var scale = frame.dcOnly ? 8 : 1;
+  var width = Math.ceil(frame.width / scale);
+  var height = Math.ceil(frame.height / scale);
+  var out = new Uint8Array(width * height * 3);
+  var comps = frame.components;
+  var rows = [], cols = [];
+  var i, x, y;
+  // Map output coordinates to each plane once instead of per pixel
+  for (i = 0; i < comps.length; i++) {
+    var c = comps[i];
+    var rowIndex = new Int32Array(height), colIndex = new Int32Array(width);
+    for (y = 0; y < height; y++) rowIndex[y] = Math.floor(y * c.v / frame.vmax) * c.planeWidth;
+    for (x = 0; x < width; x++) colIndex[x] = Math.floor(x * c.h / frame.hmax);
+    rows.push(rowIndex);
+    cols.push(colIndex);
+  }
+
+  var o = 0;
+  for (y = 0; y < height; y++) {
+    for (x = 0; x < width; x++) {
+      var Y = comps[0].plane[rows[0][y] + cols[0][x]];
+      if (comps.length === 1) {
+        out[o++] = Y; out[o++] = Y; out[o++] = Y;
+        continue;
+      }
+      var Cb = comps[1].plane[rows[1][y] + cols[1][x]];
+      var Cr = comps[2].plane[rows[2][y] + cols[2][x]];
+      if (transform === 0) {
+        out[o++] = Y; out[o++] = Cb; out[o++] = Cr;
+        continue;
+      }
+      out[o++] = clamp(Y + 1.402 * (Cr - 128) + 0.5);
+      out[o++] = clamp(Y - 0.344136 * (Cb - 128) - 0.714136 * (Cr - 128) + 0.5);
+      out[o++] = clamp(Y + 1.772 * (Cb - 128) + 0.5);
+    }
+  }
+  return { width: width, height: height, data: out };
+}
+
+// Decode bytes (Uint8Array) to { width, height, data } with packed RGB data.
+// With dcOnlyTarget set, images at least 8x that size come back at 1/8 scale.
+function decode(bytes, dcOnlyTarget) {
+  if (bytes[0] !== 0xFF || bytes[1] !== 0xD8) throw new Error('Not a JPEG');
+  var quant = [], dcTables = [], acTables = [];
+  var frame = null;
+  var restartInterval = 0;
+  var transform = -1;
+  var pos = 2;
+
+  while (pos < bytes.length - 1) {
+    if (bytes[pos] !== 0xFF) { pos++; continue; }
+    var marker = bytes[pos + 1];
+    pos += 2;
+    if (marker === 0xFF) { pos--; continue; }
+    if (marker === 0xD8 || marker === 0x01 || (marker >= 0xD0 && marker <= 0xD7)) continue;
+    if (marker === 0xD9) break;
+
+    var end = pos + ((bytes[pos] << 8) | bytes[pos + 1]);
+    var p = pos + 2;
+    var i;
+    switch (marker) {
+      case 0xDB: // Quantization tables, stored in natural order
+        while (p < end) {
+          var wide = bytes[p] >> 4;
+          var table = new Float32Array(64);
+          var id = bytes[p++] & 15;
+          for (i = 0; i < 64; i++) {
+            table[ZIGZAG[i]] = wide ? (bytes[p] << 8) | bytes[p + 1] : bytes[p];
+            p += wide ? 2 : 1;
+          }
+          quant[id] = table;
+        }
+        break;
+      case 0xC4: // Huffman tables
+        while (p < end) {
+          var tableClass = bytes[p] >> 4;
+          var tableId = bytes[p++] & 15;
+          var counts = bytes.subarray(p, p + 16);
+          var total = 0;
+          for (i = 0; i < 16; i++) total += counts[i];
+          p += 16;
+          (tableClass ? acTables : dcTables)[tableId] = buildHuffman(counts, bytes.subarray(p, p + total));
+          p += total;
+        }
+        break;
+      case 0xC0:
+      case 0xC1:
+        frame = readFrame(bytes, p, dcOnlyTarget || 0);
+        break;
+      case 0xC2: case 0xC3: case 0xC5: case 0xC6: case 0xC7:
+      case 0xC9: case 0xCA: case 0xCB: case 0xCD: case 0xCE: case 0xCF:
+        throw new Error('Unsupported JPEG coding (SOF' + (marker - 0xC0) + ')');
+      case 0xDD:
+        restartInterval = (bytes[p] << 8) | bytes[p + 1];
+        break;
+      case 0xEE: // Adobe: transform 0 means the three components are RGB
+        if (bytes[p] === 0x41 && bytes[p + 1] === 0x64 && bytes[p + 2] === 0x6F && bytes[p + 3] === 0x62 && bytes[p + 4] === 0x65) {
+          transform = bytes[p + 11];
+        }
+        break;
+      case 0xDA: {
+        if (!frame) throw new Error('JPEG scan before frame header');
+        if (frame.components.length !== 1 && frame.components.length !== 3) {
+          throw new Error('Unsupported JPEG with ' + frame.components.length + ' components');
+        }
+        var scanComponents = [];
+        var count = bytes[p++];
+        for (i = 0; i < count; i++) {
+          var selector = bytes[p++];
+          var tables = bytes[p++];
+          for (var j = 0; j < frame.components.length; j++) {
+            var component = frame.components[j];
+            if (component.id !== selector) continue;
+            component.dcTable = dcTables[tables >> 4];
+            component.acTable = acTables[tables & 15];
+            component.quant = quant[component.tq];
+            if (!component.dcTable || !component.acTable || !component.quant) throw new Error('JPEG scan references a missing table');
+            scanComponents.push(component);
+          }
+        }
+        pos = decodeScan(bytes, end, frame, scanComponents, restartInterval, frame.dcOnly);
+        continue;
+      }
+    }
+    pos = end;
+  }
+
+  if (!frame) throw new Error('JPEG without frame header');
+  return toRGB(frame, transform);
+}
+
+module.exports = {
+  decode: decode
+};
@@ -0,0 +1,276 @@
+// PNG decoder for cover art, with the small inflate it needs.
+//
+// Supports non-interlaced images of every colour type at bit depths 1-16.
+// Transparency is composited over white, since the watch has no alpha
+// blending for the cover layer. Adam7-interlaced files are rejected.
+
+var LENGTH_BASE = [3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258];
+var LENGTH_EXTRA = [0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0];
+var DIST_BASE = [1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577];
+var DIST_EXTRA = [0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13];
+var CODE_LENGTH_ORDER = [16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15];
+
+// Canonical Huffman tree as per-length counts plus symbols sorted by code
+function buildTree(lengths, start, count) {
+  var counts = new Uint16Array(16);
+  var offsets = new Uint16Array(16);
+  var symbols = new Uint16Array(count);
+  var i;
+  for (i = 0; i < count; i++) counts[lengths[start + i]]++;
+  counts[0] = 0;
+  for (i = 1; i < 16; i++) offsets[i] = offsets[i - 1] + counts[i - 1];
+  for (i = 0; i < count; i++) {
+    if (lengths[start + i]) symbols[offsets[lengths[start + i]]++] = i;
+  }
+  return { counts: counts, symbols: symbols };
+}
+
+var FIXED_TREES = (function() {
+  var lengths = new Uint8Array(320);
+  var i;
+  for (i = 0; i < 144; i++) lengths[i] = 8;
+  for (; i < 256; i++) lengths[i] = 9;
+  for (; i < 280; i++) lengths[i] = 7;
+  for (; i < 288; i++) lengths[i] = 8;
+  for (; i < 320; i++) lengths[i] = 5;
+  return { literal: buildTree(lengths, 0, 288), distance: buildTree(lengths, 288, 32) };
+})();
+
+// Inflate a zlib stream into a buffer of the known decompressed size
+function inflate(source, outputSize) {
+  var out = new Uint8Array(outputSize);
+  var outPos = 0;
+  var pos = 2; // zlib header; the Adler-32 trailer is not checked
+  var tag = 0;
+  var bitCount = 0;
+
+  function bit() {
+    if (bitCount === 0) {
+      if (pos >= source.length) throw new Error('Truncated PNG data');
+      tag = source[pos++];
+      bitCount = 8;
+    }
+    bitCount--;
+    var value = tag & 1;
+    tag >>>= 1;
+    return value;
+  }
+
+  function bits(count, base) {
+    var value = 0;
+    for (var i = 0; i < count; i++) value |= bit() << i;
+    return value + base;
+  }
+
+  function symbol(tree) {
+    var code = 0, first = 0, index = 0;
+    for (var length = 1; length < 16; length++) {
+      code |= bit();
+      var count = tree.counts[length];
+      if (code - first < count) return tree.symbols[index + code - first];
+      index += count;
+      first = (first + count) << 1;
+      code <<= 1;
+    }
+    throw new Error('Bad deflate code');
+  }
+
+  function dynamicTrees() {
+    var literalCount = bits(5, 257);
+    var distanceCount = bits(5, 1);
+    var codeLengthCount = bits(4, 4);
+    var lengths = new Uint8Array(320);
+    var i;
+    for (i = 0; i < codeLengthCount; i++) lengths[CODE_LENGTH_ORDER[i]] = bits(3, 0);
+    var codeLengthTree = buildTree(lengths, 0, 19);
+    lengths.fill(0, 0, 19);
+
+    for (i = 0; i < literalCount + distanceCount;) {
+      var sym = symbol(codeLengthTree);
+      if (sym < 16) {
+        lengths[i++] = sym;
+        continue;
+      }
+      var previous = 0, repeat;
+      if (sym === 16) {
+        if (i === 0) throw new Error('Bad deflate code lengths');
+        previous = lengths[i - 1];
+        repeat = bits(2, 3);
+      } else if (sym === 17) {
+        repeat = bits(3, 3);
+      } else {
+        repeat = bits(7, 11);
+      }
+      while (repeat--) lengths[i++] = previous;
+    }
+    return {
+      literal: buildTree(lengths, 0, literalCount),
+      distance: buildTree(lengths, literalCount, distanceCount)
+    };
+  }
+
+  var last = 0;
+  while (!last) {
+    last = bit();
+    var type = bits(2, 0);
+    if (type === 0) {
+      bitCount = 0;
+      var length = source[pos] | (source[pos + 1] << 8);
+      pos += 4;
+      if (outPos + length > out.length) throw new Error('PNG data larger than expected');
+      out.set(source.subarray(pos, pos + length), outPos);
+      outPos += length;
+      pos += length;
+      continue;
+    }
+    if (type === 3) throw new Error('Bad deflate block');
+
+    var trees = type === 1 ? FIXED_TREES : dynamicTrees();
+    for (;;) {
+      var sym = symbol(trees.literal);
+      if (sym < 256) {
+        if (outPos >= out.length) throw new Error('PNG data larger than expected');
+        out[outPos++] = sym;
+        continue;
+      }
+      if (sym === 256) break;
+      sym -= 257;
+      var copyLength = bits(LENGTH_EXTRA[sym], LENGTH_BASE[sym]);
+      var distSym = symbol(trees.distance);
+      var from = outPos - bits(DIST_EXTRA[distSym], DIST_BASE[distSym]);
+      if (from < 0 || outPos + copyLength > out.length) throw new Error('Bad deflate distance');
+      for (var k = 0; k < copyLength; k++) out[outPos++] = out[from + k];
+    }
+  }
+  return out;
+}
+
+function readUint32(bytes, p) {
+  return ((bytes[p] << 24) | (bytes[p + 1] << 16) | (bytes[p + 2] << 8) | bytes[p + 3]) >>> 0;
+}
+
+// Undo the per-row filters in place; rows are 1 + rowBytes long
+function unfilter(data, height, rowBytes, bpp) {
+  var prior = -1;
+  for (var y = 0; y < height; y++) {
+    var start = y * (rowBytes + 1);
+    var filter = data[start];
+    var row = start + 1;
+    for (var i = 0; i < rowBytes; i++) {
+      var a = i >= bpp ? data[row + i - bpp] : 0;
+      var b = prior >= 0 ? data[prior + i] : 0;
+      var c = (prior >= 0 && i >= bpp) ? data[prior + i - bpp] : 0;
+      var predictor;
+      switch (filter) {
+        case 0: predictor = 0; break;
+        case 1: predictor = a; break;
+        case 2: predictor = b; break;
+        case 3: predictor = (a + b) >> 1; break;
+        case 4: {
+          var pa = Math.abs(b - c), pb = Math.abs(a - c), pc = Math.abs(a + b - 2 * c);
+          predictor = (pa <= pb && pa <= pc) ? a : (pb <= pc ? b : c);
+          break;
+        }
+        default: throw new Error('Bad PNG filter ' + filter);
+      }
+      data[row + i] = (data[row + i] + predictor) & 0xFF;
+    }
+    prior = row;
+  }
+}
+
+// Decode bytes (Uint8Array) to { width, height, data } with packed RGB data
+function decode(bytes) {
+  if (readUint32(bytes, 0) !== 0x89504E47 || readUint32(bytes, 4) !== 0x0D0A1A0A) throw new Error('Not a PNG');
+  var width = 0, height = 0, depth = 0, colorType = 0;
+  var palette = null, transparency = null;
+  var chunks = [];
+  var compressedSize = 0;
+
+  for (var p = 8; p + 8 <= bytes.length;) {
+    var length = readUint32(bytes, p);
+    var type = String.fromCharCode(bytes[p + 4], bytes[p + 5], bytes[p + 6], bytes[p + 7]);
+    var data = bytes.subarray(p + 8, p + 8 + length);
+    if (type === 'IHDR') {
+      width = readUint32(data, 0);
+      height = readUint32(data, 4);
+      depth = data[8];
+      colorType = data[9];
+      if (data[12] !== 0) throw new Error('Interlaced PNG not supported');
+    } else if (type === 'PLTE') {
+      palette = data;
+    } else if (type === 'tRNS') {
+      transparency = data;
+    } else if (type === 'IDAT') {
+      chunks.push(data);
+      compressedSize += length;
+    } else if (type === 'IEND') {
+      break;
+    }
+    p += 12 + length;
+  }
+  if (!width || !height || !chunks.length) throw new Error('Incomplete PNG');
+
+  var compressed = chunks[0];
+  if (chunks.length > 1) {
+    compressed = new Uint8Array(compressedSize);
+    for (var c = 0, offset = 0; c < chunks.length; c++) {
+      compressed.set(chunks[c], offset);
+      offset += chunks[c].length;
+    }
+  }
+
+  var channels = [1, 0, 3, 1, 2, 0, 4][colorType];
+  if (!channels || (colorType === 3 && !palette)) throw new Error('Unsupported PNG colour type ' + colorType);
+  var bitsPerPixel = channels * depth;
+  var rowBytes = Math.ceil(width * bitsPerPixel / 8);
+  var raw = inflate(compressed, height * (rowBytes + 1));
+  unfilter(raw, height, rowBytes, Math.max(1, bitsPerPixel >> 3));
+
+  var out = new Uint8Array(width * height * 3);
+  var maxSample = (1 << depth) - 1;
+  var samples = [0, 0, 0, 0];
+  var o = 0;
+  for (var y = 0; y < height; y++) {
+    var row = y * (rowBytes + 1) + 1;
+    for (var x = 0; x < width; x++) {
+      for (var s = 0; s < channels; s++) {
+        var index = x * channels + s;
+        if (depth === 8) {
+          samples[s] = raw[row + index];
+        } else if (depth === 16) {
+          samples[s] = raw[row + index * 2];
+        } else {
+          var bitOffset = index * depth;
+          var value = (raw[row + (bitOffset >> 3)] >> (8 - depth - (bitOffset & 7))) & maxSample;
+          samples[s] = colorType === 3 ? value : Math.round(value * 255 / maxSample);
+        }
+      }
+
+      var r, g, b, alpha = 255;
+      if (colorType === 3) {
+        var entry = samples[0];
+        r = palette[entry * 3]; g = palette[entry * 3 + 1]; b = palette[entry * 3 + 2];
+        if (transparency && entry < transparency.length) alpha = transparency[entry];
+      } else if (colorType === 0 || colorType === 4) {
+        r = g = b = samples[0];
+        if (colorType === 4) alpha = samples[1];
+      } else {
+        r = samples[0]; g = samples[1]; b = samples[2];
+        if (colorType === 6) alpha = samples[3];
+      }
+      if (alpha !== 255) {
+        r = (r * alpha + 255 * (255 - alpha)) / 255;
+        g = (g * alpha + 255 * (255 - alpha)) / 255;
+        b = (b * alpha + 255 * (255 - alpha)) / 255;
+      }
+      out[o++] = r; out[o++] = g; out[o++] = b;
+    }
+  }
+  return { width: width, height: height, data: out };
+}
+
+module.exports = {
+  decode: decode,
+  inflate: inflate
+};
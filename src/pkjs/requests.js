@@ -0,0 +1,205 @@
+// Admission control for requests to the speakers.
+//
+// Every request has a deadline by SOAP action, counted from when it was
+// asked for, so time spent waiting for a slot comes out of its time on the
+// wire; a request still unanswered at its deadline is aborted and fails with
+// ERR_TIMEOUT. At most MAX_IN_FLIGHT requests are outstanding. The rest wait,
+// user commands ahead of background polls.
+//
+// Each speaker has a circuit breaker. After BREAKER_THRESHOLD consecutive
+// transport failures (timeouts and network errors; an HTTP error still means
+// the speaker answered) it opens: waiting and new requests for that speaker
+// fail at once with ERR_UNREACHABLE, and after a backoff a single cheap probe
+// is sent. A failed probe doubles the backoff; the first that succeeds closes
+// the breaker. onHealth(host, reachable) is told whenever a breaker opens or
+// closes.
+
+var MAX_IN_FLIGHT = 4;
+var BREAKER_THRESHOLD = 3;
+var BREAKER_BACKOFF_MS = 2000;
+var BREAKER_BACKOFF_MAX_MS = 60 * 1000;
+
+var ERR_TIMEOUT = 'Timeout';
+var ERR_UNREACHABLE = 'Speaker unreachable';
+
+var PRIORITY_USER = 0;
+var PRIORITY_BACKGROUND = 1;
+
+// Deadline in ms and priority by action. Queries that answer from the
+// speaker's memory are short; loading content can wait on a music service.
+var ACTIONS = {
+  Play: [3000, PRIORITY_USER],
+  Pause: [3000, PRIORITY_USER],
+  Next: [3000, PRIORITY_USER],
+  Previous: [3000, PRIORITY_USER],
+  Seek: [3000, PRIORITY_USER],
+  SetVolume: [2000, PRIORITY_USER],
+  SetGroupVolume: [2000, PRIORITY_USER],
+  SetAVTransportURI: [6000, PRIORITY_USER],
+  AddURIToQueue: [6000, PRIORITY_USER],
+  Browse: [4000, PRIORITY_USER],
+  GetTransportInfo: [2000, PRIORITY_BACKGROUND],
+  GetVolume: [2000, PRIORITY_BACKGROUND],
+  GetGroupVolume: [2000, PRIORITY_BACKGROUND],
+  GetPositionInfo: [3000, PRIORITY_BACKGROUND],
+  GetMediaInfo: [3000, PRIORITY_BACKGROUND],
+  GetZoneGroupState: [5000, PRIORITY_BACKGROUND]
+};
+var DEFAULT_ACTION = [4000, PRIORITY_BACKGROUND];
+
+// Failures that say nothing came back from the speaker
+function isTransportFailure(err) {
+  return !!err && String(err).indexOf('HTTP Error') !== 0;
+}
+
+// probe(host, callback(err)) makes the recovery request; it is run with
+// { probe: true } so the open breaker lets it through
+function Dispatcher(probe, onHealth) {
+  this.probe = probe;
+  this.onHealth = onHealth;
+  this.inFlight = 0;
+  this.waiting = [[], []];   // by priority
+  this.breakers = {};        // by host
+  this.stats = { requests: 0, waited: 0, maxWaiting: 0, timeouts: 0, fastFails: 0, opens: 0, probes: 0, maxInFlight: 0 };
+}
+
+Dispatcher.prototype.breaker = function(host) {
+  if (!this.breakers[host]) {
+    this.breakers[host] = { open: false, failures: 0, backoff: BREAKER_BACKOFF_MS, timer: null };
+  }
+  return this.breakers[host];
+};
+
+Dispatcher.prototype.isOpen = function(host) {
+  return !!this.breakers[host] && this.breakers[host].open;
+};
+
+// Run start(done) for host once a slot is free. start calls done(err,
+// response) and may return a function that aborts the request; callback gets
+// the first outcome, or ERR_TIMEOUT at the deadline.
+Dispatcher.prototype.run = function(options, start, callback) {
+  var self = this;
+  var spec = ACTIONS[options.action] || DEFAULT_ACTION;
+  var request = { host: options.host, action: options.action, probe: !!options.probe, priority: spec[1],
+                  start: start, callback: callback, settled: false, running: false, abort: null, timer: null };
+  this.stats.requests++;
+  if (!request.probe && this.isOpen(request.host)) {
+    this.stats.fastFails++;
+    callback(ERR_UNREACHABLE, null);
+    return;
+  }
+  request.timer = setTimeout(function() {
+    request.timer = null;
+    self.stats.timeouts++;
+    self.settle(request, ERR_TIMEOUT, null);
+  }, spec[0]);
+  if (this.inFlight < MAX_IN_FLIGHT) {
+    this.launch(request);
+    return;
+  }
+  this.stats.waited++;
+  this.waiting[request.priority].push(request);
+  this.stats.maxWaiting = Math.max(this.stats.maxWaiting, this.waiting[0].length + this.waiting[1].length);
+};
+
+Dispatcher.prototype.launch = function(request) {
+  var self = this;
+  request.running = true;
+  this.inFlight++;
+  this.stats.maxInFlight = Math.max(this.stats.maxInFlight, this.inFlight);
+  request.abort = request.start(function(err, response) {
+    self.settle(request, err, response);
+  }) || null;
+};
+
+Dispatcher.prototype.settle = function(request, err, response) {
+  if (request.settled) return;
+  request.settled = true;
+  if (request.timer) clearTimeout(request.timer);
+  if (request.running) {
+    this.inFlight--;
+    // A failure of our own making leaves the request open on the wire
+    if ((err === ERR_TIMEOUT || err === ERR_UNREACHABLE) && request.abort) request.abort();
+    // Only what happened on the wire says anything about the speaker
+    if (!request.probe && err !== ERR_UNREACHABLE) this.record(request.host, err);
+  } else {
+    var queue = this.waiting[request.priority];
+    var index = queue.indexOf(request);
+    if (index !== -1) queue.splice(index, 1);
+  }
+  request.callback(err, response);
+  this.pump();
+};
+
+// Requests for a speaker whose breaker opened while they waited fail instead of starting
+Dispatcher.prototype.pump = function() {
+  while (this.inFlight < MAX_IN_FLIGHT) {
+    var next = this.waiting[PRIORITY_USER].shift() || this.waiting[PRIORITY_BACKGROUND].shift();
+    if (!next) return;
+    if (!next.probe && this.isOpen(next.host)) {
+      this.stats.fastFails++;
+      this.settle(next, ERR_UNREACHABLE, null);
+      continue;
+    }
+    this.launch(next);
+  }
+};
+
+Dispatcher.prototype.record = function(host, err) {
+  var breaker = this.breaker(host);
+  if (!isTransportFailure(err)) {
+    breaker.failures = 0;
+    return;
+  }
+  if (++breaker.failures >= BREAKER_THRESHOLD && !breaker.open) this.trip(host);
+};
+
+// Open the breaker, fail whatever is waiting for the speaker and schedule a probe
+Dispatcher.prototype.trip = function(host) {
+  var self = this;
+  var breaker = this.breaker(host);
+  var wasOpen = breaker.open;
+  breaker.open = true;
+  breaker.timer = setTimeout(function() {
+    breaker.timer = null;
+    self.stats.probes++;
+    self.probe(host, function(err) {
+      if (isTransportFailure(err)) {
+        breaker.backoff = Math.min(breaker.backoff * 2, BREAKER_BACKOFF_MAX_MS);
+        self.trip(host);
+        return;
+      }
+      console.log('Speaker ' + host + ' reachable again');
+      breaker.open = false;
+      breaker.failures = 0;
+      breaker.backoff = BREAKER_BACKOFF_MS;
+      self.onHealth(host, true);
+    });
+  }, breaker.backoff);
+  if (wasOpen) return;
+  this.stats.opens++;
+  console.log('Speaker ' + host + ' unreachable after ' + breaker.failures + ' failures, probing in ' + breaker.backoff + ' ms');
+  // Take them all off the queues first, so no pump from a settle below can start one
+  var failed = [];
+  this.waiting = this.waiting.map(function(queue) {
+    return queue.filter(function(request) {
+      if (request.host !== host || request.probe) return true;
+      failed.push(request);
+      return false;
+    });
+  });
+  failed.forEach(function(request) {
+    self.stats.fastFails++;
+    self.settle(request, ERR_UNREACHABLE, null);
+  });
+  this.onHealth(host, false);
+};
+
+module.exports = {
+  MAX_IN_FLIGHT: MAX_IN_FLIGHT,
+  BREAKER_THRESHOLD: BREAKER_THRESHOLD,
+  ERR_TIMEOUT: ERR_TIMEOUT,
+  ERR_UNREACHABLE: ERR_UNREACHABLE,
+  isTransportFailure: isTransportFailure,
+  Dispatcher: Dispatcher
+};
@@ -0,0 +1,191 @@
+// Single-pass extraction of the fields we need from Sonos SOAP responses.
+//
+// Responses are scanned forward once and only the captured values are
+// decoded, so large DIDL-Lite blobs (long queues, radio metadata) are never
+// copied or entity-decoded as a whole.
+
+var ENTITIES = { lt: '<', gt: '>', quot: '"', apos: "'", amp: '&' };
+
+// Decode the entity at text[pos] (which is '&'), returning [char, length] or
+// null when it is not a well-formed entity inside [pos, end)
+function decodeEntity(text, pos, end) {
+  var semi = text.indexOf(';', pos + 1);
+  if (semi === -1 || semi >= end || semi - pos > 10) return null;
+  var name = text.substring(pos + 1, semi);
+  if (name.charCodeAt(0) === 35) { // '#'
+    var code = name.charCodeAt(1) === 120 ? parseInt(name.substring(2), 16) : parseInt(name.substring(1), 10);
+    return isNaN(code) ? null : [String.fromCharCode(code), semi - pos + 1];
+  }
+  var ch = ENTITIES[name];
+  return ch === undefined ? null : [ch, semi - pos + 1];
+}
+
+// Entity-decode text[start, end). DIDL text inside a SOAP response is escaped
+// twice (&amp;amp;), so with depth 2 an '&amp;' that introduces a second entity
+// is folded into it in the same pass.
+function decode(text, start, end, depth) {
+  var amp = text.indexOf('&', start);
+  if (amp === -1 || amp >= end) return text.substring(start, end);
+
+  var out = '';
+  var pos = start;
+  while (amp !== -1 && amp < end) {
+    var entity = decodeEntity(text, amp, end);
+    if (entity) {
+      out += text.substring(pos, amp);
+      pos = amp + entity[1];
+      if (depth > 1 && entity[0] === '&') {
+        var inner = decodeEntity(text, pos - 1, end);
+        if (inner) {
+          entity = inner;
+          pos = pos - 1 + inner[1];
+        }
+      }
+      out += entity[0];
+    }
+    amp = text.indexOf('&', entity ? pos : amp + 1);
+  }
+  return out + text.substring(pos, end);
+}
+
+// Escape text for an XML element, e.g. DIDL-Lite metadata passed back to the speaker
+function escape(text) {
+  return String(text).replace(/&/g, '&amp;').replace(/</g, '&lt;').replace(/>/g, '&gt;').replace(/"/g, '&quot;');
+}
+
+// Find <tag>...</tag> at or after from; returns [contentStart, contentEnd] or null
+function findElement(xml, tag, from) {
+  var openTag = '<' + tag + '>';
+  var start = xml.indexOf(openTag, from);
+  if (start === -1) return null;
+  start += openTag.length;
+  var end = xml.indexOf('</' + tag + '>', start);
+  return end === -1 ? null : [start, end];
+}
+
+// Text content of the first <tag> element, entity-decoded
+function extractValue(xml, tag) {
+  var range = findElement(xml, tag, 0);
+  return range ? decode(xml, range[0], range[1], 1) : '';
+}
+
+// Fields read from escaped DIDL-Lite (TrackMetaData, Browse results). A field
+// is only captured when the result object starts it out as ''.
+var DIDL_FIELDS = [
+  { open: 'dc:title&gt;', close: '&lt;/dc:title&gt;', field: 'title' },
+  { open: 'dc:creator&gt;', close: '&lt;/dc:creator&gt;', field: 'artist' },
+  { open: 'upnp:album&gt;', close: '&lt;/upnp:album&gt;', field: 'album' },
+  { open: 'upnp:albumArtURI&gt;', close: '&lt;/upnp:albumArtURI&gt;', field: 'albumArtURI' },
+  { open: 'r:streamContent&gt;', close: '&lt;/r:streamContent&gt;', field: 'streamContent' },
+  { open: 'r:description&gt;', close: '&lt;/r:description&gt;', field: 'description' },
+  { open: 'r:resMD&gt;', close: '&lt;/r:resMD&gt;', field: 'resMD' }
+];
+
+// Compare without slicing, so skipped elements cost no allocation
+function matchesAt(text, pos, expected) {
+  for (var i = 0; i < expected.length; i++) {
+    if (text.charCodeAt(pos + i) !== expected.charCodeAt(i)) return false;
+  }
+  return true;
+}
+
+// Walk the escaped DIDL-Lite in xml[start, end) once, capturing the first
+// occurrence of each wanted element
+function parseDidl(xml, start, end, result) {
+  var pos = xml.indexOf('&lt;', start);
+  while (pos !== -1 && pos < end) {
+    var nameStart = pos + 4;
+    var next = nameStart;
+    for (var i = 0; i < DIDL_FIELDS.length; i++) {
+      var entry = DIDL_FIELDS[i];
+      if (result[entry.field] === '' && matchesAt(xml, nameStart, entry.open)) {
+        var valueStart = nameStart + entry.open.length;
+        var valueEnd = xml.indexOf(entry.close, valueStart);
+        if (valueEnd === -1 || valueEnd >= end) return;
+        result[entry.field] = decode(xml, valueStart, valueEnd, 2);
+        next = valueEnd + entry.close.length;
+        break;
+      }
+    }
+    pos = xml.indexOf('&lt;', next);
+  }
+}
+
+// Parse an H:MM:SS track time into seconds, 0 if absent
+function parseTrackTime(xml, range) {
+  if (!range || range[1] - range[0] < 5) return 0;
+  var text = xml.substring(range[0], range[1]);
+  var parts = text.split(':');
+  if (parts.length !== 3) return 0;
+  var seconds = parseInt(parts[0], 10) * 3600 + parseInt(parts[1], 10) * 60 + parseInt(parts[2], 10);
+  return isNaN(seconds) ? 0 : seconds;
+}
+
+// Parse a GetPositionInfo response. Elements come in the order
+// TrackDuration, TrackMetaData, RelTime, so the scan only moves forward.
+function parsePositionInfo(xml) {
+  var result = { title: '', artist: '', album: '', albumArtURI: '', streamContent: '', position: 0, duration: 0 };
+
+  var duration = findElement(xml, 'TrackDuration', 0);
+  var metadata = findElement(xml, 'TrackMetaData', duration ? duration[1] : 0);
+  var relTime = findElement(xml, 'RelTime', metadata ? metadata[1] : (duration ? duration[1] : 0));
+
+  result.duration = parseTrackTime(xml, duration);
+  result.position = parseTrackTime(xml, relTime);
+  if (metadata) {
+    parseDidl(xml, metadata[0], metadata[1], result);
+  }
+
+  // Radio streams put the station in dc:title and "Artist - Title" in streamContent
+  if (result.streamContent && !result.artist) {
+    var split = result.streamContent.indexOf(' - ');
+    result.album = result.album || result.title;
+    if (split !== -1) {
+      result.artist = result.streamContent.substring(0, split);
+      result.title = result.streamContent.substring(split + 3);
+    } else {
+      result.title = result.streamContent;
+    }
+  }
+  return result;
+}
+
+// Parse a ContentDirectory#Browse response: the <item>s of the escaped
+// DIDL-Lite in Result, in order, with TotalMatches and UpdateID. res carries
+// attributes, so it is found by hand; resMD comes out as plain DIDL-Lite,
+// ready to be escaped into a SetAVTransportURI.
+function parseBrowse(xml) {
+  var result = { items: [], total: 0, updateID: '' };
+  var didl = findElement(xml, 'Result', 0);
+  var pos = didl ? xml.indexOf('&lt;item ', didl[0]) : -1;
+  while (pos !== -1 && pos < didl[1]) {
+    var end = xml.indexOf('&lt;/item&gt;', pos);
+    if (end === -1 || end > didl[1]) break;
+    var item = { title: '', artist: '', description: '', resMD: '', uri: '' };
+    parseDidl(xml, pos, end, item);
+    var res = xml.indexOf('&lt;res', pos);
+    if (res !== -1 && res < end) {
+      var valueStart = xml.indexOf('&gt;', res) + 4;
+      var valueEnd = xml.indexOf('&lt;/res&gt;', valueStart);
+      if (valueEnd !== -1 && valueEnd < end) item.uri = decode(xml, valueStart, valueEnd, 2);
+    }
+    result.items.push(item);
+    pos = xml.indexOf('&lt;item ', end);
+  }
+  var from = didl ? didl[1] : 0;
+  var total = findElement(xml, 'TotalMatches', from);
+  var updateID = findElement(xml, 'UpdateID', from);
+  result.total = total ? parseInt(xml.substring(total[0], total[1]), 10) || 0 : result.items.length;
+  result.updateID = updateID ? xml.substring(updateID[0], updateID[1]) : '';
+  return result;
+}
+
+module.exports = {
+  decode: decode,
+  escape: escape,
+  findElement: findElement,
+  extractValue: extractValue,
+  parseDidl: parseDidl,
+  parsePositionInfo: parsePositionInfo,
+  parseBrowse: parseBrowse
+};
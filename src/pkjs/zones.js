@@ -0,0 +1,226 @@
+// Household topology: which speakers exist, how they are grouped and which
+// one coordinates each group.
+//
+// PebbleKit JS has no UDP, so SSDP discovery is not available. Instead any
+// known speaker (the configured one first, then every speaker seen in the
+// last topology) is asked for ZoneGroupTopology#GetZoneGroupState, which
+// describes the whole household. The result is cached with a TTL and
+// dropped early when a request shows it is out of date.
+
+var soap = require('./soap');
+
+var TOPOLOGY_TTL_MS = 5 * 60 * 1000;
+// After a failed refresh, wait this long before asking again
+var TOPOLOGY_RETRY_MS = 30 * 1000;
+
+// Value of name="..." inside a tag, entity-decoded
+function attribute(tag, name) {
+  var key = ' ' + name + '="';
+  var start = tag.indexOf(key);
+  if (start === -1) return '';
+  start += key.length;
+  var end = tag.indexOf('"', start);
+  return end === -1 ? '' : soap.decode(tag, start, end, 1);
+}
+
+// host:port from a device description URL
+function hostFromLocation(location) {
+  var match = /^https?:\/\/([^\/]+)/.exec(location);
+  return match ? match[1] : '';
+}
+
+// Parse a GetZoneGroupState response into
+// [{ id, coordinator: member, members: [member] }] with
+// member = { uuid, name, host }. Invisible members (bonded surrounds and
+// subs) are left out, as are satellites nested inside a member.
+function parseZoneGroupState(xml) {
+  var state = soap.extractValue(xml, 'ZoneGroupState');
+  var groups = [];
+  var pos = state.indexOf('<ZoneGroup ');
+  while (pos !== -1) {
+    var tagEnd = state.indexOf('>', pos);
+    var groupEnd = state.indexOf('</ZoneGroup>', tagEnd);
+    if (tagEnd === -1 || groupEnd === -1) break;
+    var groupTag = state.substring(pos, tagEnd);
+    var group = { id: attribute(groupTag, 'ID'), coordinator: null, members: [] };
+    var coordinatorId = attribute(groupTag, 'Coordinator');
+
+    var memberPos = state.indexOf('<ZoneGroupMember ', tagEnd);
+    while (memberPos !== -1 && memberPos < groupEnd) {
+      var memberEnd = state.indexOf('>', memberPos);
+      var memberTag = state.substring(memberPos, memberEnd);
+      var member = {
+        uuid: attribute(memberTag, 'UUID'),
+        name: attribute(memberTag, 'ZoneName'),
+        host: hostFromLocation(attribute(memberTag, 'Location'))
+      };
+      var invisible = attribute(memberTag, 'Invisible') === '1';
+      if (member.uuid === coordinatorId) group.coordinator = member;
+      if (!invisible && member.host) group.members.push(member);
+      memberPos = state.indexOf('<ZoneGroupMember ', memberEnd);
+    }
+    if (group.coordinator && group.coordinator.host) groups.push(group);
+    pos = state.indexOf('<ZoneGroup ', groupEnd);
+  }
+  return groups;
+}
+
+// "Kitchen", or "Kitchen + 2" for a group of three
+function groupName(group) {
+  var extra = group.members.length - 1;
+  return group.coordinator.name + (extra > 0 ? ' + ' + extra : '');
+}
+
+// Run callback-style tasks with at most limit in flight; done gets no
+// arguments, tasks record their own results
+function runLimited(tasks, limit, done) {
+  var next = 0, running = 0, finished = 0;
+  if (tasks.length === 0) {
+    done();
+    return;
+  }
+  function launch() {
+    while (running < limit && next < tasks.length) {
+      running++;
+      tasks[next++](function() {
+        running--;
+        if (++finished === tasks.length) {
+          done();
+        } else {
+          launch();
+        }
+      });
+    }
+  }
+  launch();
+}
+
+var GET_ZONE_GROUP_STATE =
+  '<s:Envelope xmlns:s="http://schemas.xmlsoap.org/soap/envelope/" s:encodingStyle="http://schemas.xmlsoap.org/soap/encoding/">' +
+  '<s:Body>' +
+  '<u:GetZoneGroupState xmlns:u="urn:schemas-upnp-org:service:ZoneGroupTopology:1">' +
+  '</u:GetZoneGroupState>' +
+  '</s:Body>' +
+  '</s:Envelope>';
+
+// Cached topology. request(url, headers, body, callback(err, text)) performs
+// a SOAP POST; onUpdate(saved) is called after every successful refresh with
+// an object that restore() accepts, so callers can persist it.
+function Topology(request, onUpdate) {
+  this.request = request;
+  this.onUpdate = onUpdate;
+  this.groups = null;
+  this.fetchedAt = 0;
+  this.failedAt = 0;
+  this.waiters = null;
+  this.stats = { lookups: 0, hits: 0, fetches: 0, failures: 0, fetchMs: 0, invalidations: 0 };
+}
+
+Topology.prototype.restore = function(saved) {
+  if (saved && saved.groups && saved.fetchedAt) {
+    this.groups = saved.groups;
+    this.fetchedAt = saved.fetchedAt;
+  }
+};
+
+Topology.prototype.fresh = function() {
+  return this.groups !== null && Date.now() - this.fetchedAt < TOPOLOGY_TTL_MS;
+};
+
+// Every host we know of, for seeding the next refresh
+Topology.prototype.hosts = function() {
+  var hosts = [];
+  (this.groups || []).forEach(function(group) {
+    group.members.forEach(function(member) { hosts.push(member.host); });
+  });
+  return hosts;
+};
+
+Topology.prototype.invalidate = function(reason) {
+  if (this.fetchedAt === 0) return;
+  console.log('Topology invalidated: ' + reason);
+  this.stats.invalidations++;
+  this.fetchedAt = 0;
+};
+
+// callback(err, groups). Served from cache while fresh; otherwise one refresh
+// is shared by every caller that arrives while it runs. A stale topology is
+// still returned if no speaker answers.
+Topology.prototype.get = function(seeds, callback) {
+  var self = this;
+  this.stats.lookups++;
+  if (this.fresh()) {
+    this.stats.hits++;
+    callback(null, this.groups);
+    return;
+  }
+  if (Date.now() - this.failedAt < TOPOLOGY_RETRY_MS) {
+    callback(this.groups ? null : 'Topology unavailable', this.groups);
+    return;
+  }
+  if (this.waiters) {
+    this.waiters.push(callback);
+    return;
+  }
+  this.waiters = [callback];
+
+  var candidates = [];
+  seeds.concat(this.hosts()).forEach(function(host) {
+    if (host && candidates.indexOf(host) === -1) candidates.push(host);
+  });
+  var started = Date.now();
+  this.stats.fetches++;
+
+  function finish(err) {
+    var waiters = self.waiters;
+    self.waiters = null;
+    waiters.forEach(function(waiter) { waiter(self.groups ? null : err, self.groups); });
+  }
+
+  (function attempt(i) {
+    if (i >= candidates.length) {
+      self.stats.failures++;
+      self.failedAt = Date.now();
+      finish('No speaker answered');
+      return;
+    }
+    var headers = {
+      'SOAPAction': 'urn:schemas-upnp-org:service:ZoneGroupTopology:1#GetZoneGroupState',
+      'Content-Type': 'text/xml; charset="utf-8"'
+    };
+    self.request('http://' + candidates[i] + '/ZoneGroupTopology/Control', headers, GET_ZONE_GROUP_STATE, function(err, response) {
+      var groups = err ? [] : parseZoneGroupState(response);
+      if (groups.length === 0) {
+        attempt(i + 1);
+        return;
+      }
+      var elapsed = Date.now() - started;
+      self.stats.fetchMs += elapsed;
+      self.groups = groups;
+      self.fetchedAt = Date.now();
+      self.failedAt = 0;
+      console.log('Topology: ' + groups.length + ' groups from ' + candidates[i] + ' in ' + elapsed + ' ms');
+      if (self.onUpdate) self.onUpdate({ groups: groups, fetchedAt: self.fetchedAt });
+      finish(null);
+    });
+  })(0);
+};
+
+// The group containing the speaker with this UUID or host
+Topology.prototype.findGroup = function(uuid, host) {
+  var groups = this.groups || [];
+  for (var i = 0; i < groups.length; i++) {
+    for (var j = 0; j < groups[i].members.length; j++) {
+      var member = groups[i].members[j];
+      if ((uuid && member.uuid === uuid) || (host && member.host === host)) return groups[i];
+    }
+  }
+  return null;
+};
+
+module.exports = {
+  parseZoneGroupState: parseZoneGroupState,
+  groupName: groupName,
+  runLimited: runLimited,
+  Topology: Topology
+};
@@ -0,0 +1,137 @@
+// Tests for the request dispatcher in src/pkjs/requests.js.
+//
+//   node test/requests-test.js
+//
+// Timers run on a fake clock, so deadlines and breaker backoffs are stepped
+// through without waiting. Exits non-zero if any test fails.
+
+var assert = require('assert');
+
+var clock = { now: 0, timers: [], nextId: 1 };
+global.setTimeout = function(fn, ms) {
+  var timer = { id: clock.nextId++, at: clock.now + (ms || 0), fn: fn };
+  clock.timers.push(timer);
+  return timer.id;
+};
+global.clearTimeout = function(id) {
+  clock.timers = clock.timers.filter(function(timer) { return timer.id !== id; });
+};
+function advance(ms) {
+  var until = clock.now + ms;
+  for (;;) {
+    var due = clock.timers.filter(function(timer) { return timer.at <= until; }).sort(function(a, b) { return a.at - b.at || a.id - b.id; })[0];
+    if (!due) break;
+    clock.timers.splice(clock.timers.indexOf(due), 1);
+    clock.now = due.at;
+    due.fn();
+  }
+  clock.now = until;
+}
+
+console.log = function() {};
+var requests = require('../src/pkjs/requests.js');
+
+// A request whose outcome the test decides: it records its start, its abort
+// and the result its callback got
+function fakeRequest(dispatcher, host, action) {
+  var fake = { host: host, started: false, aborted: 0, done: null, result: null };
+  dispatcher.run({ host: host, action: action || 'GetVolume' }, function(done) {
+    fake.started = true;
+    fake.done = done;
+    return function() { fake.aborted++; };
+  }, function(err, response) {
+    assert.strictEqual(fake.result, null, 'callback ran twice for ' + host);
+    fake.result = { err: err, response: response };
+  });
+  return fake;
+}
+
+function newDispatcher(health) {
+  return new requests.Dispatcher(function() {}, function(host, reachable) { if (health) health.push([host, reachable]); });
+}
+
+var tests = [];
+function test(name, fn) { tests.push({ name: name, fn: fn }); }
+
+test('tripping the breaker starts nothing more for that speaker', function() {
+  var health = [];
+  var dispatcher = newDispatcher(health);
+  // One failure short of the threshold, while nothing waits
+  for (var f = 0; f < requests.BREAKER_THRESHOLD - 1; f++) fakeRequest(dispatcher, 'a').done('Network error', null);
+  var running = [], waiting = [];
+  for (var i = 0; i < requests.MAX_IN_FLIGHT; i++) running.push(fakeRequest(dispatcher, 'a'));
+  for (var j = 0; j < 3; j++) waiting.push(fakeRequest(dispatcher, 'a'));
+  var other = fakeRequest(dispatcher, 'b');
+  assert.ok(running.every(function(fake) { return fake.started; }));
+  assert.ok(!waiting.some(function(fake) { return fake.started; }) && !other.started);
+
+  running[0].done('Network error', null);
+
+  assert.ok(dispatcher.isOpen('a'));
+  assert.deepStrictEqual(health, [['a', false]]);
+  waiting.forEach(function(fake) {
+    assert.ok(!fake.started, 'a waiting request for the tripped speaker was started');
+    assert.strictEqual(fake.aborted, 0);
+    assert.strictEqual(fake.result.err, requests.ERR_UNREACHABLE);
+  });
+  // The freed slot goes to the other speaker; the rest for 'a' are still on the wire
+  assert.ok(other.started);
+  running.slice(1).forEach(function(fake) { assert.strictEqual(fake.result, null); assert.strictEqual(fake.aborted, 0); });
+  assert.strictEqual(dispatcher.breaker('a').failures, requests.BREAKER_THRESHOLD);
+  assert.strictEqual(dispatcher.inFlight, requests.MAX_IN_FLIGHT);
+
+  var late = fakeRequest(dispatcher, 'a');
+  assert.ok(!late.started);
+  assert.strictEqual(late.result.err, requests.ERR_UNREACHABLE);
+});
+
+test('a waiting request fails when its breaker opened before a slot freed', function() {
+  var dispatcher = newDispatcher();
+  var running = [];
+  for (var i = 0; i < requests.MAX_IN_FLIGHT; i++) running.push(fakeRequest(dispatcher, 'b'));
+  var waiting = fakeRequest(dispatcher, 'a');
+  dispatcher.breaker('a').open = true;
+  running[0].done(null, 'ok');
+  assert.ok(!waiting.started);
+  assert.strictEqual(waiting.result.err, requests.ERR_UNREACHABLE);
+  assert.strictEqual(dispatcher.inFlight, requests.MAX_IN_FLIGHT - 1);
+});
+
+test('a request past its deadline is aborted once and counted as a failure', function() {
+  var dispatcher = newDispatcher();
+  var fake = fakeRequest(dispatcher, 'a', 'GetVolume');
+  advance(1999);
+  assert.strictEqual(fake.result, null);
+  advance(1);
+  assert.strictEqual(fake.result.err, requests.ERR_TIMEOUT);
+  assert.strictEqual(fake.aborted, 1);
+  assert.strictEqual(dispatcher.breaker('a').failures, 1);
+  assert.strictEqual(dispatcher.inFlight, 0);
+  // The answer arriving after the abort changes nothing
+  fake.done(null, 'late');
+  assert.strictEqual(fake.result.err, requests.ERR_TIMEOUT);
+  assert.strictEqual(dispatcher.breaker('a').failures, 1);
+});
+
+test('an answered request is not aborted', function() {
+  var dispatcher = newDispatcher();
+  var fake = fakeRequest(dispatcher, 'a');
+  fake.done('HTTP Error 500', null);
+  advance(10000);
+  assert.strictEqual(fake.aborted, 0);
+  assert.strictEqual(fake.result.err, 'HTTP Error 500');
+  assert.strictEqual(dispatcher.breaker('a').failures, 0);
+});
+
+var failed = 0;
+tests.forEach(function(entry) {
+  clock.timers = [];
+  try {
+    entry.fn();
+    process.stdout.write('ok   ' + entry.name + '\n');
+  } catch (e) {
+    failed++;
+    process.stdout.write('FAIL ' + entry.name + '\n  ' + (e.stack || e) + '\n');
+  }
+});
+process.exit(failed ? 1 : 0);